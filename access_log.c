@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+#include "access_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "logMgr.h"
+
+#define APP_ID "SRV"
+
+// 记录大小须与文件格式一致
+typedef char access_record_size_check[sizeof(access_record_t) == ACCESS_LOG_RECORD_SIZE ? 1 : -1];
+
+static access_log_header_t *access_header = NULL;
+static access_record_t *access_records = NULL;
+static size_t access_map_size = 0;
+static bool access_enabled = false;
+
+// 已有文件的格式及容量与本次相同时保留其中的记录
+static bool access_log_header_valid(const access_log_header_t *header, uint64_t capacity) {
+    return memcmp(header->magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC)) == 0 &&
+           header->version == ACCESS_LOG_VERSION &&
+           header->record_size == ACCESS_LOG_RECORD_SIZE &&
+           header->capacity == capacity;
+}
+
+int access_log_open(const char *path, size_t size_mb) {
+    if (path == NULL || path[0] == '\0') {
+        return 0;
+    }
+    if (size_mb == 0) {
+        size_mb = 1;
+    }
+    uint64_t capacity = ((uint64_t)size_mb * 1024 * 1024 - ACCESS_LOG_HEADER_SIZE) / ACCESS_LOG_RECORD_SIZE;
+    size_t size = ACCESS_LOG_HEADER_SIZE + capacity * ACCESS_LOG_RECORD_SIZE;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        dlt_log_error(APP_ID, "Failed to open access log %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || ((size_t)st.st_size != size && ftruncate(fd, size) < 0)) {
+        dlt_log_error(APP_ID, "Failed to size access log %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    // 写入时由内核在后台写回，进程崩溃也不丢失已写入映射的记录
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        dlt_log_error(APP_ID, "Failed to map access log %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    access_log_header_t *header = map;
+    if (!access_log_header_valid(header, capacity)) {
+        memset(map, 0, size);
+        memcpy(header->magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC));
+        header->version = ACCESS_LOG_VERSION;
+        header->record_size = ACCESS_LOG_RECORD_SIZE;
+        header->capacity = capacity;
+        header->head = 0;
+    }
+    access_header = header;
+    access_records = (access_record_t *)((char *)map + ACCESS_LOG_HEADER_SIZE);
+    access_map_size = size;
+    __atomic_store_n(&access_enabled, true, __ATOMIC_RELEASE);
+    dlt_log_info(APP_ID, "Access log %s: %llu records, %llu written", path,
+                 (unsigned long long)capacity, (unsigned long long)header->head);
+    return 0;
+}
+
+void access_log_close(void) {
+    if (!__atomic_exchange_n(&access_enabled, false, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    msync(access_header, access_map_size, MS_ASYNC);
+}
+
+bool access_log_enabled(void) {
+    return __atomic_load_n(&access_enabled, __ATOMIC_RELAXED);
+}
+
+void access_log_write(const access_record_t *rec) {
+    if (!__atomic_load_n(&access_enabled, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    uint64_t seq = __atomic_fetch_add(&access_header->head, 1, __ATOMIC_RELAXED);
+    access_record_t *slot = &access_records[seq % access_header->capacity];
+    // 先清除序号标记槽位正在写入，写完后再发布序号
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char *)slot + sizeof(slot->seq), (const char *)rec + sizeof(rec->seq),
+           sizeof(*rec) - sizeof(rec->seq));
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+// 64位FNV-1a
+static uint64_t access_path_hash(const char *path, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void access_record_init(access_record_t *rec, uint8_t protocol, uint64_t start,
+                        const char *method, size_t method_len, const char *path, size_t path_len) {
+    memset(rec, 0, sizeof(*rec));
+    // 开始时间由当前实时时钟减去已经过的时间得出，每条记录只读一次实时时钟
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    uint64_t elapsed = access_log_now() - start;
+    rec->time_ns = now > elapsed ? now - elapsed : now;
+    rec->protocol = protocol;
+    rec->parse_us = rec->resolve_us = rec->first_byte_us = rec->complete_us = ACCESS_LOG_NO_TIME;
+    if (method != NULL) {
+        memcpy(rec->method, method, method_len < sizeof(rec->method) ? method_len : sizeof(rec->method));
+    }
+    if (path != NULL) {
+        rec->path_hash = access_path_hash(path, path_len);
+        rec->path_len = path_len < UINT16_MAX ? (uint16_t)path_len : UINT16_MAX;
+        memcpy(rec->path, path, path_len < sizeof(rec->path) ? path_len : sizeof(rec->path));
+    }
+}
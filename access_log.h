@@ -0,0 +1,96 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// 二进制访问日志：每个HTTP请求及FTP传输写入一条定长记录，文件映射到内存作为环形缓冲区
+// 写入只有一次原子加和一次内存复制，没有系统调用，也不做文本格式化；由access_log_decode转换为文本或CSV
+//
+// 文件布局：ACCESS_LOG_HEADER_SIZE字节的文件头，其后为capacity个ACCESS_LOG_RECORD_SIZE字节的记录槽
+// 第n条记录（从0计）写入槽n % capacity，写满后覆盖最旧的记录
+
+#define ACCESS_LOG_MAGIC        "ACCLOG1"
+#define ACCESS_LOG_VERSION      1
+#define ACCESS_LOG_HEADER_SIZE  4096
+#define ACCESS_LOG_RECORD_SIZE  128
+#define ACCESS_LOG_METHOD_SIZE  8
+#define ACCESS_LOG_PATH_SIZE    58
+
+// 阶段时间未经历（如请求解析失败时没有路径解析阶段）
+#define ACCESS_LOG_NO_TIME      UINT32_MAX
+
+#define ACCESS_PROTO_HTTP       1
+#define ACCESS_PROTO_FTP        2
+
+#define ACCESS_FLAG_ABORTED     (1U << 0)   // 响应未发送完毕连接即关闭
+#define ACCESS_FLAG_KEEPALIVE   (1U << 1)   // 响应后保持连接
+
+// 文件头，head为已分配的记录总数，由各写入线程原子递增
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint64_t head;
+} access_log_header_t;
+
+// 一条访问记录，固定ACCESS_LOG_RECORD_SIZE字节
+// seq在写入过程中为0，写完后为记录序号加1，读取时据此跳过未写完或已被覆盖的槽
+typedef struct {
+    uint64_t seq;
+    uint64_t time_ns;           // 请求开始时间（CLOCK_REALTIME，纳秒）
+    uint64_t bytes;             // 发送的字节数，HTTP含响应头
+    uint64_t path_hash;         // 完整路径的FNV-1a哈希，路径被截断时用于区分
+    uint32_t addr;              // 客户端IPv4地址（网络字节序）
+    uint16_t port;              // 客户端端口
+    uint16_t status;            // HTTP状态码或FTP应答码，0表示未回复
+    // 各阶段距请求开始的微秒数：解析完成、路径解析完成、发出首字节、完成
+    uint32_t parse_us;
+    uint32_t resolve_us;
+    uint32_t first_byte_us;
+    uint32_t complete_us;
+    uint8_t protocol;           // ACCESS_PROTO_*
+    uint8_t flags;              // ACCESS_FLAG_*
+    uint16_t worker;            // HTTP工作线程编号
+    char method[ACCESS_LOG_METHOD_SIZE];    // 请求方法或FTP命令，不足时以0填充
+    uint16_t path_len;          // 完整路径的长度，大于ACCESS_LOG_PATH_SIZE时path只保存开头部分
+    char path[ACCESS_LOG_PATH_SIZE];
+} access_record_t;
+
+// 打开（不存在时创建）size_mb大小的日志文件并映射，文件格式及容量相同时接着原有记录写入
+// path为空时不记录访问日志；失败时返回-1
+int access_log_open(const char *path, size_t size_mb);
+
+// 停止记录并将映射写回文件
+// 映射本身保留到进程退出，未被等待的FTP会话线程此后写入也不会访问已释放的内存
+void access_log_close(void);
+
+bool access_log_enabled(void);
+
+// 追加一条记录，seq由本函数填写；未启用时直接返回
+void access_log_write(const access_record_t *rec);
+
+// 阶段计时使用的单调时钟（纳秒），经vDSO读取，无系统调用
+static inline uint64_t access_log_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 阶段时间点相对请求开始的微秒数，t为0（未经历）时返回ACCESS_LOG_NO_TIME
+static inline uint32_t access_log_elapsed_us(uint64_t start, uint64_t t) {
+    if (t == 0) {
+        return ACCESS_LOG_NO_TIME;
+    }
+    uint64_t us = t > start ? (t - start) / 1000 : 0;
+    return us < ACCESS_LOG_NO_TIME ? (uint32_t)us : ACCESS_LOG_NO_TIME - 1;
+}
+
+// 填写请求开始时间、方法及路径，start为access_log_now()取得的开始时间
+void access_record_init(access_record_t *rec, uint8_t protocol, uint64_t start,
+                        const char *method, size_t method_len, const char *path, size_t path_len);
+
+#endif // ACCESS_LOG_H
@@ -0,0 +1,499 @@
+// 请求热路径上小函数的微基准测试
+// 用法: bench_hotpath [-f 名称过滤] [-r 重复次数] [-b 每轮毫秒数] [-w 预热毫秒数] [-l]
+//   每个用例先预热并确定每轮的迭代次数，再测量多轮，输出每次操作耗时的中位数、最小值及CPU周期数
+//   每次操作处理固定语料中的一项，语料轮流使用，结果在不同版本之间可直接比较
+//   周期数优先取自perf事件（实际CPU周期），不可用时使用TSC（参考周期，不随频率变化）
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../utils.h"
+#include "../config.h"
+#include "../mime.h"
+#include "../http_response.h"
+#include "../listing.h"
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+// ---- 固定语料 ----
+
+// 请求路径（URL编码），包含无需解码、中文、保留字符及非法转义的情况
+static const char *const url_paths[] = {
+    "/index.html",
+    "/static/css/site.min.css",
+    "/docs/Annual%20Report%202024%20%28final%29.pdf",
+    "/%E4%B8%AD%E6%96%87/%E6%96%87%E6%A1%A3.txt",
+    "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/deeply-nested-file-name.tar.gz",
+    "/search%2Fresults%3Fq%3Dtest%26page%3D2",
+    "/bad%zz%2escape%",
+    "/",
+};
+
+// 解码后的路径，包含重复斜杠、"."、".."及越出根目录的情况
+static const char *const normalize_paths[] = {
+    "/index.html",
+    "/static/css/site.min.css",
+    "//static///js/./app.js",
+    "/docs/2024/../2023/./report.pdf",
+    "/a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/deeply-nested-file-name.tar.gz",
+    "/../../etc/passwd",
+    "/",
+};
+
+// MIME查询的文件路径，包含大小写混合、未注册及无扩展名的情况
+static const char *const file_paths[] = {
+    "/srv/www/index.html",
+    "/srv/www/static/css/site.min.css",
+    "/srv/www/static/js/app.bundle.js",
+    "/srv/www/images/logo.PNG",
+    "/srv/www/fonts/inter.woff2",
+    "/srv/www/docs/manual.pdf",
+    "/srv/www/downloads/release.tar.gz",
+    "/srv/www/video/intro.mp4",
+    "/srv/www/unknown.xyzzy",
+    "/srv/www/README",
+};
+
+static const off_t file_sizes[] = {
+    0, 512, 1023, 1024, 4096, 65535, 1536 * 1024, 700LL * 1024 * 1024, 5LL * 1024 * 1024 * 1024,
+};
+
+// 配置文件的典型行，包含section、注释、空行及行尾注释
+static const char *const config_lines[] = {
+    "[http_server]",
+    "ip = 0.0.0.0",
+    "port = 8080",
+    "root_dir = /var/www/html",
+    "# 连接保持的超时时间",
+    "keepalive_timeout = 5      # 秒",
+    "",
+    "compression = on",
+    "[ftp_server]",
+    "  max_connections =   20  ",
+    "data_port_range = 50000-50100",
+    "[log]",
+    "level = info",
+};
+
+static const char *const trim_inputs[] = {
+    "  key = value  ",
+    "\tport\t",
+    "no_whitespace",
+    "     ",
+    "  /var/www/html  \r",
+};
+
+static const struct {
+    int status;
+    const char *type;
+    off_t length;
+} headers[] = {
+    { 200, "text/html", 5120 },
+    { 200, "application/javascript", 183422 },
+    { 206, "video/mp4", 1048576 },
+    { 304, "image/png", -1 },
+    { 404, "text/html", 312 },
+};
+
+// 目录项名称及其文件信息（模式、大小、修改时间）
+static const struct {
+    const char *name;
+    mode_t mode;
+    off_t size;
+    time_t mtime;
+} entries[] = {
+    { "index.html",                    S_IFREG | 0644, 5120,              1700000000 },
+    { "static",                        S_IFDIR | 0755, 4096,              1700003600 },
+    { "Annual Report 2024 (final).pdf", S_IFREG | 0640, 2 * 1024 * 1024,   1710000000 },
+    { "release-1.2.3.tar.gz",          S_IFREG | 0644, 734003200,         1720000000 },
+    { "empty",                         S_IFREG | 0600, 0,                 1730000000 },
+};
+
+// ---- 用例 ----
+
+static mime_registry_t *registry;
+static ServerConfig config;
+static char test_root[] = "/tmp/bench_hotpath.XXXXXX";
+static char safe_paths[6][PATH_MAX];
+static char date[32];
+static struct stat entry_stats[COUNT_OF(entries)];
+static strbuf_t sb;
+static char buf[4096];
+
+static uint64_t run_url_decode(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += url_decode(buf, url_paths[i % COUNT_OF(url_paths)]);
+    }
+    return sink;
+}
+
+static uint64_t run_path_normalize(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += path_normalize(buf, sizeof(buf), normalize_paths[i % COUNT_OF(normalize_paths)], false);
+    }
+    return sink;
+}
+
+static uint64_t run_safe_path_join(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += safe_path_join(buf, sizeof(buf), "/srv/www/html", url_paths[i % COUNT_OF(url_paths)], "");
+        sink += (unsigned char)buf[14];
+    }
+    return sink;
+}
+
+static uint64_t run_is_path_safe(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += is_path_safe(safe_paths[i % COUNT_OF(safe_paths)], test_root);
+    }
+    return sink;
+}
+
+static uint64_t run_get_file_size_str(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += (unsigned char)get_file_size_str(file_sizes[i % COUNT_OF(file_sizes)])[0];
+    }
+    return sink;
+}
+
+static uint64_t run_format_http_date(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += format_http_date(buf, 1700000000 + i * 3607);
+    }
+    return sink;
+}
+
+// 状态行、通用头、正文描述头及结束空行，与文件响应的最简形式相同
+static uint64_t run_http_header(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        size_t k = i % COUNT_OF(headers);
+        sb.len = 0;
+        sink += http_begin_header(&sb, headers[k].status, date, i & 1);
+        append_entity_headers(&sb, headers[k].type, headers[k].length);
+        APPEND_LITERAL(&sb, "\r\n");
+        sink += sb.len;
+    }
+    return sink;
+}
+
+static uint64_t run_mime_lookup(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        sink += mime_registry_lookup(registry, file_paths[i % COUNT_OF(file_paths)])->flags;
+    }
+    return sink;
+}
+
+// 包含复制输入的开销（trim_whitespace原地修改）
+static uint64_t run_trim_whitespace(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        strcpy(buf, trim_inputs[i % COUNT_OF(trim_inputs)]);
+        sink += (unsigned char)trim_whitespace(buf)[0];
+    }
+    return sink;
+}
+
+static uint64_t run_config_parse_line(long iterations) {
+    uint64_t sink = 0;
+    char section[64] = "";
+    for (long i = 0; i < iterations; i++) {
+        strcpy(buf, config_lines[i % COUNT_OF(config_lines)]);
+        config_parse_line(&config, buf, section, sizeof(section));
+        sink += (unsigned char)section[0];
+    }
+    return sink + config.http.port;
+}
+
+static uint64_t run_listing_html_row(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        size_t k = i % COUNT_OF(entries);
+        sb.len = 0;
+        sink += listing_append_html_row(&sb, "/pub/releases", "/", entries[k].name, &entry_stats[k]) == 0;
+        sink += sb.len;
+    }
+    return sink;
+}
+
+static uint64_t run_listing_ftp_line(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        size_t k = i % COUNT_OF(entries);
+        sink += listing_format_ftp_line(buf, sizeof(buf), entries[k].name, &entry_stats[k]);
+    }
+    return sink;
+}
+
+static uint64_t run_listing_mlsx_facts(long iterations) {
+    uint64_t sink = 0;
+    for (long i = 0; i < iterations; i++) {
+        size_t k = i % COUNT_OF(entries);
+        sink += listing_format_mlsx_facts(buf, sizeof(buf), &entry_stats[k]);
+    }
+    return sink;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t (*run)(long iterations);   // 返回值累加后输出，防止调用被优化掉
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    { "url_decode",            run_url_decode },
+    { "path_normalize",        run_path_normalize },
+    { "safe_path_join",        run_safe_path_join },
+    { "is_path_safe",          run_is_path_safe },
+    { "get_file_size_str",     run_get_file_size_str },
+    { "format_http_date",      run_format_http_date },
+    { "http_header",           run_http_header },
+    { "mime_lookup",           run_mime_lookup },
+    { "trim_whitespace",       run_trim_whitespace },
+    { "config_parse_line",     run_config_parse_line },
+    { "listing_html_row",      run_listing_html_row },
+    { "listing_ftp_line",      run_listing_ftp_line },
+    { "listing_mlsx_facts",    run_listing_mlsx_facts },
+};
+
+// is_path_safe需要实际存在的路径：根目录下的文件、子目录、..回到根内、不存在的文件及根外的路径
+static int setup_path_tree(void) {
+    char path[PATH_MAX];
+    if (mkdtemp(test_root) == NULL) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/static", test_root);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/static/css", test_root);
+    mkdir(path, 0755);
+    static const char *const files[] = { "index.html", "static/css/site.css" };
+    for (size_t i = 0; i < COUNT_OF(files); i++) {
+        snprintf(path, sizeof(path), "%s/%s", test_root, files[i]);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return -1;
+        }
+        close(fd);
+    }
+    static const char *const paths[COUNT_OF(safe_paths)] = {
+        "index.html", "static/css/site.css", "static/css/../../index.html", "static", "missing.txt", "..",
+    };
+    for (size_t i = 0; i < COUNT_OF(safe_paths); i++) {
+        snprintf(safe_paths[i], sizeof(safe_paths[i]), "%s/%s", test_root, paths[i]);
+    }
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+static int setup(void) {
+    registry = mime_registry_create(NULL, NULL);
+    if (registry == NULL) {
+        return -1;
+    }
+    config_init(&config);
+    format_http_date(date, 1700000000);
+    for (size_t i = 0; i < COUNT_OF(entries); i++) {
+        memset(&entry_stats[i], 0, sizeof(entry_stats[i]));
+        entry_stats[i].st_mode = entries[i].mode;
+        entry_stats[i].st_size = entries[i].size;
+        entry_stats[i].st_mtime = entries[i].mtime;
+        entry_stats[i].st_nlink = S_ISDIR(entries[i].mode) ? 2 : 1;
+        entry_stats[i].st_uid = 1000;
+        entry_stats[i].st_gid = 1000;
+    }
+    // 时区在首次localtime_r时加载，不计入测量
+    struct tm tm;
+    time_t t = 0;
+    localtime_r(&t, &tm);
+    return setup_path_tree();
+}
+
+// ---- 计时 ----
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cycles_fd = -1;
+static const char *cycles_source = "none";
+
+// 优先使用本线程的CPU周期计数器，容器或虚拟机中通常不可用，退回TSC
+static void cycles_init(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cycles_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (cycles_fd >= 0) {
+        cycles_source = "perf cpu-cycles";
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    cycles_source = "tsc";
+#endif
+}
+
+static bool cycles_available(void) {
+    return strcmp(cycles_source, "none") != 0;
+}
+
+static uint64_t cycles_now(void) {
+    if (cycles_fd >= 0) {
+        uint64_t value = 0;
+        if (read(cycles_fd, &value, sizeof(value)) != sizeof(value)) {
+            return 0;
+        }
+        return value;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+typedef struct {
+    double ns;
+    double cycles;
+} sample_t;
+
+static int compare_sample(const void *a, const void *b) {
+    double x = ((const sample_t *)a)->ns, y = ((const sample_t *)b)->ns;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t sink_total;
+
+// 运行一轮，返回每次操作的耗时及周期数
+static sample_t measure(const bench_case_t *bc, long iterations) {
+    uint64_t c0 = cycles_now();
+    double t0 = now_sec();
+    sink_total += bc->run(iterations);
+    double t1 = now_sec();
+    uint64_t c1 = cycles_now();
+    sample_t s = { (t1 - t0) * 1e9 / iterations, (double)(c1 - c0) / iterations };
+    return s;
+}
+
+static void run_case(const bench_case_t *bc, int repeats, double batch_sec, double warmup_sec) {
+    // 预热：迭代次数逐次加倍直至一轮超过预热时长的1/8，之后继续运行到预热时长，
+    // 并据此确定每轮的迭代次数
+    long iterations = 16;
+    double start = now_sec();
+    double ns_per_op = 0;
+    for (;;) {
+        sample_t s = measure(bc, iterations);
+        ns_per_op = s.ns;
+        double elapsed = now_sec() - start;
+        if (elapsed >= warmup_sec) {
+            break;
+        }
+        if (s.ns * iterations < warmup_sec * 1e9 / 8) {
+            iterations *= 2;
+        }
+    }
+    iterations = (long)(batch_sec * 1e9 / (ns_per_op > 0 ? ns_per_op : 1));
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    sample_t samples[repeats];
+    for (int i = 0; i < repeats; i++) {
+        samples[i] = measure(bc, iterations);
+    }
+    qsort(samples, repeats, sizeof(samples[0]), compare_sample);
+    const sample_t *median = &samples[repeats / 2];
+    if (cycles_available()) {
+        printf("%-20s %10.1f %10.1f %10.1f %14.0f %12ld\n", bc->name, median->ns, samples[0].ns,
+               median->cycles, 1e9 / median->ns, iterations);
+    } else {
+        printf("%-20s %10.1f %10.1f %10s %14.0f %12ld\n", bc->name, median->ns, samples[0].ns, "-",
+               1e9 / median->ns, iterations);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-f filter] [-r repeats] [-b batch_ms] [-w warmup_ms] [-l]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *filter = NULL;
+    int repeats = 7;
+    double batch_ms = 50, warmup_ms = 200;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:b:w:lh")) != -1) {
+        switch (opt) {
+        case 'f': filter = optarg; break;
+        case 'r': repeats = atoi(optarg); break;
+        case 'b': batch_ms = atof(optarg); break;
+        case 'w': warmup_ms = atof(optarg); break;
+        case 'l':
+            for (size_t i = 0; i < COUNT_OF(cases); i++) {
+                printf("%s\n", cases[i].name);
+            }
+            return 0;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (repeats <= 0 || batch_ms <= 0 || warmup_ms < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (setup() != 0) {
+        fprintf(stderr, "Setup failed: %s\n", strerror(errno));
+        return 1;
+    }
+    cycles_init();
+
+    printf("Hot path microbenchmarks: %d x %.0f ms per case after %.0f ms warm-up, cycles from %s\n",
+           repeats, batch_ms, warmup_ms, cycles_source);
+    printf("%-20s %10s %10s %10s %14s %12s\n", "case", "ns/op", "min ns/op", "cycles/op", "ops/s", "iterations");
+    for (size_t i = 0; i < COUNT_OF(cases); i++) {
+        if (filter != NULL && strstr(cases[i].name, filter) == NULL) {
+            continue;
+        }
+        run_case(&cases[i], repeats, batch_ms / 1e3, warmup_ms / 1e3);
+    }
+    if (sink_total == 0) {
+        printf("(sink is zero)\n");
+    }
+
+    mime_registry_destroy(registry);
+    strbuf_free(&sb);
+    nftw(test_root, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+    return 0;
+}
@@ -0,0 +1,89 @@
+// HTTP请求解析吞吐量基准测试
+// 用法: bench_http_parser [iterations]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../http_parser.h"
+
+// 典型浏览器请求
+static const char browser_request[] =
+    "GET /static/css/site.min.css?v=20240101 HTTP/1.1\r\n"
+    "Host: mirror.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: http://mirror.example.com/\r\n"
+    "If-None-Match: \"65a1b2c3-1f40\"\r\n"
+    "If-Modified-Since: Mon, 01 Jan 2024 00:00:00 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// 最小请求
+static const char minimal_request[] = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 整块解析：数据一次到齐
+static void bench_whole(const char *name, const char *req, size_t len, long iterations) {
+    http_parser_t parser;
+    http_parser_init(&parser, 8192, 64);
+    long ok = 0;
+
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        http_parser_reset(&parser);
+        ok += http_parser_execute(&parser, req, len) == HTTP_PARSE_DONE;
+    }
+    double elapsed = now_sec() - start;
+
+    printf("%-24s %8.1f ns/req %10.0f req/s %8.1f MB/s%s\n", name,
+           elapsed * 1e9 / iterations, iterations / elapsed,
+           (double)len * iterations / elapsed / (1024 * 1024),
+           ok == iterations ? "" : "  (PARSE FAILED)");
+}
+
+// 分段解析：模拟请求被拆成多个TCP段，每次多到达chunk字节
+static void bench_chunked(const char *name, const char *req, size_t len, size_t chunk, long iterations) {
+    http_parser_t parser;
+    http_parser_init(&parser, 8192, 64);
+    long ok = 0;
+
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        http_parser_reset(&parser);
+        int ret = HTTP_PARSE_AGAIN;
+        for (size_t avail = chunk; ret == HTTP_PARSE_AGAIN; avail += chunk) {
+            ret = http_parser_execute(&parser, req, avail < len ? avail : len);
+        }
+        ok += ret == HTTP_PARSE_DONE;
+    }
+    double elapsed = now_sec() - start;
+
+    printf("%-24s %8.1f ns/req %10.0f req/s %8.1f MB/s%s\n", name,
+           elapsed * 1e9 / iterations, iterations / elapsed,
+           (double)len * iterations / elapsed / (1024 * 1024),
+           ok == iterations ? "" : "  (PARSE FAILED)");
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    printf("HTTP parser benchmark, %ld iterations\n", iterations);
+    bench_whole("minimal", minimal_request, sizeof(minimal_request) - 1, iterations);
+    bench_whole("browser", browser_request, sizeof(browser_request) - 1, iterations);
+    bench_chunked("browser/64B segments", browser_request, sizeof(browser_request) - 1, 64, iterations);
+    bench_chunked("browser/1B segments", browser_request, sizeof(browser_request) - 1, 1, iterations / 10);
+    return 0;
+}
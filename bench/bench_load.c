@@ -0,0 +1,747 @@
+// 回环负载测试：生成测试根目录，在127.0.0.1上启动服务器，多线程发起HTTP/FTP请求
+// 各场景的请求速率、吞吐量及延迟分位数以JSON输出，便于不同版本之间比较
+// 用法: bench_load [-s server] [-d 秒] [-w 预热秒] [-t 线程数] [-f 场景名过滤] [-o 输出文件] [-k]
+//   -s  服务器可执行文件，默认为编译时的server目标
+//   -d  每个场景的测量时长（默认5秒），-w 测量前的预热时长（默认1秒）
+//   -t  并发线程数（默认8），每个线程一个连接；FTP场景最多使用16个
+//   -f  只运行名称包含该字符串的场景
+//   -o  JSON写入文件，默认输出到标准输出；进度信息输出到标准错误
+//   -k  保留生成的根目录及服务器日志
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef BENCH_SERVER_PATH
+#define BENCH_SERVER_PATH "./server"
+#endif
+
+#define SMALL_FILE_SIZE     1024
+#define LARGE_FILE_SIZE     (16 * 1024 * 1024)
+#define FTP_MAX_THREADS     16      // 服务器的FTP会话数上限为20
+#define IO_TIMEOUT_SEC      10
+#define RECV_BUFFER_SIZE    (64 * 1024)
+
+typedef enum {
+    PROTO_HTTP,
+    PROTO_FTP,
+} protocol_t;
+
+typedef struct {
+    const char *name;
+    protocol_t protocol;
+    const char *path;           // HTTP请求路径，或FTP命令参数
+    bool keepalive;             // HTTP：复用连接；否则每个请求新建连接
+    const char *ftp_command;    // RETR或LIST
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    { "http_small_keepalive",  PROTO_HTTP, "/small.txt", true,  NULL },
+    { "http_small_close",      PROTO_HTTP, "/small.txt", false, NULL },
+    { "http_large_keepalive",  PROTO_HTTP, "/large.bin", true,  NULL },
+    { "http_large_close",      PROTO_HTTP, "/large.bin", false, NULL },
+    { "http_listing_10",       PROTO_HTTP, "/list10/",   true,  NULL },
+    { "http_listing_1k",       PROTO_HTTP, "/list1k/",   true,  NULL },
+    { "http_listing_50k",      PROTO_HTTP, "/list50k/",  true,  NULL },
+    { "ftp_retr_small",        PROTO_FTP,  "small.txt",  true,  "RETR" },
+    { "ftp_retr_large",        PROTO_FTP,  "large.bin",  true,  "RETR" },
+    { "ftp_list",              PROTO_FTP,  "",           true,  "LIST" },
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// 测试参数
+static const char *server_path = BENCH_SERVER_PATH;
+static double duration = 5.0;
+static double warmup = 1.0;
+static int thread_count = 8;
+static const char *filter = NULL;
+static const char *output_path = NULL;
+static bool keep_root = false;
+
+static char work_dir[] = "/tmp/bench_load.XXXXXX";
+static char root_dir[64];
+static uint16_t http_port, ftp_port, ftp_data_port;
+static pid_t server_pid = -1;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ---- 测试根目录 ----
+
+static int write_file(const char *path, size_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    char block[4096];
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = 'a' + i % 26;
+    }
+    for (size_t done = 0; done < size;) {
+        size_t n = size - done < sizeof(block) ? size - done : sizeof(block);
+        if (write(fd, block, n) != (ssize_t)n) {
+            close(fd);
+            return -1;
+        }
+        done += n;
+    }
+    return close(fd);
+}
+
+// 含count个空文件的目录
+static int make_listing_dir(const char *name, int count) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", root_dir, name);
+    if (mkdir(path, 0755) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "%s/%s/entry-%06d.dat", root_dir, name, i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return -1;
+        }
+        close(fd);
+    }
+    return 0;
+}
+
+static int make_root(void) {
+    char path[PATH_MAX];
+    if (mkdtemp(work_dir) == NULL) {
+        return -1;
+    }
+    snprintf(root_dir, sizeof(root_dir), "%s/root", work_dir);
+    if (mkdir(root_dir, 0755) != 0) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/small.txt", root_dir);
+    if (write_file(path, SMALL_FILE_SIZE) != 0) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/large.bin", root_dir);
+    if (write_file(path, LARGE_FILE_SIZE) != 0) {
+        return -1;
+    }
+    return make_listing_dir("list10", 10) | make_listing_dir("list1k", 1000) |
+           make_listing_dir("list50k", 50000);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+// ---- 服务器进程 ----
+
+// 取一个当前空闲的端口
+static uint16_t free_port(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    uint16_t port = 0;
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return port;
+}
+
+static int connect_port(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port),
+                                .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { IO_TIMEOUT_SEC, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static int write_config(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f,
+            "[http_server]\n"
+            "ip = 127.0.0.1\n"
+            "port = %u\n"
+            "root_dir = %s\n"
+            "max_connections = 4096\n"
+            "workers = auto\n"
+            "keepalive_requests = 0\n"
+            "\n"
+            "[ftp_server]\n"
+            "ip = 127.0.0.1\n"
+            "port = %u\n"
+            "root_dir = %s\n"
+            "max_connections = 20\n"
+            "data_port_range = %u-%u\n"
+            "\n"
+            "[log]\n"
+            "level = warn\n",
+            http_port, root_dir, ftp_port, root_dir, ftp_data_port, ftp_data_port + 100);
+    return fclose(f);
+}
+
+// 启动服务器，等待HTTP及FTP端口都可连接
+static int start_server(void) {
+    char conf[PATH_MAX], log[PATH_MAX];
+    snprintf(conf, sizeof(conf), "%s/server.conf", work_dir);
+    snprintf(log, sizeof(log), "%s/server.log", work_dir);
+    http_port = free_port();
+    ftp_port = free_port();
+    ftp_data_port = free_port();
+    if (http_port == 0 || ftp_port == 0 || ftp_data_port == 0 || write_config(conf) != 0) {
+        return -1;
+    }
+
+    server_pid = fork();
+    if (server_pid < 0) {
+        return -1;
+    }
+    if (server_pid == 0) {
+        int fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execl(server_path, server_path, "-c", conf, (char *)NULL);
+        _exit(127);
+    }
+
+    for (int i = 0; i < 100; i++) {
+        int status;
+        if (waitpid(server_pid, &status, WNOHANG) == server_pid) {
+            server_pid = -1;
+            return -1;
+        }
+        int http_fd = connect_port(http_port);
+        int ftp_fd = http_fd >= 0 ? connect_port(ftp_port) : -1;
+        if (http_fd >= 0) {
+            close(http_fd);
+        }
+        if (ftp_fd >= 0) {
+            close(ftp_fd);
+            return 0;
+        }
+        usleep(50000);
+    }
+    return -1;
+}
+
+// 先SIGINT正常退出，超时后强制结束
+static void stop_server(void) {
+    if (server_pid <= 0) {
+        return;
+    }
+    kill(server_pid, SIGINT);
+    for (int i = 0; i < 40; i++) {
+        if (waitpid(server_pid, NULL, WNOHANG) == server_pid) {
+            server_pid = -1;
+            return;
+        }
+        usleep(50000);
+    }
+    kill(server_pid, SIGKILL);
+    waitpid(server_pid, NULL, 0);
+    server_pid = -1;
+}
+
+// ---- 客户端 ----
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// 线程私有的接收缓冲区，buf[start, end)为已读取尚未处理的数据
+typedef struct {
+    char buf[RECV_BUFFER_SIZE];
+    size_t start;
+    size_t end;
+} reader_t;
+
+static ssize_t reader_fill(reader_t *r, int fd) {
+    if (r->start == r->end) {
+        r->start = r->end = 0;
+    } else if (r->end == sizeof(r->buf)) {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->start = 0;
+    }
+    for (;;) {
+        ssize_t n = recv(fd, r->buf + r->end, sizeof(r->buf) - r->end, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n > 0) {
+            r->end += n;
+        }
+        return n;
+    }
+}
+
+// 读取一行（去掉CRLF），连接关闭或出错时返回NULL
+static char *reader_line(reader_t *r, int fd) {
+    for (;;) {
+        char *nl = memchr(r->buf + r->start, '\n', r->end - r->start);
+        if (nl != NULL) {
+            char *line = r->buf + r->start;
+            r->start = nl + 1 - r->buf;
+            *nl = '\0';
+            if (nl > line && nl[-1] == '\r') {
+                nl[-1] = '\0';
+            }
+            return line;
+        }
+        if (r->start == 0 && r->end == sizeof(r->buf)) {
+            return NULL;
+        }
+        if (reader_fill(r, fd) <= 0) {
+            return NULL;
+        }
+    }
+}
+
+// 丢弃count字节（count为-1时读到连接关闭），返回实际读取的字节数，出错时返回-1
+static int64_t reader_skip(reader_t *r, int fd, int64_t count) {
+    int64_t total = 0;
+    for (;;) {
+        size_t avail = r->end - r->start;
+        if (count >= 0 && (int64_t)avail >= count - total) {
+            r->start += count - total;
+            return count;
+        }
+        total += avail;
+        r->start = r->end = 0;
+        ssize_t n = reader_fill(r, fd);
+        if (n == 0 && count < 0) {
+            return total;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+    }
+}
+
+// 发送一个GET请求并读取完整响应，返回响应的字节数（不含头），失败时返回-1
+static int64_t http_get(int fd, reader_t *r, const char *path, bool keepalive, bool *closed) {
+    char request[512];
+    int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: %s\r\n\r\n",
+                       path, keepalive ? "keep-alive" : "close");
+    if (send_all(fd, request, len) != 0) {
+        return -1;
+    }
+    char *line = reader_line(r, fd);
+    if (line == NULL || strncmp(line, "HTTP/1.1 200", 12) != 0) {
+        return -1;
+    }
+    int64_t content_length = -1;
+    *closed = !keepalive;
+    while ((line = reader_line(r, fd)) != NULL && line[0] != '\0') {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_length = strtoll(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strstr(line + 11, "close") != NULL) {
+            *closed = true;
+        }
+    }
+    if (line == NULL) {
+        return -1;
+    }
+    return reader_skip(r, fd, content_length);
+}
+
+// 读取一个FTP应答（含多行应答），返回应答码
+static int ftp_reply(int fd, reader_t *r, char **text) {
+    char *line = reader_line(r, fd);
+    if (line == NULL || strlen(line) < 4) {
+        return -1;
+    }
+    int code = atoi(line);
+    if (line[3] == '-') {
+        char end[5];
+        snprintf(end, sizeof(end), "%.3s ", line);
+        while ((line = reader_line(r, fd)) != NULL && strncmp(line, end, 4) != 0) {
+        }
+        if (line == NULL) {
+            return -1;
+        }
+    }
+    if (text != NULL) {
+        *text = line + 4;
+    }
+    return code;
+}
+
+static int ftp_command(int fd, reader_t *r, const char *command, char **text) {
+    char line[512];
+    int len = snprintf(line, sizeof(line), "%s\r\n", command);
+    if (send_all(fd, line, len) != 0) {
+        return -1;
+    }
+    return ftp_reply(fd, r, text);
+}
+
+// 建立FTP会话并登录
+static int ftp_login(reader_t *r) {
+    int fd = connect_port(ftp_port);
+    if (fd < 0) {
+        return -1;
+    }
+    r->start = r->end = 0;
+    if (ftp_reply(fd, r, NULL) != 220 || ftp_command(fd, r, "USER anonymous", NULL) != 331 ||
+        ftp_command(fd, r, "PASS bench@", NULL) != 230 || ftp_command(fd, r, "TYPE I", NULL) != 200) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// PASV后执行一次RETR或LIST，返回数据连接上收到的字节数，失败时返回-1
+static int64_t ftp_transfer(int fd, reader_t *r, reader_t *data_reader, const scenario_t *sc) {
+    char *text;
+    unsigned h[4], p[2];
+    if (ftp_command(fd, r, "PASV", &text) != 227) {
+        return -1;
+    }
+    char *paren = strchr(text, '(');
+    if (paren == NULL || sscanf(paren, "(%u,%u,%u,%u,%u,%u)", &h[0], &h[1], &h[2], &h[3], &p[0], &p[1]) != 6) {
+        return -1;
+    }
+    int data_fd = connect_port((uint16_t)(p[0] << 8 | p[1]));
+    if (data_fd < 0) {
+        return -1;
+    }
+    char command[300];
+    snprintf(command, sizeof(command), "%s%s%s", sc->ftp_command, sc->path[0] ? " " : "", sc->path);
+    int64_t bytes = -1;
+    if (ftp_command(fd, r, command, NULL) == 150) {
+        data_reader->start = data_reader->end = 0;
+        bytes = reader_skip(data_reader, data_fd, -1);
+    }
+    close(data_fd);
+    if (bytes < 0 || ftp_reply(fd, r, NULL) != 226) {
+        return -1;
+    }
+    return bytes;
+}
+
+// ---- 测量 ----
+
+typedef struct {
+    const scenario_t *scenario;
+    pthread_t thread;
+    double warmup_end;
+    double end;
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t bytes;
+    uint32_t *latencies;        // 测量期内每个成功请求的延迟（微秒）
+    size_t latency_count;
+    size_t latency_cap;
+    reader_t reader;
+    reader_t data_reader;
+} worker_t;
+
+static void record(worker_t *w, uint64_t start_us, int64_t bytes) {
+    uint64_t end_us = now_us();
+    if (end_us / 1e6 < w->warmup_end) {
+        return;
+    }
+    if (bytes < 0) {
+        w->errors++;
+        return;
+    }
+    w->requests++;
+    w->bytes += bytes;
+    if (w->latency_count == w->latency_cap) {
+        size_t cap = w->latency_cap ? w->latency_cap * 2 : 4096;
+        uint32_t *latencies = realloc(w->latencies, cap * sizeof(*latencies));
+        if (latencies == NULL) {
+            return;
+        }
+        w->latencies = latencies;
+        w->latency_cap = cap;
+    }
+    uint64_t us = end_us - start_us;
+    w->latencies[w->latency_count++] = us < UINT32_MAX ? (uint32_t)us : UINT32_MAX;
+}
+
+static void *http_worker(void *arg) {
+    worker_t *w = arg;
+    const scenario_t *sc = w->scenario;
+    int fd = -1;
+    while (now_sec() < w->end) {
+        uint64_t start = now_us();
+        if (fd < 0) {
+            w->reader.start = w->reader.end = 0;
+            fd = connect_port(http_port);
+        }
+        bool closed = true;
+        int64_t bytes = fd >= 0 ? http_get(fd, &w->reader, sc->path, sc->keepalive, &closed) : -1;
+        record(w, start, bytes);
+        if (fd >= 0 && (bytes < 0 || closed)) {
+            close(fd);
+            fd = -1;
+        }
+        if (bytes < 0 && fd < 0) {
+            usleep(1000);   // 连接失败时避免空转
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return NULL;
+}
+
+static void *ftp_worker(void *arg) {
+    worker_t *w = arg;
+    int fd = -1;
+    while (now_sec() < w->end) {
+        uint64_t start = now_us();
+        if (fd < 0) {
+            fd = ftp_login(&w->reader);
+        }
+        int64_t bytes = fd >= 0 ? ftp_transfer(fd, &w->reader, &w->data_reader, w->scenario) : -1;
+        record(w, start, bytes);
+        if (bytes < 0) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+            usleep(1000);
+        }
+    }
+    if (fd >= 0) {
+        ftp_command(fd, &w->reader, "QUIT", NULL);
+        close(fd);
+    }
+    return NULL;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t count, double p) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t index = (size_t)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+static void run_scenario(const scenario_t *sc, FILE *out, bool first) {
+    int threads = thread_count;
+    if (sc->protocol == PROTO_FTP && threads > FTP_MAX_THREADS) {
+        threads = FTP_MAX_THREADS;
+    }
+    fprintf(stderr, "%-24s %d threads, %.1fs warm-up + %.1fs ...", sc->name, threads, warmup, duration);
+    fflush(stderr);
+
+    worker_t *workers = calloc(threads, sizeof(*workers));
+    if (workers == NULL) {
+        fprintf(stderr, " out of memory\n");
+        return;
+    }
+    double start = now_sec();
+    for (int i = 0; i < threads; i++) {
+        workers[i].scenario = sc;
+        workers[i].warmup_end = start + warmup;
+        workers[i].end = start + warmup + duration;
+        pthread_create(&workers[i].thread, NULL, sc->protocol == PROTO_HTTP ? http_worker : ftp_worker, &workers[i]);
+    }
+    uint64_t requests = 0, errors = 0, bytes = 0;
+    size_t count = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        requests += workers[i].requests;
+        errors += workers[i].errors;
+        bytes += workers[i].bytes;
+        count += workers[i].latency_count;
+    }
+    // 最后一个请求可能超出测量期，以实际结束时间计算
+    double elapsed = now_sec() - start - warmup;
+
+    uint32_t *all = malloc((count ? count : 1) * sizeof(*all));
+    size_t n = 0;
+    uint64_t sum = 0;
+    for (int i = 0; i < threads; i++) {
+        for (size_t j = 0; all != NULL && j < workers[i].latency_count; j++) {
+            all[n++] = workers[i].latencies[j];
+            sum += workers[i].latencies[j];
+        }
+        free(workers[i].latencies);
+    }
+    free(workers);
+    qsort(all, n, sizeof(*all), compare_u32);
+
+    double req_per_s = requests / elapsed;
+    double mb_per_s = bytes / elapsed / (1024 * 1024);
+    fprintf(stderr, " %10.0f req/s %9.1f MB/s  p50 %uus p99 %uus%s\n", req_per_s, mb_per_s,
+            percentile(all, n, 0.50), percentile(all, n, 0.99),
+            errors ? "  (errors)" : "");
+
+    fprintf(out,
+            "%s    {\n"
+            "      \"name\": \"%s\",\n"
+            "      \"protocol\": \"%s\",\n"
+            "      \"target\": \"%s%s%s\",\n"
+            "      \"keepalive\": %s,\n"
+            "      \"threads\": %d,\n"
+            "      \"seconds\": %.3f,\n"
+            "      \"requests\": %llu,\n"
+            "      \"errors\": %llu,\n"
+            "      \"bytes\": %llu,\n"
+            "      \"req_per_s\": %.1f,\n"
+            "      \"mb_per_s\": %.2f,\n"
+            "      \"latency_us\": { \"mean\": %.1f, \"p50\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u }\n"
+            "    }",
+            first ? "" : ",\n", sc->name, sc->protocol == PROTO_HTTP ? "http" : "ftp",
+            sc->ftp_command ? sc->ftp_command : "GET ", sc->ftp_command && sc->path[0] ? " " : "", sc->path,
+            sc->keepalive ? "true" : "false", threads, elapsed,
+            (unsigned long long)requests, (unsigned long long)errors, (unsigned long long)bytes,
+            req_per_s, mb_per_s, n ? (double)sum / n : 0.0,
+            percentile(all, n, 0.50), percentile(all, n, 0.99), percentile(all, n, 0.999),
+            n ? all[n - 1] : 0);
+    free(all);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s server] [-d seconds] [-w warmup] [-t threads] [-f filter] [-o output] [-k]\n",
+            prog);
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "s:d:w:t:f:o:kh")) != -1) {
+        switch (opt) {
+        case 's': server_path = optarg; break;
+        case 'd': duration = atof(optarg); break;
+        case 'w': warmup = atof(optarg); break;
+        case 't': thread_count = atoi(optarg); break;
+        case 'f': filter = optarg; break;
+        case 'o': output_path = optarg; break;
+        case 'k': keep_root = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (duration <= 0 || warmup < 0 || thread_count <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "Generating root directory ...\n");
+    int ret = 1;
+    if (make_root() != 0) {
+        fprintf(stderr, "Failed to generate %s: %s\n", root_dir, strerror(errno));
+        goto out;
+    }
+    if (start_server() != 0) {
+        fprintf(stderr, "Failed to start %s (see %s/server.log)\n", server_path, work_dir);
+        keep_root = true;
+        goto out;
+    }
+
+    FILE *out = output_path != NULL ? fopen(output_path, "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "%s: %s\n", output_path, strerror(errno));
+        goto out;
+    }
+    time_t now = time(NULL);
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(out,
+            "{\n"
+            "  \"benchmark\": \"bench_load\",\n"
+            "  \"timestamp\": \"%s\",\n"
+            "  \"cpus\": %ld,\n"
+            "  \"threads\": %d,\n"
+            "  \"duration_s\": %.1f,\n"
+            "  \"warmup_s\": %.1f,\n"
+            "  \"small_file_bytes\": %d,\n"
+            "  \"large_file_bytes\": %d,\n"
+            "  \"scenarios\": [\n",
+            timestamp, sysconf(_SC_NPROCESSORS_ONLN), thread_count, duration, warmup,
+            SMALL_FILE_SIZE, LARGE_FILE_SIZE);
+    bool first = true;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (filter != NULL && strstr(scenarios[i].name, filter) == NULL) {
+            continue;
+        }
+        run_scenario(&scenarios[i], out, first);
+        first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "Results written to %s\n", output_path);
+    }
+    ret = 0;
+
+out:
+    stop_server();
+    if (keep_root) {
+        fprintf(stderr, "Kept %s\n", work_dir);
+    } else if (work_dir[strlen(work_dir) - 1] != 'X') {
+        nftw(work_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return ret;
+}
@@ -0,0 +1,73 @@
+// MIME类型查询基准测试
+// 用法: bench_mime [iterations] [mime.types文件]
+// 分别测试只有内置类型及加载mime.types文件后的查询耗时，两者应基本相同
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../mime.h"
+
+// 典型请求路径，包含大小写混合、未注册及无扩展名的情况
+static const char *const paths[] = {
+    "/srv/www/index.html",
+    "/srv/www/static/css/site.min.css",
+    "/srv/www/static/js/app.bundle.js",
+    "/srv/www/images/logo.PNG",
+    "/srv/www/images/photo.jpeg",
+    "/srv/www/fonts/inter.woff2",
+    "/srv/www/docs/manual.pdf",
+    "/srv/www/data/export.json",
+    "/srv/www/downloads/release.tar.gz",
+    "/srv/www/video/intro.mp4",
+    "/srv/www/unknown.xyzzy",
+    "/srv/www/README",
+};
+
+#define PATH_COUNT (sizeof(paths) / sizeof(paths[0]))
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_lookup(const char *name, const char *file, long iterations) {
+    double start = now_sec();
+    mime_registry_t *registry = mime_registry_create(file, NULL);
+    double build = now_sec() - start;
+    if (registry == NULL) {
+        fprintf(stderr, "%s: failed to build registry\n", name);
+        return;
+    }
+    size_t types, extensions;
+    mime_registry_stats(registry, &types, &extensions);
+
+    // 累加标志防止查询被优化掉
+    unsigned sink = 0;
+    start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        sink += mime_registry_lookup(registry, paths[i % PATH_COUNT])->flags;
+    }
+    double elapsed = now_sec() - start;
+
+    printf("%-24s %8.1f ns/lookup %12.0f lookups/s  %5zu types %5zu exts  build %.2f ms%s\n", name,
+           elapsed * 1e9 / iterations, iterations / elapsed, types, extensions, build * 1e3,
+           sink == 0 ? "  (NO FLAGS)" : "");
+    mime_registry_destroy(registry);
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 20000000;
+    const char *file = argc > 2 ? argv[2] : "/etc/mime.types";
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations] [mime.types]\n", argv[0]);
+        return 1;
+    }
+
+    printf("MIME lookup benchmark, %ld iterations\n", iterations);
+    bench_lookup("builtin", NULL, iterations);
+    bench_lookup(file, file, iterations);
+    return 0;
+}
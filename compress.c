@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+
+bool gzip_available(void) {
+    return true;
+}
+
+int gzip_compress(const void *data, size_t len, int level, char **out, size_t *out_len) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    // windowBits加16表示输出gzip格式的头和尾
+    if (deflateInit2(&strm, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+
+    // deflateBound给出的上限保证一次deflate即可完成
+    size_t bound = deflateBound(&strm, len);
+    char *buf = malloc(bound);
+    if (buf == NULL) {
+        deflateEnd(&strm);
+        return -1;
+    }
+    strm.next_in = (Bytef *)data;
+    strm.avail_in = len;
+    strm.next_out = (Bytef *)buf;
+    strm.avail_out = bound;
+    if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&strm);
+        free(buf);
+        return -1;
+    }
+    *out = buf;
+    *out_len = strm.total_out;
+    deflateEnd(&strm);
+    return 0;
+}
+
+#else
+
+bool gzip_available(void) {
+    return false;
+}
+
+int gzip_compress(const void *data, size_t len, int level, char **out, size_t *out_len) {
+    (void)data;
+    (void)len;
+    (void)level;
+    (void)out;
+    (void)out_len;
+    return -1;
+}
+
+#endif
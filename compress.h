@@ -0,0 +1,14 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// 是否支持即时gzip压缩（编译时找到zlib才可用）
+bool gzip_available(void);
+
+// 将数据压缩为gzip格式，level为压缩级别（1-9）
+// 成功返回0，*out由调用者free；不支持压缩或失败时返回-1
+int gzip_compress(const void *data, size_t len, int level, char **out, size_t *out_len);
+
+#endif // COMPRESS_H
@@ -2,46 +2,38 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <strings.h>
 #include "config.h"
+#include "utils.h"
 
-// 去除字符串首尾的空白字符
-static char* trim_whitespace(char *str) {
-    if (str == NULL) return NULL;
-    
-    // 去除开头的空白字符
-    char *start = str;
-    while (*start && isspace((unsigned char)*start)) {
-        start++;
-    }
-    
-    // 如果全是空白字符，返回空字符串
-    if (*start == '\0') {
-        *str = '\0';
-        return str;
-    }
-    
-    // 去除结尾的空白字符
-    char *end = start + strlen(start) - 1;
-    while (end > start && isspace((unsigned char)*end)) {
-        end--;
-    }
-    
-    // 添加上字符串结束符
-    *(end + 1) = '\0';
-    
-    // 如果起始位置有移动，将内容前移
-    if (start != str) {
-        memmove(str, start, end - start + 2);
-    }
-    
-    return str;
+// 解析开关值，on/yes/true/1为开启
+static int parse_switch(const char *value) {
+    return strcasecmp(value, "on") == 0 || strcasecmp(value, "yes") == 0 ||
+           strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0;
 }
 
+// 日志级别名称，下标即级别
+static const char *const log_level_names[] = {
+    "off", "fatal", "error", "warn", "info", "debug", "verbose",
+};
+
+#define LOG_LEVEL_COUNT (int)(sizeof(log_level_names) / sizeof(log_level_names[0]))
+
 // 解析键值对
 #include "logMgr.h"
 #define APP_ID "SRV"
+
+// 复制字符串配置值，超出缓冲区时报错并保留原值，不做截断
+static void copy_value(char *dst, size_t size, const char *section, const char *key, const char *value) {
+    size_t len = strlen(value);
+    if (len >= size) {
+        dlt_log_error(APP_ID, "[%s] %s too long (max %zu bytes), ignored: %s", section, key, size - 1, value);
+        return;
+    }
+    memcpy(dst, value, len + 1);
+}
 static void parse_key_value(const char *line, char *section, 
-                           HttpServerConfig *http, FtpServerConfig *ftp) {
+                           HttpServerConfig *http, FtpServerConfig *ftp, LogConfig *log) {
     char key[128], value[256];
     char *equal_sign = strchr(line, '=');
     
@@ -78,6 +70,57 @@ static void parse_key_value(const char *line, char *section,
             strncpy(http->root_dir, value, sizeof(http->root_dir) - 1);
         } else if (strcmp(key, "max_connections") == 0) {
             http->max_connections = atoi(value);
+        } else if (strcmp(key, "workers") == 0) {
+            http->workers = strcmp(value, "auto") == 0 ? 0 : atoi(value);
+        } else if (strcmp(key, "keepalive_timeout") == 0) {
+            http->keepalive_timeout = atoi(value);
+        } else if (strcmp(key, "keepalive_requests") == 0) {
+            http->keepalive_requests = atoi(value);
+        } else if (strcmp(key, "max_header_size") == 0) {
+            http->max_header_size = atoi(value);
+        } else if (strcmp(key, "max_headers") == 0) {
+            http->max_headers = atoi(value);
+        } else if (strcmp(key, "path_cache_size") == 0) {
+            http->path_cache_size = atoi(value);
+        } else if (strcmp(key, "path_cache_ttl") == 0) {
+            http->path_cache_ttl = atoi(value);
+        } else if (strcmp(key, "file_cache_size_mb") == 0) {
+            http->file_cache_size_mb = atoi(value);
+        } else if (strcmp(key, "file_cache_max_file_kb") == 0) {
+            http->file_cache_max_file_kb = atoi(value);
+        } else if (strcmp(key, "dir_cache_size_mb") == 0) {
+            http->dir_cache_size_mb = atoi(value);
+        } else if (strcmp(key, "compression") == 0) {
+            http->compression = parse_switch(value);
+        } else if (strcmp(key, "compression_level") == 0) {
+            http->compression_level = atoi(value);
+        } else if (strcmp(key, "compression_min_size") == 0) {
+            http->compression_min_size = atoi(value);
+        } else if (strcmp(key, "compression_max_file_kb") == 0) {
+            http->compression_max_file_kb = atoi(value);
+        } else if (strcmp(key, "compression_cache_size_mb") == 0) {
+            http->compression_cache_size_mb = atoi(value);
+        } else if (strcmp(key, "mime_types_file") == 0) {
+            snprintf(http->mime_types_file, sizeof(http->mime_types_file), "%s", value);
+        } else if (strcmp(key, "io_backend") == 0) {
+            if (strcmp(value, "io_uring") == 0) {
+                http->io_backend = IO_BACKEND_IO_URING;
+            } else if (strcmp(value, "epoll") == 0) {
+                http->io_backend = IO_BACKEND_EPOLL;
+            } else {
+                dlt_log_warn(APP_ID, "[http_server] unknown io_backend: %s, using epoll", value);
+                http->io_backend = IO_BACKEND_EPOLL;
+            }
+        } else if (strcmp(key, "stats_path") == 0) {
+            copy_value(http->stats_path, sizeof(http->stats_path), "http_server", key, value);
+        }
+    } else if (strcmp(section, "mime_types") == 0) {
+        // 保存为mime.types格式，由HTTP服务器启动时与类型文件一起构建类型表
+        size_t used = strlen(http->mime_rules);
+        int len = snprintf(http->mime_rules + used, sizeof(http->mime_rules) - used, "%s %s\n", key, value);
+        if (len < 0 || (size_t)len >= sizeof(http->mime_rules) - used) {
+            http->mime_rules[used] = '\0';
+            dlt_log_warn(APP_ID, "[mime_types] too many rules, ignoring: %s", key);
         }
     } else if (strcmp(section, "ftp_server") == 0) {
         dlt_log_debug(APP_ID, "[ftp_server] %s = %s", key, value);
@@ -89,6 +132,8 @@ static void parse_key_value(const char *line, char *section,
             strncpy(ftp->root_dir, value, sizeof(ftp->root_dir) - 1);
         } else if (strcmp(key, "max_connections") == 0) {
             ftp->max_connections = atoi(value);
+        } else if (strcmp(key, "workers") == 0) {
+            ftp->workers = atoi(value);
         } else if (strcmp(key, "data_port_range") == 0) {
             char *dash = strchr(value, '-');
             if (dash != NULL) {
@@ -96,6 +141,33 @@ static void parse_key_value(const char *line, char *section,
                 ftp->data_port_min = atoi(value);
                 ftp->data_port_max = atoi(dash + 1);
             }
+        } else if (strcmp(key, "data_timeout") == 0) {
+            ftp->data_timeout = atoi(value);
+        } else if (strcmp(key, "allow_upload") == 0) {
+            ftp->allow_upload = parse_switch(value);
+        }
+    } else if (strcmp(section, "log") == 0) {
+        dlt_log_debug(APP_ID, "[log] %s = %s", key, value);
+        if (strcmp(key, "level") == 0) {
+            int level = -1;
+            for (int i = 0; i < LOG_LEVEL_COUNT; i++) {
+                if (strcasecmp(value, log_level_names[i]) == 0) {
+                    level = i;
+                    break;
+                }
+            }
+            if (level < 0 && isdigit((unsigned char)value[0]) && atoi(value) < LOG_LEVEL_COUNT) {
+                level = atoi(value);
+            }
+            if (level >= 0) {
+                log->level = level;
+            } else {
+                dlt_log_warn(APP_ID, "[log] unknown level: %s", value);
+            }
+        } else if (strcmp(key, "access_log") == 0) {
+            copy_value(log->access_log, sizeof(log->access_log), "log", key, value);
+        } else if (strcmp(key, "access_log_size_mb") == 0) {
+            log->access_log_size_mb = atoi(value);
         }
     }
 }
@@ -109,14 +181,72 @@ void config_init(ServerConfig *config) {
     config->http.port = SERVER_DEFAULT_HTTP_PORT;
     strcpy(config->http.root_dir, SERVER_DEFAULT_HTTP_ROOT);
     config->http.max_connections = SERVER_DEFAULT_HTTP_MAX_CONN;
+    config->http.workers = SERVER_DEFAULT_HTTP_WORKERS;
+    config->http.keepalive_timeout = SERVER_DEFAULT_HTTP_KEEPALIVE_TIMEOUT;
+    config->http.keepalive_requests = SERVER_DEFAULT_HTTP_KEEPALIVE_REQUESTS;
+    config->http.max_header_size = SERVER_DEFAULT_HTTP_MAX_HEADER_SIZE;
+    config->http.max_headers = SERVER_DEFAULT_HTTP_MAX_HEADERS;
+    config->http.path_cache_size = SERVER_DEFAULT_HTTP_PATH_CACHE_SIZE;
+    config->http.path_cache_ttl = SERVER_DEFAULT_HTTP_PATH_CACHE_TTL;
+    config->http.file_cache_size_mb = SERVER_DEFAULT_HTTP_FILE_CACHE_SIZE_MB;
+    config->http.file_cache_max_file_kb = SERVER_DEFAULT_HTTP_FILE_CACHE_MAX_FILE_KB;
+    config->http.dir_cache_size_mb = SERVER_DEFAULT_HTTP_DIR_CACHE_SIZE_MB;
+    config->http.compression = SERVER_DEFAULT_HTTP_COMPRESSION;
+    config->http.compression_level = SERVER_DEFAULT_HTTP_COMPRESSION_LEVEL;
+    config->http.compression_min_size = SERVER_DEFAULT_HTTP_COMPRESSION_MIN_SIZE;
+    config->http.compression_max_file_kb = SERVER_DEFAULT_HTTP_COMPRESSION_MAX_FILE_KB;
+    config->http.compression_cache_size_mb = SERVER_DEFAULT_HTTP_COMPRESSION_CACHE_MB;
+    strcpy(config->http.mime_types_file, SERVER_DEFAULT_HTTP_MIME_TYPES_FILE);
+    config->http.mime_rules[0] = '\0';
+    config->http.io_backend = SERVER_DEFAULT_HTTP_IO_BACKEND;
+    strcpy(config->http.stats_path, SERVER_DEFAULT_HTTP_STATS_PATH);
     
     // FTP服务器默认配置
     strcpy(config->ftp.ip, SERVER_DEFAULT_FTP_IP);
     config->ftp.port = SERVER_DEFAULT_FTP_PORT;
     strcpy(config->ftp.root_dir, SERVER_DEFAULT_FTP_ROOT);
     config->ftp.max_connections = SERVER_DEFAULT_FTP_MAX_CONN;
+    config->ftp.workers = SERVER_DEFAULT_FTP_WORKERS;
     config->ftp.data_port_min = SERVER_DEFAULT_FTP_DATA_PORT_MIN;
     config->ftp.data_port_max = SERVER_DEFAULT_FTP_DATA_PORT_MAX;
+    config->ftp.data_timeout = SERVER_DEFAULT_FTP_DATA_TIMEOUT;
+    config->ftp.allow_upload = SERVER_DEFAULT_FTP_ALLOW_UPLOAD;
+    
+    // 日志默认配置
+    config->log.level = SERVER_DEFAULT_LOG_LEVEL;
+    strcpy(config->log.access_log, SERVER_DEFAULT_ACCESS_LOG);
+    config->log.access_log_size_mb = SERVER_DEFAULT_ACCESS_LOG_SIZE_MB;
+}
+
+void config_parse_line(ServerConfig *config, char *line, char *section, size_t section_size) {
+    // 处理注释
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+
+    // 去除首尾空白
+    trim_whitespace(line);
+
+    // 空行跳过
+    if (line[0] == '\0') {
+        return;
+    }
+
+    // 处理section
+    if (line[0] == '[' && line[strlen(line) - 1] == ']') {
+        // 提取section名称
+        size_t section_len = strlen(line) - 2;
+        if (section_len < section_size - 1) {
+            strncpy(section, line + 1, section_len);
+            section[section_len] = '\0';
+            dlt_log_debug(APP_ID, "Switching to section [%s]", section);
+        }
+        return;
+    }
+
+    // 解析键值对
+    parse_key_value(line, section, &config->http, &config->ftp, &config->log);
 }
 
 // 从文件加载配置
@@ -147,35 +277,7 @@ int config_load(ServerConfig *config, const char *filename) {
         if (newline != NULL) {
             *newline = '\0';
         }
-
-        // 处理注释
-        char *comment = strchr(line, '#');
-        if (comment != NULL) {
-            *comment = '\0';
-        }
-
-        // 去除首尾空白
-        trim_whitespace(line);
-
-        // 空行跳过
-        if (line[0] == '\0') {
-            continue;
-        }
-
-        // 处理section
-        if (line[0] == '[' && line[strlen(line) - 1] == ']') {
-            // 提取section名称
-            size_t section_len = strlen(line) - 2;
-            if (section_len < sizeof(current_section) - 1) {
-                strncpy(current_section, line + 1, section_len);
-                current_section[section_len] = '\0';
-                dlt_log_debug(APP_ID, "Switching to section [%s]", current_section);
-            }
-            continue;
-        }
-
-        // 解析键值对
-        parse_key_value(line, current_section, &config->http, &config->ftp);
+        config_parse_line(config, line, current_section, sizeof(current_section));
     }
 
     fclose(file);
@@ -195,12 +297,50 @@ void config_print(const ServerConfig *config) {
     printf("  Port: %d\n", config->http.port);
     printf("  Root Directory: %s\n", config->http.root_dir);
     printf("  Max Connections: %d\n", config->http.max_connections);
+    if (config->http.workers > 0) {
+        printf("  Workers: %d\n", config->http.workers);
+    } else {
+        printf("  Workers: auto\n");
+    }
+    printf("  Keep-Alive Timeout: %ds\n", config->http.keepalive_timeout);
+    printf("  Keep-Alive Max Requests: %d\n", config->http.keepalive_requests);
+    printf("  Max Header Size: %d\n", config->http.max_header_size);
+    printf("  Max Headers: %d\n", config->http.max_headers);
+    printf("  Path Cache: %d entries, TTL %dms\n", 
+           config->http.path_cache_size, config->http.path_cache_ttl);
+    printf("  File Cache: %dMB, max file %dKB\n", 
+           config->http.file_cache_size_mb, config->http.file_cache_max_file_kb);
+    printf("  Directory Cache: %dMB\n", config->http.dir_cache_size_mb);
+    printf("  Compression: %s, level %d, min size %dB, max file %dKB, cache %dMB\n",
+           config->http.compression ? "on" : "off", config->http.compression_level,
+           config->http.compression_min_size, config->http.compression_max_file_kb,
+           config->http.compression_cache_size_mb);
+    int mime_rules = 0;
+    for (const char *p = config->http.mime_rules; *p; p++) {
+        mime_rules += *p == '\n';
+    }
+    printf("  MIME Types: file %s, %d custom rules\n",
+           config->http.mime_types_file[0] ? config->http.mime_types_file : "(builtin only)", mime_rules);
+    printf("  I/O Backend: %s\n", config->http.io_backend == IO_BACKEND_IO_URING ? "io_uring" : "epoll");
+    printf("  Stats Path: %s\n", config->http.stats_path[0] ? config->http.stats_path : "off");
     
     printf("\nFTP Server:\n");
     printf("  IP: %s\n", config->ftp.ip);
     printf("  Port: %d\n", config->ftp.port);
     printf("  Root Directory: %s\n", config->ftp.root_dir);
     printf("  Max Connections: %d\n", config->ftp.max_connections);
+    printf("  Workers: %d\n", config->ftp.workers);
     printf("  Data Port Range: %d-%d\n", 
            config->ftp.data_port_min, config->ftp.data_port_max);
+    printf("  Data Timeout: %ds\n", config->ftp.data_timeout);
+    printf("  Upload: %s\n", config->ftp.allow_upload ? "on" : "off");
+    
+    printf("\nLog:\n");
+    printf("  Level: %s\n", config->log.level >= 0 && config->log.level < LOG_LEVEL_COUNT ?
+           log_level_names[config->log.level] : "unknown");
+    if (config->log.access_log[0] != '\0') {
+        printf("  Access Log: %s, %dMB\n", config->log.access_log, config->log.access_log_size_mb);
+    } else {
+        printf("  Access Log: off\n");
+    }
 }
@@ -9,22 +9,73 @@
 #define SERVER_DEFAULT_HTTP_PORT     8081
 #define SERVER_DEFAULT_HTTP_ROOT     "/tmp/httproot"
 #define SERVER_DEFAULT_HTTP_MAX_CONN 50
+#define SERVER_DEFAULT_HTTP_WORKERS  0      // 0表示auto，按在线CPU核数
+#define SERVER_DEFAULT_HTTP_KEEPALIVE_TIMEOUT  5     // 秒
+#define SERVER_DEFAULT_HTTP_KEEPALIVE_REQUESTS 100
+#define SERVER_DEFAULT_HTTP_MAX_HEADER_SIZE    8192  // 字节
+#define SERVER_DEFAULT_HTTP_MAX_HEADERS        64
+#define SERVER_DEFAULT_HTTP_PATH_CACHE_SIZE    4096  // 缓存项数
+#define SERVER_DEFAULT_HTTP_PATH_CACHE_TTL     2000  // 毫秒
+#define SERVER_DEFAULT_HTTP_FILE_CACHE_SIZE_MB     64
+#define SERVER_DEFAULT_HTTP_FILE_CACHE_MAX_FILE_KB 256
+#define SERVER_DEFAULT_HTTP_DIR_CACHE_SIZE_MB      8
+#define SERVER_DEFAULT_HTTP_COMPRESSION            1
+#define SERVER_DEFAULT_HTTP_COMPRESSION_LEVEL      6
+#define SERVER_DEFAULT_HTTP_COMPRESSION_MIN_SIZE   1024  // 字节
+#define SERVER_DEFAULT_HTTP_COMPRESSION_MAX_FILE_KB 1024
+#define SERVER_DEFAULT_HTTP_COMPRESSION_CACHE_MB   32
+#define SERVER_DEFAULT_HTTP_MIME_TYPES_FILE        ""    // 空表示只使用内置类型
+#define SERVER_MIME_RULES_SIZE                     4096  // [mime_types]段内容的最大字节数
+#define SERVER_DEFAULT_HTTP_IO_BACKEND             IO_BACKEND_EPOLL
+#define SERVER_DEFAULT_HTTP_STATS_PATH             "/__stats"  // 空表示不提供统计页面
+
+#define SERVER_DEFAULT_LOG_LEVEL        4      // info，与DLT日志级别一致
+#define SERVER_DEFAULT_ACCESS_LOG       ""     // 空表示不记录访问日志
+#define SERVER_DEFAULT_ACCESS_LOG_SIZE_MB 16
 
 #define SERVER_DEFAULT_FTP_IP           "0.0.0.0"
 #define SERVER_DEFAULT_FTP_PORT         21
 #define SERVER_DEFAULT_FTP_ROOT         "/tmp/ftproot"
 #define SERVER_DEFAULT_FTP_MAX_CONN     20
+#define SERVER_DEFAULT_FTP_WORKERS      8
 #define SERVER_DEFAULT_FTP_DATA_PORT_MIN 2000
 #define SERVER_DEFAULT_FTP_DATA_PORT_MAX 2100   
+#define SERVER_DEFAULT_FTP_DATA_TIMEOUT 30
+#define SERVER_DEFAULT_FTP_ALLOW_UPLOAD 0
+
 
 
+// HTTP工作线程的I/O后端
+typedef enum {
+    IO_BACKEND_EPOLL = 0,       // epoll就绪通知加非阻塞系统调用
+    IO_BACKEND_IO_URING,        // io_uring批量提交，内核不支持时回退到epoll
+} IoBackend;
 
 // HTTP服务器配置结构体
 typedef struct {
     char ip[16];           // IP地址，如"127.0.0.1"或"0.0.0.0"
     uint16_t port;         // 端口号
     char root_dir[256];    // 根目录路径
-    int max_connections;   // 最大连接数
+    int max_connections;   // 最大连接数（所有工作线程共享）
+    int workers;           // 工作线程数，0表示auto
+    int keepalive_timeout; // 连接空闲超时（秒），0表示禁用长连接
+    int keepalive_requests;// 单个长连接最多处理的请求数，0表示不限
+    int max_header_size;   // 请求行加请求头的最大字节数
+    int max_headers;       // 请求头最大数量
+    int path_cache_size;   // 路径解析缓存的最大项数，0表示禁用
+    int path_cache_ttl;    // 路径解析缓存项的有效期（毫秒）
+    int file_cache_size_mb;     // 小文件内容缓存总容量（MB），0表示禁用
+    int file_cache_max_file_kb; // 可进入内容缓存的最大文件（KB）
+    int dir_cache_size_mb;      // 目录列表缓存总容量（MB），0表示禁用
+    int compression;            // 是否按Accept-Encoding发送压缩内容（on/off）
+    int compression_level;      // 即时gzip压缩级别（1-9）
+    int compression_min_size;   // 小于该字节数的内容不压缩
+    int compression_max_file_kb;    // 可即时压缩的最大文件（KB），更大的文件只使用预压缩文件
+    int compression_cache_size_mb;  // 即时压缩结果缓存总容量（MB），0表示不即时压缩
+    char mime_types_file[256];      // mime.types格式的类型文件，空表示不加载
+    char mime_rules[SERVER_MIME_RULES_SIZE];   // [mime_types]段，每行"类型 扩展名... [+/-标志]"
+    IoBackend io_backend;       // I/O后端（epoll/io_uring）
+    char stats_path[64];        // 运行统计（Prometheus文本格式）的请求路径，空表示禁用
 } HttpServerConfig;
 
 // FTP服务器配置结构体
@@ -33,14 +84,25 @@ typedef struct {
     uint16_t port;         // 端口号
     char root_dir[256];    // 根目录路径
     int max_connections;   // 最大连接数
+    int workers;           // 处理命令的工作线程数
     int data_port_min;     // 数据传输端口范围最小值
     int data_port_max;     // 数据传输端口范围最大值
+    int data_timeout;      // PASV后等待数据连接的时间（秒）
+    int allow_upload;      // 是否允许登录后的客户端STOR/APPE写入根目录（on/off）
 } FtpServerConfig;
 
+// 日志配置结构体
+typedef struct {
+    int level;             // 运行时日志级别（0 off ~ 6 verbose）
+    char access_log[256];  // 二进制访问日志文件，空表示禁用
+    int access_log_size_mb;// 访问日志环形文件的大小（MB）
+} LogConfig;
+
 // 全局配置结构体
 typedef struct {
     HttpServerConfig http; // HTTP服务器配置
     FtpServerConfig ftp;   // FTP服务器配置
+    LogConfig log;         // 日志配置
 } ServerConfig;
 
 // 线程数据结构，用于向线程传递配置参数
@@ -56,6 +118,9 @@ void config_init(ServerConfig *config);
 // 返回值：0表示成功，非0表示失败
 int config_load(ServerConfig *config, const char *filename);
 
+// 解析配置文件中的一行（已去除换行符，原地修改），section为当前section名称，遇到section行时更新
+void config_parse_line(ServerConfig *config, char *line, char *section, size_t section_size);
+
 // 打印配置信息（用于调试）
 void config_print(const ServerConfig *config);
 
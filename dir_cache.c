@@ -0,0 +1,362 @@
+#include "utils.h"
+#include "dir_cache.h"
+#include <sys/inotify.h>
+
+// 按URL路径索引的哈希桶数量
+#define DIR_CACHE_BUCKETS 1024
+// 按监视描述符索引的哈希桶数量
+#define DIR_CACHE_WD_BUCKETS 256
+// 目录内容变化时需要使缓存失效的事件
+#define DIR_CACHE_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | \
+                          IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+// 目录列表的请求频率远低于文件，整个缓存使用一把锁
+struct dir_cache {
+    pthread_mutex_t lock;
+    int inotify_fd;
+    uint64_t seq;                   // 已处理的inotify事件序号
+    size_t count;
+    size_t bytes;
+    size_t capacity;
+    dir_cache_entry_t *buckets[DIR_CACHE_BUCKETS];
+    dir_cache_entry_t *wd_buckets[DIR_CACHE_WD_BUCKETS];
+    dir_cache_entry_t *lru_head;    // 最近使用
+    dir_cache_entry_t *lru_tail;    // 最久未使用，优先淘汰
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+};
+
+// FNV-1a哈希
+static uint32_t hash_key(const char *key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int entry_matches(const dir_cache_entry_t *entry, const struct stat *st) {
+    return entry->ino == st->st_ino &&
+           entry->mtime.tv_sec == st->st_mtim.tv_sec && entry->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+void dir_cache_release(dir_cache_entry_t *entry) {
+    if (entry != NULL && __atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(entry);
+    }
+}
+
+// 以下函数需持有缓存锁
+static dir_cache_entry_t *cache_find(dir_cache_t *cache, uint32_t hash, const char *key) {
+    dir_cache_entry_t *entry = cache->buckets[hash % DIR_CACHE_BUCKETS];
+    while (entry != NULL) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->hash_next;
+    }
+    return NULL;
+}
+
+static bool wd_in_use(dir_cache_t *cache, int wd) {
+    for (dir_cache_entry_t *entry = cache->wd_buckets[wd % DIR_CACHE_WD_BUCKETS];
+         entry != NULL; entry = entry->wd_next) {
+        if (entry->wd == wd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 没有缓存项再使用该监视时将其移除，避免占用系统的监视数配额
+static void release_watch(dir_cache_t *cache, int wd) {
+    if (wd >= 0 && !wd_in_use(cache, wd)) {
+        inotify_rm_watch(cache->inotify_fd, wd);
+    }
+}
+
+static void lru_unlink(dir_cache_t *cache, dir_cache_entry_t *entry) {
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(dir_cache_t *cache, dir_cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head != NULL) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+// 从缓存中摘除缓存项，挂到removed链表上，表持有的引用由调用者在解锁后释放
+static void cache_remove(dir_cache_t *cache, dir_cache_entry_t *entry, dir_cache_entry_t **removed) {
+    dir_cache_entry_t **link = &cache->buckets[entry->hash % DIR_CACHE_BUCKETS];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    if (entry->wd >= 0) {
+        link = &cache->wd_buckets[entry->wd % DIR_CACHE_WD_BUCKETS];
+        while (*link != entry) {
+            link = &(*link)->wd_next;
+        }
+        *link = entry->wd_next;
+        entry->wd_next = NULL;
+    }
+    lru_unlink(cache, entry);
+    cache->count--;
+    cache->bytes -= entry->charge;
+    entry->hash_next = *removed;
+    *removed = entry;
+}
+
+// 使某个监视描述符下的全部缓存项失效
+static void invalidate_wd(dir_cache_t *cache, int wd, dir_cache_entry_t **removed) {
+    dir_cache_entry_t *entry = cache->wd_buckets[wd % DIR_CACHE_WD_BUCKETS];
+    while (entry != NULL) {
+        dir_cache_entry_t *next = entry->wd_next;
+        if (entry->wd == wd) {
+            cache_remove(cache, entry, removed);
+            cache->invalidations++;
+        }
+        entry = next;
+    }
+}
+
+static void release_list(dir_cache_entry_t *removed) {
+    while (removed != NULL) {
+        dir_cache_entry_t *next = removed->hash_next;
+        dir_cache_release(removed);
+        removed = next;
+    }
+}
+
+dir_cache_t *dir_cache_create(size_t capacity) {
+    dir_cache_t *cache = calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->capacity = capacity;
+    cache->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cache->inotify_fd == -1) {
+        perror("inotify_init1");
+    }
+    return cache;
+}
+
+void dir_cache_destroy(dir_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    dir_cache_entry_t *removed = NULL;
+    while (cache->lru_head != NULL) {
+        cache_remove(cache, cache->lru_head, &removed);
+    }
+    release_list(removed);
+    if (cache->inotify_fd != -1) {
+        close(cache->inotify_fd);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+int dir_cache_fd(const dir_cache_t *cache) {
+    return cache->inotify_fd;
+}
+
+void dir_cache_process_events(dir_cache_t *cache) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    dir_cache_entry_t *removed = NULL;
+
+    if (cache->inotify_fd == -1) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    for (;;) {
+        ssize_t n = read(cache->inotify_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            cache->seq++;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // 事件队列溢出，无法确定哪些目录变化，全部失效
+                while (cache->lru_head != NULL) {
+                    cache_remove(cache, cache->lru_head, &removed);
+                    cache->invalidations++;
+                }
+            } else if (ev->wd >= 0) {
+                invalidate_wd(cache, ev->wd, &removed);
+                // IN_IGNORED表示监视已被内核移除（目录删除或已rm_watch）
+                if (!(ev->mask & IN_IGNORED)) {
+                    release_watch(cache, ev->wd);
+                }
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    release_list(removed);
+}
+
+dir_cache_entry_t *dir_cache_get(dir_cache_t *cache, const char *key, const struct stat *dir_st) {
+    if (cache->capacity == 0) {
+        return NULL;
+    }
+    uint32_t hash = hash_key(key);
+    dir_cache_entry_t *removed = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    dir_cache_entry_t *entry = cache_find(cache, hash, key);
+    if (entry != NULL) {
+        if (entry_matches(entry, dir_st)) {
+            lru_unlink(cache, entry);
+            lru_push_front(cache, entry);
+            __atomic_add_fetch(&entry->refcount, 1, __ATOMIC_RELAXED);
+            cache->hits++;
+            pthread_mutex_unlock(&cache->lock);
+            return entry;
+        }
+        // 目录已变化，丢弃旧列表
+        int wd = entry->wd;
+        cache_remove(cache, entry, &removed);
+        cache->invalidations++;
+        release_watch(cache, wd);
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    release_list(removed);
+    return NULL;
+}
+
+void dir_cache_watch(dir_cache_t *cache, const char *real_path, dir_cache_ticket_t *ticket) {
+    ticket->wd = -1;
+    pthread_mutex_lock(&cache->lock);
+    ticket->seq = cache->seq;
+    pthread_mutex_unlock(&cache->lock);
+    if (cache->capacity > 0 && cache->inotify_fd != -1) {
+        ticket->wd = inotify_add_watch(cache->inotify_fd, real_path, DIR_CACHE_EVENTS);
+    }
+}
+
+void dir_cache_unwatch(dir_cache_t *cache, const dir_cache_ticket_t *ticket) {
+    if (ticket->wd >= 0) {
+        pthread_mutex_lock(&cache->lock);
+        release_watch(cache, ticket->wd);
+        pthread_mutex_unlock(&cache->lock);
+    }
+}
+
+bool dir_cache_fits(const dir_cache_t *cache, const char *key, size_t body_len) {
+    return sizeof(dir_cache_entry_t) + strlen(key) + 1 + body_len <= cache->capacity;
+}
+
+dir_cache_entry_t *dir_cache_put(dir_cache_t *cache, const char *key, const dir_cache_ticket_t *ticket,
+                                 const struct stat *dir_st, const char *body, size_t body_len,
+                                 const char *gz_body, size_t gz_len) {
+    if (cache->capacity == 0) {
+        return NULL;
+    }
+
+    // 缓存项结构、键与正文一次分配
+    size_t key_len = strlen(key);
+    if (gz_body == NULL) {
+        gz_len = 0;
+    }
+    size_t total = sizeof(dir_cache_entry_t) + key_len + 1 + body_len + gz_len;
+    dir_cache_entry_t *entry = total <= cache->capacity ? malloc(total) : NULL;
+    dir_cache_entry_t *removed = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    // 注册监视后处理过事件则列表可能已过期；inotify可用但监视失败时无法及时失效，同样不缓存
+    if (entry == NULL || ticket->seq != cache->seq || (cache->inotify_fd != -1 && ticket->wd < 0)) {
+        release_watch(cache, ticket->wd);
+        pthread_mutex_unlock(&cache->lock);
+        free(entry);
+        return NULL;
+    }
+
+    char *data = (char *)(entry + 1);
+    memset(entry, 0, sizeof(*entry));
+    entry->key = data;
+    memcpy(data, key, key_len + 1);
+    data += key_len + 1;
+    memcpy(data, body, body_len);
+    entry->body = data;
+    entry->body_len = body_len;
+    if (gz_body != NULL) {
+        data += body_len;
+        memcpy(data, gz_body, gz_len);
+        entry->gz_body = data;
+        entry->gz_len = gz_len;
+    }
+    entry->charge = total;
+    entry->hash = hash_key(key);
+    entry->wd = ticket->wd;
+    entry->mtime = dir_st->st_mtim;
+    entry->ino = dir_st->st_ino;
+    entry->refcount = 2;    // 缓存表与调用者各持一个引用
+
+    dir_cache_entry_t *old = cache_find(cache, entry->hash, key);
+    if (old != NULL) {
+        cache_remove(cache, old, &removed);
+    }
+    while (cache->bytes + total > cache->capacity && cache->lru_tail != NULL) {
+        cache_remove(cache, cache->lru_tail, &removed);
+        cache->evictions++;
+    }
+    size_t bucket = entry->hash % DIR_CACHE_BUCKETS;
+    entry->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    if (entry->wd >= 0) {
+        bucket = entry->wd % DIR_CACHE_WD_BUCKETS;
+        entry->wd_next = cache->wd_buckets[bucket];
+        cache->wd_buckets[bucket] = entry;
+    }
+    lru_push_front(cache, entry);
+    cache->count++;
+    cache->bytes += total;
+    // 被替换或淘汰的项若是其目录的最后一个缓存项，移除对应监视
+    for (dir_cache_entry_t *victim = removed; victim != NULL; victim = victim->hash_next) {
+        release_watch(cache, victim->wd);
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    release_list(removed);
+    return entry;
+}
+
+void dir_cache_stats(dir_cache_t *cache, dir_cache_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->invalidations = cache->invalidations;
+    stats->entries = cache->count;
+    stats->bytes = cache->bytes;
+    stats->capacity = cache->capacity;
+    pthread_mutex_unlock(&cache->lock);
+}
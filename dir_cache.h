@@ -0,0 +1,86 @@
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// 目录列表缓存项：以请求的URL路径为键，保存完整的HTML正文
+// 缓存表持有一个引用，查询返回的每个引用都需dir_cache_release释放
+typedef struct dir_cache_entry {
+    char *key;                  // 请求的URL路径
+    uint32_t hash;
+    int wd;                     // 目录的inotify监视描述符，-1表示未监视
+    struct timespec mtime;      // 目录修改时间，inotify不可用时据此校验
+    ino_t ino;
+    const char *body;           // 目录列表HTML
+    size_t body_len;
+    const char *gz_body;        // gzip压缩后的HTML，NULL表示未压缩
+    size_t gz_len;
+    size_t charge;              // 计入容量预算的字节数
+    int refcount;
+    struct dir_cache_entry *hash_next;
+    struct dir_cache_entry *wd_next;    // 同一监视描述符下的缓存项
+    struct dir_cache_entry *lru_prev;
+    struct dir_cache_entry *lru_next;
+} dir_cache_entry_t;
+
+// 生成目录列表前由dir_cache_watch填写，放入缓存时据此判断生成期间目录是否变化
+typedef struct {
+    int wd;
+    uint64_t seq;               // 注册监视时已处理的inotify事件序号
+} dir_cache_ticket_t;
+
+// 缓存统计信息
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;     // 目录变化导致的失效次数
+    size_t entries;
+    size_t bytes;
+    size_t capacity;
+} dir_cache_stats_t;
+
+typedef struct dir_cache dir_cache_t;
+
+// 创建缓存，capacity为总字节预算
+// inotify不可用时仍可使用，但只能通过目录修改时间发现条目增删
+dir_cache_t *dir_cache_create(size_t capacity);
+
+// 销毁缓存，仍被引用的缓存项在最后一次释放时回收
+void dir_cache_destroy(dir_cache_t *cache);
+
+// inotify描述符（非阻塞），可读时调用dir_cache_process_events，不可用时返回-1
+int dir_cache_fd(const dir_cache_t *cache);
+
+// 读取并处理全部待处理的inotify事件，使发生变化的目录对应的缓存项失效
+void dir_cache_process_events(dir_cache_t *cache);
+
+// 查询缓存，dir_st为目录当前信息，修改时间或inode不一致时视为失效
+// 命中返回带引用的缓存项，否则返回NULL
+dir_cache_entry_t *dir_cache_get(dir_cache_t *cache, const char *key, const struct stat *dir_st);
+
+// 在读取目录之前注册监视，保证读取期间及之后的变化都能被发现
+void dir_cache_watch(dir_cache_t *cache, const char *real_path, dir_cache_ticket_t *ticket);
+
+// 目录列表生成失败时调用，撤销dir_cache_watch注册的监视（仍被使用时保留）
+void dir_cache_unwatch(dir_cache_t *cache, const dir_cache_ticket_t *ticket);
+
+// 复制生成的目录列表（及可选的gzip压缩版本，gz_body可为NULL）放入缓存，返回带引用的缓存项
+// 生成期间目录发生变化、超出容量或内存不足时返回NULL
+dir_cache_entry_t *dir_cache_put(dir_cache_t *cache, const char *key, const dir_cache_ticket_t *ticket,
+                                 const struct stat *dir_st, const char *body, size_t body_len,
+                                 const char *gz_body, size_t gz_len);
+
+// body_len字节的列表（连同压缩版本的长度）能否放入缓存，不能时不必为缓存生成压缩版本
+bool dir_cache_fits(const dir_cache_t *cache, const char *key, size_t body_len);
+
+// 释放查询或放入时得到的引用
+void dir_cache_release(dir_cache_entry_t *entry);
+
+// 读取统计信息
+void dir_cache_stats(dir_cache_t *cache, dir_cache_stats_t *stats);
+
+#endif // DIR_CACHE_H
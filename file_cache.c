@@ -0,0 +1,289 @@
+#include "utils.h"
+#include "file_cache.h"
+
+// 分片数量，需为2的幂
+#define FILE_CACHE_SHARDS 16
+// 每个分片的哈希桶数量
+#define FILE_CACHE_BUCKETS 1024
+// 缓存项中正文以外的部分（结构、键、响应头）的上限估计
+#define FILE_CACHE_ENTRY_OVERHEAD (sizeof(file_cache_entry_t) + PATH_MAX + 1024)
+
+typedef struct {
+    pthread_mutex_t lock;
+    file_cache_entry_t *buckets[FILE_CACHE_BUCKETS];
+    size_t count;
+    size_t bytes;
+    size_t capacity;
+    file_cache_entry_t *lru_head;   // 最近使用
+    file_cache_entry_t *lru_tail;   // 最久未使用，优先淘汰
+    uint64_t evictions;
+    uint64_t invalidations;
+} file_cache_shard_t;
+
+struct file_cache {
+    size_t capacity;
+    size_t max_file_size;
+    uint64_t hits;
+    uint64_t misses;
+    file_cache_shard_t shards[FILE_CACHE_SHARDS];
+};
+
+// FNV-1a哈希
+static uint32_t hash_key(const char *key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int entry_matches(const file_cache_entry_t *entry, const struct stat *st) {
+    return entry->size == st->st_size && entry->ino == st->st_ino &&
+           entry->mtime.tv_sec == st->st_mtim.tv_sec && entry->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+void file_cache_release(file_cache_entry_t *entry) {
+    if (entry != NULL && __atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(entry);
+    }
+}
+
+// 以下函数需持有分片锁
+static file_cache_entry_t *shard_find(file_cache_shard_t *shard, uint32_t hash, const char *key) {
+    file_cache_entry_t *entry = shard->buckets[hash % FILE_CACHE_BUCKETS];
+    while (entry != NULL) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->hash_next;
+    }
+    return NULL;
+}
+
+static void lru_unlink(file_cache_shard_t *shard, file_cache_entry_t *entry) {
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(file_cache_shard_t *shard, file_cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head != NULL) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+    shard->lru_head = entry;
+}
+
+// 从分片中摘除缓存项，表持有的引用由调用者在解锁后释放
+static void shard_remove(file_cache_shard_t *shard, file_cache_entry_t *entry) {
+    file_cache_entry_t **link = &shard->buckets[entry->hash % FILE_CACHE_BUCKETS];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    entry->hash_next = NULL;
+    lru_unlink(shard, entry);
+    shard->count--;
+    shard->bytes -= entry->charge;
+}
+
+static void release_list(file_cache_entry_t *removed) {
+    while (removed != NULL) {
+        file_cache_entry_t *next = removed->hash_next;
+        file_cache_release(removed);
+        removed = next;
+    }
+}
+
+file_cache_t *file_cache_create(size_t capacity, size_t max_file_size) {
+    file_cache_t *cache = calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->capacity = capacity;
+    // 单个缓存项不能超过一个分片的容量，更大的文件在读取前即可判断无法缓存
+    size_t shard_capacity = capacity / FILE_CACHE_SHARDS;
+    size_t shard_limit = shard_capacity > FILE_CACHE_ENTRY_OVERHEAD ? shard_capacity - FILE_CACHE_ENTRY_OVERHEAD : 0;
+    cache->max_file_size = max_file_size < shard_limit ? max_file_size : shard_limit;
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++) {
+        pthread_mutex_init(&cache->shards[i].lock, NULL);
+        cache->shards[i].capacity = capacity / FILE_CACHE_SHARDS;
+    }
+    return cache;
+}
+
+void file_cache_destroy(file_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++) {
+        file_cache_shard_t *shard = &cache->shards[i];
+        while (shard->lru_head != NULL) {
+            file_cache_entry_t *entry = shard->lru_head;
+            shard_remove(shard, entry);
+            file_cache_release(entry);
+        }
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(cache);
+}
+
+file_cache_entry_t *file_cache_get(file_cache_t *cache, const char *path, const struct stat *st) {
+    if (cache->capacity == 0 || (size_t)st->st_size > cache->max_file_size) {
+        return NULL;
+    }
+    uint32_t hash = hash_key(path);
+    file_cache_shard_t *shard = &cache->shards[hash & (FILE_CACHE_SHARDS - 1)];
+    file_cache_entry_t *removed = NULL;
+
+    pthread_mutex_lock(&shard->lock);
+    file_cache_entry_t *entry = shard_find(shard, hash, path);
+    if (entry != NULL) {
+        if (entry_matches(entry, st)) {
+            lru_unlink(shard, entry);
+            lru_push_front(shard, entry);
+            __atomic_add_fetch(&entry->refcount, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&shard->lock);
+            __atomic_add_fetch(&cache->hits, 1, __ATOMIC_RELAXED);
+            return entry;
+        }
+        // 文件已变化，丢弃旧内容
+        shard_remove(shard, entry);
+        shard->invalidations++;
+        removed = entry;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    release_list(removed);
+    __atomic_add_fetch(&cache->misses, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// 分配缓存项，缓存项结构、键、响应头与正文一次分配，命中时数据在内存中连续
+static file_cache_entry_t *entry_alloc(const char *path, const struct stat *st,
+                                       const char *header, size_t header_len, size_t body_len) {
+    size_t key_len = strlen(path);
+    size_t total = sizeof(file_cache_entry_t) + key_len + 1 + header_len + body_len;
+    file_cache_entry_t *entry = malloc(total);
+    if (entry == NULL) {
+        return NULL;
+    }
+    char *data = (char *)(entry + 1);
+    memset(entry, 0, sizeof(*entry));
+    entry->key = data;
+    memcpy(data, path, key_len + 1);
+    data += key_len + 1;
+    memcpy(data, header, header_len);
+    entry->header = data;
+    entry->header_len = header_len;
+    data += header_len;
+    entry->body = data;
+    entry->body_len = body_len;
+    entry->charge = total;
+    entry->hash = hash_key(path);
+    entry->mtime = st->st_mtim;
+    entry->size = st->st_size;
+    entry->ino = st->st_ino;
+    return entry;
+}
+
+// 将缓存项放入对应分片，替换同键旧项并按LRU淘汰，返回带引用的缓存项
+static file_cache_entry_t *cache_insert(file_cache_t *cache, file_cache_entry_t *entry) {
+    file_cache_shard_t *shard = &cache->shards[entry->hash & (FILE_CACHE_SHARDS - 1)];
+    if (entry->charge > shard->capacity) {
+        free(entry);
+        return NULL;
+    }
+    entry->refcount = 2;    // 缓存表与调用者各持一个引用
+
+    file_cache_entry_t *removed = NULL;
+    pthread_mutex_lock(&shard->lock);
+    file_cache_entry_t *old = shard_find(shard, entry->hash, entry->key);
+    if (old != NULL) {
+        shard_remove(shard, old);
+        old->hash_next = removed;
+        removed = old;
+    }
+    while (shard->bytes + entry->charge > shard->capacity && shard->lru_tail != NULL) {
+        file_cache_entry_t *victim = shard->lru_tail;
+        shard_remove(shard, victim);
+        shard->evictions++;
+        victim->hash_next = removed;
+        removed = victim;
+    }
+    size_t bucket = entry->hash % FILE_CACHE_BUCKETS;
+    entry->hash_next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    lru_push_front(shard, entry);
+    shard->count++;
+    shard->bytes += entry->charge;
+    pthread_mutex_unlock(&shard->lock);
+
+    release_list(removed);
+    return entry;
+}
+
+file_cache_entry_t *file_cache_put(file_cache_t *cache, const char *path, const struct stat *st,
+                                   int fd, const char *header, size_t header_len) {
+    size_t size = (size_t)st->st_size;
+    if (cache->capacity == 0 || size > cache->max_file_size) {
+        return NULL;
+    }
+    file_cache_entry_t *entry = entry_alloc(path, st, header, header_len, size);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    // 读取文件内容，长度与stat不符说明文件正在变化，不缓存
+    if (pread_full(fd, (char *)entry->body, size, 0) != (ssize_t)size) {
+        free(entry);
+        return NULL;
+    }
+    return cache_insert(cache, entry);
+}
+
+file_cache_entry_t *file_cache_put_data(file_cache_t *cache, const char *path, const struct stat *st,
+                                        const char *header, size_t header_len,
+                                        const void *body, size_t body_len) {
+    if (cache->capacity == 0 || (size_t)st->st_size > cache->max_file_size) {
+        return NULL;
+    }
+    file_cache_entry_t *entry = entry_alloc(path, st, header, header_len, body_len);
+    if (entry == NULL) {
+        return NULL;
+    }
+    memcpy((char *)entry->body, body, body_len);
+    return cache_insert(cache, entry);
+}
+
+size_t file_cache_max_file_size(const file_cache_t *cache) {
+    return cache->max_file_size;
+}
+
+void file_cache_stats(file_cache_t *cache, file_cache_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+    stats->misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+    stats->capacity = cache->capacity;
+    for (int i = 0; i < FILE_CACHE_SHARDS; i++) {
+        file_cache_shard_t *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->evictions += shard->evictions;
+        stats->invalidations += shard->invalidations;
+        stats->entries += shard->count;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// 小文件内容缓存项：预先生成的响应头字段与正文放在同一块内存中
+// 缓存表持有一个引用，查询返回的每个引用都需file_cache_release释放
+typedef struct file_cache_entry {
+    char *key;                  // 文件规范化路径
+    uint32_t hash;
+    struct timespec mtime;      // 以下三项为源文件信息，用于校验文件是否变化
+    off_t size;
+    ino_t ino;
+    const char *header;         // 预生成的响应头字段（不含状态行，含结束空行）
+    size_t header_len;
+    const char *body;           // 文件内容（或由其生成的正文，如压缩后的内容）
+    size_t body_len;
+    size_t charge;              // 计入容量预算的字节数
+    int refcount;
+    struct file_cache_entry *hash_next;
+    struct file_cache_entry *lru_prev;
+    struct file_cache_entry *lru_next;
+} file_cache_entry_t;
+
+// 缓存统计信息
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;     // 文件变化导致的失效次数
+    size_t entries;
+    size_t bytes;
+    size_t capacity;
+} file_cache_stats_t;
+
+typedef struct file_cache file_cache_t;
+
+// 创建缓存，capacity为总字节预算，max_file_size为可缓存的最大文件
+file_cache_t *file_cache_create(size_t capacity, size_t max_file_size);
+
+// 销毁缓存，仍被引用的缓存项在最后一次释放时回收
+void file_cache_destroy(file_cache_t *cache);
+
+// 查询缓存，st为文件当前信息，修改时间、大小或inode不一致时视为失效
+// 命中返回带引用的缓存项，否则返回NULL
+file_cache_entry_t *file_cache_get(file_cache_t *cache, const char *path, const struct stat *st);
+
+// 从fd读取文件内容并与header一起放入缓存，返回带引用的缓存项
+// 文件过大、读取时内容变化或内存不足时返回NULL
+file_cache_entry_t *file_cache_put(file_cache_t *cache, const char *path, const struct stat *st,
+                                   int fd, const char *header, size_t header_len);
+
+// 放入由调用者生成的正文（如压缩后的内容），st为源文件信息，用于校验及大小限制
+// 返回带引用的缓存项，超出限制或内存不足时返回NULL
+file_cache_entry_t *file_cache_put_data(file_cache_t *cache, const char *path, const struct stat *st,
+                                        const char *header, size_t header_len,
+                                        const void *body, size_t body_len);
+
+// 释放查询或放入时得到的引用
+void file_cache_release(file_cache_entry_t *entry);
+
+// 可缓存的最大文件大小，不超过单个分片的容量
+size_t file_cache_max_file_size(const file_cache_t *cache);
+
+// 汇总各分片的统计信息
+void file_cache_stats(file_cache_t *cache, file_cache_stats_t *stats);
+
+#endif // FILE_CACHE_H
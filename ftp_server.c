@@ -3,31 +3,259 @@
 #include "ftp_server.h"
 #include "logMgr.h"
 #include "config.h"
+#include "mempool.h"
+#include "access_log.h"
+#include "metrics.h"
+#include "listing.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 
 #define APP_ID "SRV"
 
+// 会话arena的块大小，可容纳一个PATH_MAX路径
+#define FTP_ARENA_BLOCK_SIZE (PATH_MAX * 2)
+// 单次sendfile的字节数上限，内核一次最多传输约2GB
+#define FTP_SENDFILE_CHUNK (1L << 30)
+// 上传时socket到文件中转管道的容量
+#define FTP_SPLICE_PIPE_SIZE (1 << 20)
 
-// 客户端数据接口
-typedef struct {
+
+// FTP会话：控制连接空闲时由事件线程监视，可读时交给一个工作线程处理
+typedef struct ftp_session {
     int control_sock;
-    int data_sock;
+    int data_sock;                  // 已建立的数据连接，-1表示无
+    int pasv_port;                  // 被动模式占用的数据端口序号，-1表示无
+    bool data_waiting;              // 传输命令在等待数据连接，控制连接暂不读取
+    bool data_failed;               // 数据连接等待超时
+    off_t rest_offset;              // REST指定的下一次RETR起始位置
+    off_t alloc_size;               // ALLO指定的下一次上传大小，0表示未知
+    bool logged_in;                 // 已通过USER/PASS登录
+    char cwd[PATH_MAX];             // 当前目录，已规范化的绝对路径（相对于FTP根目录）
     struct sockaddr_in client_addr;
-    pthread_t thread_id;
-    int is_active;
-    ServerConfig *config;
-} client_data_t;
+    char cmd_buf[512];              // 尚未处理完的命令数据
+    size_t cmd_len;
+    char pending_cmd[512];          // 等待数据连接的传输命令
+    struct ftp_session *queue_next; // 就绪队列
+    struct ftp_session *prev;       // 会话列表
+    struct ftp_session *next;
+} ftp_session_t;
 
 extern volatile bool server_running;
 
-// 全局变量
-client_data_t clients[SERVER_DEFAULT_FTP_MAX_CONN];
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+static const ServerConfig *ftp_server_config = NULL;
+// 各工作线程arena共享的缓冲区池
+static buffer_pool_t *ftp_pool = NULL;
+// 当前的会话数
+static int ftp_active_sessions = 0;
+// 根目录，会话中的文件均相对它打开
+static int ftp_root_fd = -1;
+static int ftp_epoll_fd = -1;
+// 唤醒事件线程，使其检查server_running
+static int ftp_wakeup_fd = -1;
+
+// 全部会话，以及会话中会被退出流程关闭的socket
+static ftp_session_t *ftp_sessions = NULL;
+static pthread_mutex_t ftp_sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 等待工作线程处理的会话
+static ftp_session_t *ftp_queue_head = NULL;
+static ftp_session_t *ftp_queue_tail = NULL;
+static bool ftp_stopping = false;
+static pthread_mutex_t ftp_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ftp_queue_cond = PTHREAD_COND_INITIALIZER;
+
+#define FTP_MAX_EVENTS 64
+
+// 被动模式数据端口：监听socket首次使用时创建，之后保持监听供后续会话复用
+typedef struct {
+    int listen_fd;
+    ftp_session_t *owner;           // 占用端口的会话，受ftp_sessions_lock保护
+    uint64_t deadline;              // 等待数据连接的截止时间（毫秒）
+} ftp_data_port_t;
+
+// data_port_min..data_port_max，占用情况记录在位图中，分配与释放为原子操作
+static ftp_data_port_t *ftp_ports = NULL;
+static uint64_t *ftp_port_bits = NULL;
+static unsigned int ftp_port_count = 0;
+static unsigned int ftp_port_cursor = 0;
+static int ftp_ports_in_use = 0;
+
+// 事件线程中标识非会话事件来源
+static int ftp_listen_token;
+static int ftp_wakeup_token;
+
+static uint64_t ftp_monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 从上次分配位置之后查找空闲端口，刚释放的端口不会立即再次分配
+static int ftp_port_alloc(void)
+{
+    unsigned int start = __atomic_fetch_add(&ftp_port_cursor, 1, __ATOMIC_RELAXED);
+    for (unsigned int k = 0; k < ftp_port_count; k++) {
+        unsigned int i = (start + k) % ftp_port_count;
+        uint64_t *word = &ftp_port_bits[i / 64];
+        uint64_t bit = 1ULL << (i % 64);
+        uint64_t old = __atomic_load_n(word, __ATOMIC_RELAXED);
+        while (!(old & bit)) {
+            if (__atomic_compare_exchange_n(word, &old, old | bit, true,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                __atomic_fetch_add(&ftp_ports_in_use, 1, __ATOMIC_RELAXED);
+                return (int)i;
+            }
+        }
+    }
+    return -1;
+}
+
+static void ftp_port_free(int index)
+{
+    __atomic_fetch_and(&ftp_port_bits[index / 64], ~(1ULL << (index % 64)), __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&ftp_ports_in_use, 1, __ATOMIC_RELAXED);
+}
+
+// 确保端口的监听socket已创建，并丢弃上一次使用后残留的连接
+static int ftp_port_listen(int index)
+{
+    ftp_data_port_t *port = &ftp_ports[index];
+    if (port->listen_fd < 0) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr(ftp_server_config->ftp.ip);
+        addr.sin_port = htons(ftp_server_config->ftp.data_port_min + index);
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        struct epoll_event ev = { .events = 0, .data.ptr = port };
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0 ||
+            epoll_ctl(ftp_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            dlt_log_warn(APP_ID, "Data port %d unavailable: %s",
+                         ftp_server_config->ftp.data_port_min + index, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        port->listen_fd = fd;
+        return 0;
+    }
+    int stale;
+    while ((stale = accept4(port->listen_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+        close(stale);
+    }
+    return 0;
+}
+
+// 解除会话对被动模式端口的占用，调用者持有ftp_sessions_lock
+static void ftp_session_release_port(ftp_session_t *session)
+{
+    if (session->pasv_port >= 0) {
+        ftp_ports[session->pasv_port].owner = NULL;
+        ftp_port_free(session->pasv_port);
+        session->pasv_port = -1;
+    }
+}
+
+// 替换会话中的数据socket，旧socket在锁外关闭
+static void ftp_session_set_fd(int *slot, int fd)
+{
+    pthread_mutex_lock(&ftp_sessions_lock);
+    int old = *slot;
+    *slot = fd;
+    pthread_mutex_unlock(&ftp_sessions_lock);
+    if (old >= 0) {
+        close(old);
+    }
+}
+
+// 结束会话并释放
+static void ftp_session_close(ftp_session_t *session)
+{
+    pthread_mutex_lock(&ftp_sessions_lock);
+    if (session->prev != NULL) {
+        session->prev->next = session->next;
+    } else {
+        ftp_sessions = session->next;
+    }
+    if (session->next != NULL) {
+        session->next->prev = session->prev;
+    }
+    ftp_session_release_port(session);
+    pthread_mutex_unlock(&ftp_sessions_lock);
+
+    if (session->data_sock >= 0) {
+        close(session->data_sock);
+        dlt_log_debug(APP_ID, "Closed lingering data_sock after client exit.");
+    }
+    close(session->control_sock);
+    free(session);
+    __atomic_fetch_sub(&ftp_active_sessions, 1, __ATOMIC_RELAXED);
+}
+
+// 将控制连接交给事件线程监视，每次就绪只通知一次，处理完后需重新登记
+static void ftp_session_watch(ftp_session_t *session, int op)
+{
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, .data.ptr = session };
+    if (epoll_ctl(ftp_epoll_fd, op, session->control_sock, &ev) < 0) {
+        dlt_log_error(APP_ID, "epoll_ctl failed: %s", strerror(errno));
+        ftp_session_close(session);
+    }
+}
 
+// 一次数据传输的统计及访问记录信息，时间为access_log_now()的单调时钟，0表示未经历
+typedef struct {
+    uint64_t start;             // 收到命令
+    uint64_t resolved;          // 路径检查及打开完成
+    uint64_t first_byte;        // 开始发送数据
+    uint64_t bytes;
+    int status;                 // 最终应答码
+    bool upload;                // bytes为接收的字节数
+} ftp_transfer_t;
+
+// 一次数据传输结束：更新运行统计并写入访问记录
+static void ftp_end_transfer(const struct sockaddr_in *client_addr, const char *cmd,
+                             const char *path, const ftp_transfer_t *xfer) {
+    uint64_t now = access_log_now();
+    metrics_add(xfer->upload ? METRIC_FTP_BYTES_RECEIVED : METRIC_FTP_BYTES_SENT, xfer->bytes);
+    if (xfer->status == 226) {
+        metrics_observe(METRIC_FTP_TRANSFER_DURATION, (now - xfer->start) / 1000);
+    } else {
+        metrics_inc(METRIC_FTP_TRANSFER_ERRORS);
+    }
+    if (!access_log_enabled()) {
+        return;
+    }
+    access_record_t rec;
+    access_record_init(&rec, ACCESS_PROTO_FTP, xfer->start, cmd, strlen(cmd), path, strlen(path));
+    rec.addr = client_addr->sin_addr.s_addr;
+    rec.port = ntohs(client_addr->sin_port);
+    rec.status = (uint16_t)xfer->status;
+    rec.bytes = xfer->bytes;
+    rec.flags = xfer->status == 226 ? 0 : ACCESS_FLAG_ABORTED;
+    rec.resolve_us = access_log_elapsed_us(xfer->start, xfer->resolved);
+    rec.first_byte_us = access_log_elapsed_us(xfer->start, xfer->first_byte);
+    rec.complete_us = access_log_elapsed_us(xfer->start, now);
+    access_log_write(&rec);
+}
 
 // 发送响应到客户端
 void send_response(int sock, int code, const char *message) {
-    char buffer[256];
+    // 应答中可能含有完整路径
+    char buffer[PATH_MAX + 64];
     int len = snprintf(buffer, sizeof(buffer), "%d %s\r\n", code, message);
+    if (len >= (int)sizeof(buffer)) {
+        len = sizeof(buffer) - 1;
+        buffer[len - 2] = '\r';
+        buffer[len - 1] = '\n';
+    }
     if (len > 0) {
         send(sock, buffer, len, 0);
     }else{
@@ -36,263 +264,934 @@ void send_response(int sock, int code, const char *message) {
     print_raw_data("Sent response", buffer, len);
 }
 
-int is_path_valid(const char *path, const char *root_dir) {
-    char real_path[512];
-    char real_root[512];
-    if (realpath(path, real_path) == NULL) {
+// 发送全部数据，失败返回-1
+static int ftp_send_all(int sock, const char *data, size_t len)
+{
+    for (size_t pos = 0; pos < len;) {
+        ssize_t n = send(sock, data + pos, len - pos, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        pos += n;
+    }
+    return 0;
+}
+
+// 发送多行应答：首行"code-text"，中间各行已以空格开头，末行"code End"
+static void send_multiline_response(int sock, int code, const char *text, const strbuf_t *lines) {
+    strbuf_t reply = {0};
+    int ret = strbuf_printf(&reply, "%d-%s\r\n", code, text);
+    // 按FTP要求将换行转为CRLF
+    for (size_t start = 0, i = 0; ret == 0 && i < lines->len; i++) {
+        if (lines->data[i] == '\n') {
+            ret = strbuf_append(&reply, lines->data + start, i - start);
+            ret = ret != 0 ? ret : strbuf_append(&reply, "\r\n", 2);
+            start = i + 1;
+        }
+    }
+    ret = ret != 0 ? ret : strbuf_printf(&reply, "%d End\r\n", code);
+    if (ret != 0) {
+        strbuf_free(&reply);
+        send_response(sock, 451, "Requested action aborted. Local error in processing.");
+        return;
+    }
+    ftp_send_all(sock, reply.data, reply.len);
+    strbuf_free(&reply);
+}
+
+
+// 将FTP路径按字面规范化为根目录下的相对路径（根目录为"."），规范化结果从会话arena中分配
+// 越出根目录的".."停留在根目录，与客户端对"/.."的预期一致；路径为NULL或过长时返回NULL
+static const char *ftp_resolve_path(arena_t *arena, const char *path) {
+    char *norm = path != NULL ? arena_alloc(arena, PATH_MAX) : NULL;
+    if (norm == NULL || path_normalize(norm, PATH_MAX, path, true) < 0) {
+        return NULL;
+    }
+    return norm[1] != '\0' ? norm + 1 : ".";
+}
+
+// 目录列表的格式
+typedef enum {
+    FTP_LIST_LONG,              // LIST：ls -l风格
+    FTP_LIST_NAMES,             // NLST：仅名称
+    FTP_LIST_MACHINE,           // MLSD：RFC 3659事实
+} ftp_list_format_t;
+
+// 列表数据积累到此大小后再写入数据连接
+#define FTP_LIST_FLUSH_SIZE (64 * 1024)
+
+// 追加目录列表中的一项，内存不足时返回-1
+static int ftp_append_list_entry(strbuf_t *out, ftp_list_format_t format, const char *name, const struct stat *st)
+{
+    size_t name_len = strlen(name);
+    // 直接格式化到缓冲区末尾，每项不单独分配或复制
+    if (strbuf_reserve(out, name_len + 128) != 0) {
+        return -1;
+    }
+    char *tail = out->data + out->len;
+    size_t space = out->cap - out->len;
+    switch (format) {
+    case FTP_LIST_LONG:
+        out->len += listing_format_ftp_line(tail, space, name, st);
         return 0;
+    case FTP_LIST_MACHINE:
+        out->len += listing_format_mlsx_facts(tail, space, st);
+        break;
+    case FTP_LIST_NAMES:
+        break;
     }
-    if (realpath(root_dir, real_root) == NULL) {
+    memcpy(out->data + out->len, name, name_len);
+    memcpy(out->data + out->len + name_len, "\r\n", 2);
+    out->len += name_len + 2;
+    return 0;
+}
+
+// 将积累的列表数据写入数据连接，失败返回-1
+static int ftp_flush_list(int data_sock, strbuf_t *out, ftp_transfer_t *xfer)
+{
+    if (out->len == 0) {
         return 0;
     }
-    return strncmp(real_path, real_root, strlen(real_root)) == 0;
+    if (xfer->first_byte == 0) {
+        xfer->first_byte = access_log_now();
+    }
+    int ret = ftp_send_all(data_sock, out->data, out->len);
+    if (ret == 0) {
+        xfer->bytes += out->len;
+    }
+    out->len = 0;
+    return ret;
 }
 
-// 处理LIST命令
-void handle_list(const ServerConfig *srv_cfg, int control_sock, int data_sock, const char *path)
+// 处理LIST/NLST/MLSD命令：列出目录内容，LIST/NLST的参数为文件时只列出该文件
+// 各项先积累在缓冲区中，每FTP_LIST_FLUSH_SIZE字节写一次数据连接
+void handle_list(arena_t *arena, int control_sock, int data_sock, const char *path,
+                 ftp_list_format_t format, ftp_transfer_t *xfer)
 {
-    DIR *dir;
+    DIR *dir = NULL;
     struct dirent *entry;
     struct stat file_stat;
-    char buffer[1024];
-    time_t rawtime;
-    struct tm *timeinfo;
 
-    if(!is_path_valid(path, srv_cfg->ftp.root_dir)) {
+    // 相对根目录fd打开，目录项的文件信息再相对目录fd获取，无需拼接路径
+    const char *rel = ftp_resolve_path(arena, path);
+    int fd = rel != NULL ? open_beneath(ftp_root_fd, rel, O_PATH | O_CLOEXEC) : -1;
+    if (fd < 0 || fstat(fd, &file_stat) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        xfer->status = 550;
         send_response(control_sock, 550, "Requested action not taken. File unavailable.");
         return;
     }
-
-    dir = opendir(path);
-    if (dir == NULL) {
-        send_response(control_sock, 550, "Failed to open directory.");
+    int dir_fd = -1;
+    if (S_ISDIR(file_stat.st_mode)) {
+        dir_fd = openat(fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        dir = dir_fd >= 0 ? fdopendir(dir_fd) : NULL;
+        if (dir == NULL) {
+            if (dir_fd >= 0) {
+                close(dir_fd);
+            }
+            close(fd);
+            xfer->status = 550;
+            send_response(control_sock, 550, "Failed to open directory.");
+            return;
+        }
+    } else if (format == FTP_LIST_MACHINE) {
+        close(fd);
+        xfer->status = 501;
+        send_response(control_sock, 501, "Not a directory.");
         return;
     }
+    close(fd);
+    xfer->resolved = access_log_now();
 
     send_response(control_sock, 150, "Here comes the directory listing.");
 
-    while ((entry = readdir(dir)) != NULL)
+    strbuf_t out = {0};
+    int ret = 0;
+    size_t entries = 0;
+    if (dir == NULL) {
+        const char *slash = strrchr(rel, '/');
+        ret = ftp_append_list_entry(&out, format, slash != NULL ? slash + 1 : rel, &file_stat);
+        entries = 1;
+    }
+    while (ret == 0 && dir != NULL && (entry = readdir(dir)) != NULL)
     {
         // 跳过当前目录和父目录
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
         }
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-        if (stat(full_path, &file_stat) == -1) {
-            dlt_log_error(APP_ID, "Failed to get file status for %s: %s", full_path, strerror(errno));
+        // NLST只需名称，不获取文件信息
+        if (format != FTP_LIST_NAMES && fstatat(dir_fd, entry->d_name, &file_stat, 0) == -1) {
+            dlt_log_error(APP_ID, "Failed to get file status for %s: %s", entry->d_name, strerror(errno));
             continue;
         }
-
-        // 文件权限
-        char perms[11];
-        snprintf(perms, sizeof(perms), "%c%c%c%c%c%c%c%c%c%c",
-                 S_ISDIR(file_stat.st_mode) ? 'd' : '-',
-                 (file_stat.st_mode & S_IRUSR) ? 'r' : '-',
-                 (file_stat.st_mode & S_IWUSR) ? 'w' : '-',
-                 (file_stat.st_mode & S_IXUSR) ? 'x' : '-',
-                 (file_stat.st_mode & S_IRGRP) ? 'r' : '-',
-                 (file_stat.st_mode & S_IWGRP) ? 'w' : '-',
-                 (file_stat.st_mode & S_IXGRP) ? 'x' : '-',
-                 (file_stat.st_mode & S_IROTH) ? 'r' : '-',
-                 (file_stat.st_mode & S_IWOTH) ? 'w' : '-',
-                 (file_stat.st_mode & S_IXOTH) ? 'x' : '-');
-        
-        // 文件时间
-        rawtime = file_stat.st_mtime;
-        timeinfo = localtime(&rawtime);
-        char time_str[32];
-        strftime(time_str, sizeof(time_str), "%b %d %H:%M", timeinfo);
-
-        // 格式化目录列表行
-        snprintf(buffer, sizeof(buffer), "%s %3ld %-8d %-8d %-8d %-8ld %s %s\r\n",
-                 perms,
-                 (long)file_stat.st_nlink,
-                 (long)file_stat.st_uid,
-                 (long)file_stat.st_gid,
-                 (long)file_stat.st_size,
-                 time_str,
-                 entry->d_name);
-        send(data_sock, buffer, strlen(buffer), 0);
-        print_raw_data("Sent LIST entry", buffer, strlen(buffer));
-    }
-    closedir(dir);
+        ret = ftp_append_list_entry(&out, format, entry->d_name, &file_stat);
+        entries++;
+        if (ret == 0 && out.len >= FTP_LIST_FLUSH_SIZE) {
+            ret = ftp_flush_list(data_sock, &out, xfer);
+        }
+    }
+    if (ret == 0) {
+        ret = ftp_flush_list(data_sock, &out, xfer);
+    }
+    strbuf_free(&out);
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    dlt_log_debug(APP_ID, "Listed %s: %zu entries, %llu bytes", path, entries, (unsigned long long)xfer->bytes);
+    if (ret != 0) {
+        xfer->status = 426;
+        send_response(control_sock, 426, "Connection closed; transfer aborted.");
+        return;
+    }
+    xfer->status = 226;
     send_response(control_sock, 226, "Directory send OK.");
 }
 
-// 处理RETR命令(下载文件)
-void handle_retr(const ServerConfig *srv_cfg, int control_sock, int data_sock, const char *path)
+// 等待数据连接可写，超时或出错返回-1
+static int ftp_wait_writable(int data_sock)
+{
+    struct pollfd pfd = { .fd = data_sock, .events = POLLOUT };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, ftp_server_config->ftp.data_timeout * 1000);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0 && !(pfd.revents & (POLLERR | POLLHUP)) ? 0 : -1;
+}
+
+// 处理RETR命令(下载文件)，从offset处开始发送
+void handle_retr(arena_t *arena, int control_sock, int data_sock, const char *path, off_t offset, ftp_transfer_t *xfer)
 {
     int file_fd;
-    off_t offset = 0;
     struct stat file_stat;
 
-    if(!is_path_valid(path, srv_cfg->ftp.root_dir)) {
+    // 越出根目录的路径及符号链接在打开时即被拒绝
+    const char *rel = ftp_resolve_path(arena, path);
+    if (rel == NULL) {
+        xfer->status = 550;
         send_response(control_sock, 550, "Requested action not taken. File unavailable.");
         return;
     }
 
-    file_fd = open(path, O_RDONLY);
+    file_fd = open_beneath(ftp_root_fd, rel, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
     if (file_fd < 0) {
+        xfer->status = 550;
         send_response(control_sock, 550, "Failed to open file.");
         return;
     }
 
-    if (fstat(file_fd, &file_stat) < 0) {
+    if (fstat(file_fd, &file_stat) < 0 || !S_ISREG(file_stat.st_mode)) {
         close(file_fd);
-        send_response(control_sock, 550, "Failed to get file status.");
+        xfer->status = 550;
+        send_response(control_sock, 550, "Not a regular file.");
         return;
     }
+    if (offset > file_stat.st_size) {
+        close(file_fd);
+        xfer->status = 554;
+        send_response(control_sock, 554, "Requested action not taken: invalid REST parameter.");
+        return;
+    }
+    xfer->resolved = access_log_now();
+    // 顺序读取，让内核加大预读
+    posix_fadvise(file_fd, offset, 0, POSIX_FADV_SEQUENTIAL);
 
     send_response(control_sock, 150, "Opening binary mode data connection for file transfer.");
 
-    // 使用sendfile发送文件
-    ssize_t sent_bytes = sendfile(data_sock, file_fd, &offset, file_stat.st_size);
-    if (sent_bytes < 0) {
-        dlt_log_error(APP_ID, "Failed to send file: %s", strerror(errno));
+    // 使用sendfile发送文件：单次调用有上限且可能只发送一部分，循环直到发送完毕
+    xfer->first_byte = access_log_now();
+    off_t remaining = file_stat.st_size - offset;
+    const char *error = NULL;
+    while (remaining > 0) {
+        size_t chunk = remaining > FTP_SENDFILE_CHUNK ? (size_t)FTP_SENDFILE_CHUNK : (size_t)remaining;
+        ssize_t n = sendfile(data_sock, file_fd, &offset, chunk);
+        if (n > 0) {
+            remaining -= n;
+            xfer->bytes += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满且在超时时间内未能写入，再等待一次后放弃
+            if (ftp_wait_writable(data_sock) < 0) {
+                error = "client stalled";
+                break;
+            }
+        } else {
+            // 返回0表示文件在传输过程中被截短
+            error = n == 0 ? "file truncated" : strerror(errno);
+            break;
+        }
+    }
+    if (error != NULL) {
+        dlt_log_error(APP_ID, "Failed to send file %s: %s", path, error);
+        xfer->status = 426;
         send_response(control_sock, 426, "Connection closed; transfer aborted.");
     } else {
-        dlt_log_debug(APP_ID, "Sent %zd bytes for file %s", sent_bytes, path);
+        dlt_log_debug(APP_ID, "Sent %llu bytes for file %s", (unsigned long long)xfer->bytes, path);
+        xfer->status = 226;
         send_response(control_sock, 226, "Transfer complete.");
     }
 
     close(file_fd);
 }
 
-// 处理客户端命令
-void handle_client_commands(const ServerConfig *srv_cfg, int control_sock, struct sockaddr_in *client_addr)
+// 上传临时文件名重名时的重试次数
+#define FTP_TMP_NAME_TRIES 8
+
+// 生成上传临时文件名，含进程号与序号，上次运行残留的文件一般不会重名，重名时换下一个序号
+static void ftp_tmp_name(char *tmp, const char *name) {
+    static unsigned int upload_seq = 0;
+    snprintf(tmp, NAME_MAX + 1, ".%.200s.%d.%u.part", name, (int)getpid(),
+             __atomic_fetch_add(&upload_seq, 1, __ATOMIC_RELAXED));
+}
+
+// 处理STOR/APPE命令(上传文件)
+// 数据经管道splice写入文件，不经过用户态
+// STOR写入目标目录下的匿名临时文件（O_TMPFILE），完整接收并fsync后才链接到目录中并改名为目标文件，
+// 其他会话及HTTP不会看到写了一半的文件；APPE直接追加到目标文件末尾，失败时截断回原大小
+void handle_stor(arena_t *arena, int control_sock, int data_sock, const char *path, bool append,
+                 off_t alloc_size, ftp_transfer_t *xfer)
 {
-    char buffer[512];
-    char cmd[16], arg[256];
-    int data_sock = -1;
-    int logged_in = 0;
-    send_response(control_sock, 220, "Welcome to Simple FTP Server");
+    xfer->upload = true;
 
-    while (1) {
-        ssize_t n = recv(control_sock, buffer, sizeof(buffer) - 1, 0);
-        if (n <= 0) {
-            if (n < 0) {
-                dlt_log_error(APP_ID, "recv error: %s", strerror(errno));
-            } else {
-                dlt_log_debug(APP_ID, "Client disconnected.");
+    // 拆分为所在目录和文件名，目录相对根目录打开，文件在目录fd下创建
+    const char *rel = ftp_resolve_path(arena, path);
+    const char *slash = rel != NULL ? strrchr(rel, '/') : NULL;
+    const char *name = slash != NULL ? slash + 1 : rel;
+    if (rel == NULL || strcmp(rel, ".") == 0) {
+        xfer->status = 553;
+        send_response(control_sock, 553, "Requested action not taken. File name not allowed.");
+        return;
+    }
+    char *dir = arena_alloc(arena, PATH_MAX);
+    char *tmp = arena_alloc(arena, NAME_MAX + 1);
+    if (dir == NULL || tmp == NULL) {
+        xfer->status = 451;
+        send_response(control_sock, 451, "Requested action aborted. Local error in processing.");
+        return;
+    }
+    if (slash != NULL) {
+        memcpy(dir, rel, slash - rel);
+        dir[slash - rel] = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+    int dir_fd = open_beneath(ftp_root_fd, dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        xfer->status = 550;
+        send_response(control_sock, 550, "Requested action not taken. File unavailable.");
+        return;
+    }
+    int status = 0;
+    const char *error = NULL;
+    off_t file_off = 0;
+    int file_fd;
+    struct stat file_stat;
+    bool created = false;
+    if (append) {
+        // APPE：打开目标文件，不存在时创建；追加量与文件大小无关，不复制已有内容
+        // splice不能写入O_APPEND文件，改为加排他锁后从文件末尾写入，同一文件的追加不会交错或互相覆盖
+        file_fd = openat(dir_fd, name, O_WRONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+        if (file_fd < 0 && errno == ENOENT) {
+            file_fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+            created = file_fd >= 0;
+        }
+        if (file_fd < 0 || fstat(file_fd, &file_stat) < 0 || !S_ISREG(file_stat.st_mode)) {
+            if (file_fd >= 0) {
+                close(file_fd);
             }
-            break;
+            close(dir_fd);
+            xfer->status = 550;
+            send_response(control_sock, 550, "Requested action not taken. File unavailable.");
+            return;
         }
-        buffer[n] = '\0';
-        print_raw_data("Received command", buffer, n);
+        if (flock(file_fd, LOCK_EX | LOCK_NB) < 0) {
+            // 另一个会话正在追加同一文件，不阻塞工作线程等待
+            close(file_fd);
+            close(dir_fd);
+            xfer->status = 450;
+            send_response(control_sock, 450, "Requested file action not taken. File busy.");
+            return;
+        }
+        // 加锁后重新取大小，打开到加锁之间可能有其他追加完成
+        fstat(file_fd, &file_stat);
+        file_off = file_stat.st_size;
+    } else {
+        tmp[0] = '\0';
+        file_fd = openat(dir_fd, ".", O_WRONLY | O_TMPFILE | O_CLOEXEC, 0644);
+        // 文件系统不支持O_TMPFILE时改用有名字的临时文件
+        for (int i = 0; file_fd < 0 && (errno == EOPNOTSUPP || errno == EISDIR || errno == EEXIST) &&
+                        i < FTP_TMP_NAME_TRIES; i++) {
+            ftp_tmp_name(tmp, name);
+            file_fd = openat(dir_fd, tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+        }
+        if (file_fd < 0) {
+            dlt_log_error(APP_ID, "Failed to create temporary file for %s: %s", path, strerror(errno));
+            close(dir_fd);
+            xfer->status = 550;
+            send_response(control_sock, 550, "Can't create file.");
+            return;
+        }
+    }
+    // ALLO给出了大小时预先分配空间，空间不足可以在接收数据前报告
+    if (status == 0 && alloc_size > 0 &&
+        fallocate(file_fd, FALLOC_FL_KEEP_SIZE, file_off, alloc_size) < 0 && errno == ENOSPC) {
+        status = 452;
+    }
+    int pipefd[2] = { -1, -1 };
+    if (status == 0 && pipe2(pipefd, O_CLOEXEC) < 0) {
+        error = strerror(errno);
+        status = 451;
+    }
+    if (status != 0) {
+        goto done;
+    }
+    fcntl(pipefd[1], F_SETPIPE_SZ, FTP_SPLICE_PIPE_SIZE);
+    xfer->resolved = access_log_now();
 
-        // 解析命令和参数
-        sscanf(buffer, "%15s %255[^\" ]", cmd, arg); // fallback: parse until space or end
-        for (int i = 0; cmd[i]; i++) cmd[i] = toupper(cmd[i]);
+    send_response(control_sock, 150, "Ok to send data.");
 
-        if (strcmp(cmd, "USER") == 0) {
-            send_response(control_sock, 331, "User name okay, need password.");
-        } else if (strcmp(cmd, "PASS") == 0) {
-            logged_in = 1;
-            send_response(control_sock, 230, "User logged in, proceed.");
-        } else if (strcmp(cmd, "QUIT") == 0) {
-            send_response(control_sock, 221, "Goodbye.");
+    // 客户端关闭数据连接表示文件结束
+    for (;;) {
+        ssize_t n = splice(data_sock, NULL, pipefd[1], NULL, FTP_SPLICE_PIPE_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n == 0) {
             break;
-        } else if (strcmp(cmd, "SYST") == 0) {
-            send_response(control_sock, 215, "UNIX Type: L8");
-        } else if (strcmp(cmd, "PWD") == 0) {
-            send_response(control_sock, 257, srv_cfg->ftp.root_dir);
-        } else if (strcmp(cmd, "TYPE") == 0) {
-            send_response(control_sock, 200, "Type set to I.");
-        } else if (strcmp(cmd, "PASV") == 0) {
-            // 启动被动模式，监听数据端口
-            int pasv_sock;
-            struct sockaddr_in pasv_addr;
-            socklen_t addrlen = sizeof(pasv_addr);
-            pasv_sock = socket(AF_INET, SOCK_STREAM, 0);
-            if (pasv_sock < 0) {
-                send_response(control_sock, 425, "Can't open passive connection.");
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
                 continue;
             }
-            memset(&pasv_addr, 0, sizeof(pasv_addr));
-            pasv_addr.sin_family = AF_INET;
-            pasv_addr.sin_addr.s_addr = inet_addr(srv_cfg->ftp.ip);
-            pasv_addr.sin_port = htons(srv_cfg->ftp.data_port_min);
-            int opt = 1;
-            setsockopt(pasv_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-            if (bind(pasv_sock, (struct sockaddr*)&pasv_addr, sizeof(pasv_addr)) < 0) {
-                close(pasv_sock);
-                send_response(control_sock, 425, "Can't bind passive port.");
+            // 超过data_timeout未收到数据时返回EAGAIN
+            error = errno == EAGAIN ? "client stalled" : strerror(errno);
+            status = 426;
+            break;
+        }
+        if (xfer->first_byte == 0) {
+            xfer->first_byte = access_log_now();
+        }
+        while (n > 0) {
+            ssize_t m = splice(pipefd[0], NULL, file_fd, &file_off, n, SPLICE_F_MOVE);
+            if (m < 0 && errno == EINTR) {
                 continue;
             }
-            if (listen(pasv_sock, 1) < 0) {
-                close(pasv_sock);
-                send_response(control_sock, 425, "Can't listen on passive port.");
-                continue;
+            if (m <= 0) {
+                error = m < 0 ? strerror(errno) : "short write";
+                status = m < 0 && errno == ENOSPC ? 452 : 451;
+                break;
             }
-            getsockname(pasv_sock, (struct sockaddr*)&pasv_addr, &addrlen);
-            unsigned int p = ntohs(pasv_addr.sin_port);
-            unsigned int ip = ntohl(pasv_addr.sin_addr.s_addr);
-            char pasv_msg[128];
-            snprintf(pasv_msg, sizeof(pasv_msg),
-                "Entering Passive Mode (%u,%u,%u,%u,%u,%u).",
-                (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF,
-                (p >> 8) & 0xFF, p & 0xFF);
-            send_response(control_sock, 227, pasv_msg);
-            // 等待数据连接
-            struct sockaddr_in data_client;
-            socklen_t dlen = sizeof(data_client);
-            data_sock = accept(pasv_sock, (struct sockaddr*)&data_client, &dlen);
-            close(pasv_sock);
-            if (data_sock < 0) {
-                send_response(control_sock, 425, "Failed to accept data connection.");
-                continue;
+            n -= m;
+            xfer->bytes += m;
+        }
+        if (status != 0) {
+            break;
+        }
+    }
+    // 释放预分配但未用到的空间
+    if (status == 0 && alloc_size > 0 && ftruncate(file_fd, file_off) < 0) {
+        error = strerror(errno);
+        status = 451;
+    }
+
+done:
+    if (pipefd[0] >= 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    // 落盘后再回复成功或发布目标文件，崩溃后不会出现只有部分内容的目标文件
+    if (status == 0 && fsync(file_fd) < 0) {
+        error = strerror(errno);
+        status = errno == ENOSPC ? 452 : 451;
+    }
+    if (append) {
+        if (status != 0) {
+            // 撤销未完成的追加；本次新建的文件若仍是同一个则删除
+            struct stat cur;
+            if (created && fstatat(dir_fd, name, &cur, AT_SYMLINK_NOFOLLOW) == 0 &&
+                cur.st_ino == file_stat.st_ino && cur.st_dev == file_stat.st_dev) {
+                unlinkat(dir_fd, name, 0);
+            } else if (ftruncate(file_fd, file_stat.st_size) < 0) {
+                dlt_log_error(APP_ID, "Failed to roll back append to %s: %s", path, strerror(errno));
             }
-        } else if (strcmp(cmd, "LIST") == 0) {
-            if (data_sock < 0) {
-                send_response(control_sock, 425, "Use PASV first.");
-                continue;
+        }
+        close(file_fd);     // 同时释放锁
+    } else {
+        if (status == 0 && tmp[0] == '\0') {
+            // 匿名文件先链接为临时文件名，再改名原子地替换目标文件
+            char proc_path[32];
+            snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", file_fd);
+            int ret = -1;
+            for (int i = 0; i < FTP_TMP_NAME_TRIES; i++) {
+                ftp_tmp_name(tmp, name);
+                ret = linkat(AT_FDCWD, proc_path, dir_fd, tmp, AT_SYMLINK_FOLLOW);
+                if (ret == 0 || errno != EEXIST) {
+                    break;
+                }
             }
-            handle_list(srv_cfg, control_sock, data_sock, srv_cfg->ftp.root_dir);
-            close(data_sock);
-            data_sock = -1;
-        } else if (strcmp(cmd, "RETR") == 0) {
-            if (data_sock < 0) {
-                send_response(control_sock, 425, "Use PASV first.");
-                continue;
+            if (ret < 0) {
+                error = strerror(errno);
+                status = 550;
+                tmp[0] = '\0';
+            }
+        }
+        close(file_fd);
+        if (status == 0 && renameat(dir_fd, tmp, dir_fd, name) < 0) {
+            error = strerror(errno);
+            status = 550;
+        }
+        if (status != 0 && tmp[0] != '\0') {
+            unlinkat(dir_fd, tmp, 0);
+        }
+    }
+    close(dir_fd);
+
+    if (error != NULL) {
+        dlt_log_error(APP_ID, "Failed to store file %s: %s", path, error);
+    }
+    xfer->status = status != 0 ? status : 226;
+    switch (status) {
+    case 0:
+        dlt_log_debug(APP_ID, "Received %llu bytes for file %s", (unsigned long long)xfer->bytes, path);
+        send_response(control_sock, 226, "Transfer complete.");
+        break;
+    case 426:
+        send_response(control_sock, 426, "Connection closed; transfer aborted.");
+        break;
+    case 452:
+        send_response(control_sock, 452, "Requested action not taken. Insufficient storage space.");
+        break;
+    case 550:
+        send_response(control_sock, 550, "Requested action not taken. File unavailable.");
+        break;
+    default:
+        send_response(control_sock, 451, "Requested action aborted. Local error in processing.");
+        break;
+    }
+}
+
+// 命令处理结果
+typedef enum {
+    FTP_CMD_DONE = 0,           // 继续处理后续命令
+    FTP_CMD_CLOSE,              // 结束会话
+    FTP_CMD_WAIT_DATA,          // 命令已暂存，数据连接建立或超时后再处理
+} ftp_cmd_result_t;
+
+// 取得传输命令使用的数据连接，传输结束后由调用者关闭
+// 被动模式端口尚未收到连接时暂存命令并返回-2，由ftp_session_process决定是否等待；无法取得时回复425并返回-1
+static int ftp_take_data_sock(ftp_session_t *session, const char *line)
+{
+    int data_sock = -1;
+    const char *error = "Use PASV first.";
+    pthread_mutex_lock(&ftp_sessions_lock);
+    if (session->data_sock >= 0) {
+        data_sock = session->data_sock;
+    } else if (session->pasv_port >= 0) {
+        snprintf(session->pending_cmd, sizeof(session->pending_cmd), "%s", line);
+        data_sock = -2;
+    } else if (session->data_failed) {
+        error = "Failed to accept data connection.";
+    }
+    session->data_failed = false;
+    pthread_mutex_unlock(&ftp_sessions_lock);
+    if (data_sock == -1) {
+        send_response(session->control_sock, 425, error);
+    }
+    return data_sock;
+}
+
+// 为会话分配被动模式端口并交给事件线程等待数据连接，返回端口号，无可用端口时返回-1
+static int ftp_session_listen(ftp_session_t *session)
+{
+    for (unsigned int attempt = 0; attempt < ftp_port_count; attempt++) {
+        int index = ftp_port_alloc();
+        if (index < 0) {
+            return -1;
+        }
+        if (ftp_port_listen(index) < 0) {
+            ftp_port_free(index);
+            continue;
+        }
+        ftp_data_port_t *port = &ftp_ports[index];
+        pthread_mutex_lock(&ftp_sessions_lock);
+        port->owner = session;
+        port->deadline = ftp_monotonic_ms() + (uint64_t)ftp_server_config->ftp.data_timeout * 1000;
+        session->pasv_port = index;
+        session->data_failed = false;
+        pthread_mutex_unlock(&ftp_sessions_lock);
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = port };
+        epoll_ctl(ftp_epoll_fd, EPOLL_CTL_MOD, port->listen_fd, &ev);
+        return ftp_server_config->ftp.data_port_min + index;
+    }
+    return -1;
+}
+
+// 命令行中命令之后的全部内容，路径中可以含有空格；skip_options为真时跳过LIST/NLST的"-la"等选项
+static const char *ftp_command_param(const char *line, bool skip_options)
+{
+    const char *p = line + strcspn(line, " ");
+    p += strspn(p, " ");
+    while (skip_options && *p == '-') {
+        p += strcspn(p, " ");
+        p += strspn(p, " ");
+    }
+    return p;
+}
+
+// 命令参数中的路径：绝对路径直接使用，相对路径基于会话当前目录，空参数为当前目录
+// 结果未经规范化，由ftp_resolve_path检查；过长时返回NULL
+static const char *ftp_session_path(arena_t *arena, const ftp_session_t *session, const char *param)
+{
+    if (param[0] == '/') {
+        return param;
+    }
+    if (param[0] == '\0') {
+        return session->cwd;
+    }
+    char *path = arena_alloc(arena, PATH_MAX);
+    if (path == NULL) {
+        return NULL;
+    }
+    int len = snprintf(path, PATH_MAX, "%s/%s", session->cwd, param);
+    return len >= 0 && len < PATH_MAX ? path : NULL;
+}
+
+// 路径在FTP中显示的形式："/"或"/"加根目录下的相对路径
+static const char *ftp_display_path(const char *rel)
+{
+    if (strcmp(rel, ".") == 0) {
+        return "/";
+    }
+    // rel由ftp_resolve_path返回，紧接在规范化结果的"/"之后
+    return rel - 1;
+}
+
+// 处理一条命令，line已去掉行尾的CRLF
+static ftp_cmd_result_t ftp_handle_command(ftp_session_t *session, char *line, arena_t *arena)
+{
+    int control_sock = session->control_sock;
+    const ServerConfig *srv_cfg = ftp_server_config;
+    char cmd[16], arg[256];
+
+    cmd[0] = '\0';
+    arg[0] = '\0';
+    sscanf(line, "%15s %255[^\" ]", cmd, arg); // fallback: parse until space or end
+    for (int i = 0; cmd[i]; i++) cmd[i] = toupper(cmd[i]);
+
+    if (strcmp(cmd, "USER") == 0) {
+        send_response(control_sock, 331, "User name okay, need password.");
+    } else if (strcmp(cmd, "PASS") == 0) {
+        session->logged_in = true;
+        send_response(control_sock, 230, "User logged in, proceed.");
+    } else if (strcmp(cmd, "QUIT") == 0) {
+        send_response(control_sock, 221, "Goodbye.");
+        return FTP_CMD_CLOSE;
+    } else if (strcmp(cmd, "SYST") == 0) {
+        send_response(control_sock, 215, "UNIX Type: L8");
+    } else if (strcmp(cmd, "PWD") == 0) {
+        // RFC 959：路径中的双引号需写成两个双引号
+        char quoted[PATH_MAX * 2];
+        size_t n = 0;
+        for (const char *p = session->cwd; *p != '\0' && n + 2 < sizeof(quoted); p++) {
+            if (*p == '"') {
+                quoted[n++] = '"';
+            }
+            quoted[n++] = *p;
+        }
+        quoted[n] = '\0';
+        char msg[PATH_MAX * 2 + 32];
+        snprintf(msg, sizeof(msg), "\"%s\" is the current directory.", quoted);
+        send_response(control_sock, 257, msg);
+    } else if (strcmp(cmd, "CWD") == 0 || strcmp(cmd, "CDUP") == 0) {
+        // 切换当前目录：目标须为根目录下可打开的目录，根目录的上级仍为根目录
+        const char *param = cmd[1] == 'D' ? ".." : ftp_command_param(line, false);
+        if (param[0] == '\0') {
+            send_response(control_sock, 501, "Syntax error in parameters or arguments.");
+            return FTP_CMD_DONE;
+        }
+        const char *rel = ftp_resolve_path(arena, ftp_session_path(arena, session, param));
+        int fd = rel != NULL ? open_beneath(ftp_root_fd, rel, O_PATH | O_DIRECTORY | O_CLOEXEC) : -1;
+        if (fd < 0) {
+            send_response(control_sock, 550, "Failed to change directory.");
+            return FTP_CMD_DONE;
+        }
+        close(fd);
+        snprintf(session->cwd, sizeof(session->cwd), "%s", ftp_display_path(rel));
+        send_response(control_sock, 250, "Directory successfully changed.");
+    } else if (strcmp(cmd, "TYPE") == 0) {
+        send_response(control_sock, 200, "Type set to I.");
+    } else if (strcmp(cmd, "PASV") == 0) {
+        // 放弃之前的数据连接及端口，从端口池中取一个已在监听的端口，连接由事件线程接受
+        pthread_mutex_lock(&ftp_sessions_lock);
+        ftp_session_release_port(session);
+        pthread_mutex_unlock(&ftp_sessions_lock);
+        ftp_session_set_fd(&session->data_sock, -1);
+        int port = ftp_session_listen(session);
+        if (port < 0) {
+            send_response(control_sock, 425, "Can't open passive connection.");
+            return FTP_CMD_DONE;
+        }
+        unsigned int p = (unsigned int)port;
+        unsigned int ip = ntohl(inet_addr(srv_cfg->ftp.ip));
+        if (ip == INADDR_ANY) {
+            // 监听所有地址时回复客户端所连接的地址
+            struct sockaddr_in local;
+            socklen_t addrlen = sizeof(local);
+            getsockname(control_sock, (struct sockaddr*)&local, &addrlen);
+            ip = ntohl(local.sin_addr.s_addr);
+        }
+        char pasv_msg[128];
+        snprintf(pasv_msg, sizeof(pasv_msg),
+            "Entering Passive Mode (%u,%u,%u,%u,%u,%u).",
+            (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF,
+            (p >> 8) & 0xFF, p & 0xFF);
+        send_response(control_sock, 227, pasv_msg);
+    } else if (strcmp(cmd, "LIST") == 0 || strcmp(cmd, "NLST") == 0 || strcmp(cmd, "MLSD") == 0 ||
+               strcmp(cmd, "RETR") == 0 || strcmp(cmd, "STOR") == 0 || strcmp(cmd, "APPE") == 0) {
+        bool listing = cmd[0] == 'L' || cmd[0] == 'N' || cmd[0] == 'M';
+        const char *param = ftp_command_param(line, cmd[0] == 'L' || cmd[0] == 'N');
+        if (!listing && param[0] == '\0') {
+            send_response(control_sock, 501, "Syntax error in parameters or arguments.");
+            return FTP_CMD_DONE;
+        }
+        // 上传需登录且配置允许，在等待数据连接之前拒绝
+        if (cmd[0] == 'S' || cmd[0] == 'A') {
+            if (!session->logged_in) {
+                send_response(control_sock, 530, "Not logged in.");
+                return FTP_CMD_DONE;
+            }
+            if (!srv_cfg->ftp.allow_upload) {
+                send_response(control_sock, 550, "Permission denied.");
+                return FTP_CMD_DONE;
+            }
+        }
+        int data_sock = ftp_take_data_sock(session, line);
+        if (data_sock == -2) {
+            return FTP_CMD_WAIT_DATA;
+        }
+        if (data_sock < 0) {
+            return FTP_CMD_DONE;
+        }
+        ftp_transfer_t xfer = { .start = access_log_now() };
+        const char *path = ftp_session_path(arena, session, param);
+        if (cmd[0] == 'L') {
+            metrics_inc(METRIC_FTP_LIST);
+            handle_list(arena, control_sock, data_sock, path, FTP_LIST_LONG, &xfer);
+        } else if (cmd[0] == 'N') {
+            metrics_inc(METRIC_FTP_NLST);
+            handle_list(arena, control_sock, data_sock, path, FTP_LIST_NAMES, &xfer);
+        } else if (cmd[0] == 'M') {
+            metrics_inc(METRIC_FTP_MLSD);
+            handle_list(arena, control_sock, data_sock, path, FTP_LIST_MACHINE, &xfer);
+        } else if (cmd[0] == 'R') {
+            metrics_inc(METRIC_FTP_RETR);
+            handle_retr(arena, control_sock, data_sock, path, session->rest_offset, &xfer);
+        } else {
+            bool append = cmd[0] == 'A';
+            metrics_inc(append ? METRIC_FTP_APPE : METRIC_FTP_STOR);
+            handle_stor(arena, control_sock, data_sock, path, append, session->alloc_size, &xfer);
+        }
+        session->rest_offset = 0;
+        session->alloc_size = 0;
+        ftp_session_set_fd(&session->data_sock, -1);
+        ftp_end_transfer(&session->client_addr, cmd, path != NULL ? path : param, &xfer);
+    } else if (strcmp(cmd, "MLST") == 0) {
+        // 在控制连接上返回单个文件或目录的事实（RFC 3659）
+        const char *rel = ftp_resolve_path(arena, ftp_session_path(arena, session, ftp_command_param(line, false)));
+        int fd = rel != NULL ? open_beneath(ftp_root_fd, rel, O_PATH | O_CLOEXEC) : -1;
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            send_response(control_sock, 550, "Requested action not taken. File unavailable.");
+        } else {
+            char facts[128];
+            strbuf_t lines = {0};
+            listing_format_mlsx_facts(facts, sizeof(facts), &st);
+            if (strbuf_printf(&lines, " %s%s\n", facts, ftp_display_path(rel)) != 0) {
+                send_response(control_sock, 451, "Requested action aborted. Local error in processing.");
+            } else {
+                send_multiline_response(control_sock, 250, "Listing", &lines);
             }
-            char file_path[512];
-            snprintf(file_path, sizeof(file_path), "%s/%s", srv_cfg->ftp.root_dir, arg);
-            handle_retr(srv_cfg, control_sock, data_sock, file_path);
-            close(data_sock);
-            data_sock = -1;
+            strbuf_free(&lines);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    } else if (strcmp(cmd, "FEAT") == 0) {
+        // 客户端据此使用MLSD及断点续传
+        strbuf_t features = {0};
+        static const char feature_list[] = " MLST type*;size*;modify*;perm*;\n SIZE\n REST STREAM\n";
+        if (strbuf_append(&features, feature_list, sizeof(feature_list) - 1) != 0) {
+            send_response(control_sock, 451, "Requested action aborted. Local error in processing.");
+        } else {
+            send_multiline_response(control_sock, 211, "Features:", &features);
+        }
+        strbuf_free(&features);
+    } else if (strcmp(cmd, "REST") == 0) {
+        // 断点续传：记录下一次RETR的起始位置
+        char *end;
+        errno = 0;
+        long long offset = strtoll(arg, &end, 10);
+        if (arg[0] < '0' || arg[0] > '9' || *end != '\0' || errno != 0) {
+            send_response(control_sock, 501, "Syntax error in parameters or arguments.");
+            return FTP_CMD_DONE;
+        }
+        session->rest_offset = (off_t)offset;
+        char msg[96];
+        snprintf(msg, sizeof(msg), "Restarting at %lld. Send RETR to initiate transfer.", offset);
+        send_response(control_sock, 350, msg);
+    } else if (strcmp(cmd, "ALLO") == 0) {
+        // 记录下一次上传的大小，用于预分配空间；"ALLO n R m"的记录大小无意义，忽略
+        long long size = strtoll(arg, NULL, 10);
+        session->alloc_size = size > 0 ? (off_t)size : 0;
+        send_response(control_sock, 200, "ALLO command successful.");
+    } else if (strcmp(cmd, "SIZE") == 0) {
+        // 客户端续传前查询文件大小（RFC 3659）
+        const char *rel = ftp_resolve_path(arena, ftp_session_path(arena, session, ftp_command_param(line, false)));
+        int fd = rel != NULL ? open_beneath(ftp_root_fd, rel, O_PATH | O_CLOEXEC) : -1;
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            char msg[32];
+            snprintf(msg, sizeof(msg), "%lld", (long long)st.st_size);
+            send_response(control_sock, 213, msg);
         } else {
-            send_response(control_sock, 502, "Command not implemented.");
+            send_response(control_sock, 550, "Could not get file size.");
         }
+        if (fd >= 0) {
+            close(fd);
+        }
+    } else if (strcmp(cmd, "SITE") == 0 && strcasecmp(arg, "STATS") == 0) {
+        // 与HTTP统计页面相同的内容
+        strbuf_t stats = {0};
+        if (metrics_render(&stats, " ") != 0) {
+            send_response(control_sock, 451, "Requested action aborted. Local error in processing.");
+        } else {
+            send_multiline_response(control_sock, 211, "Server statistics", &stats);
+        }
+        strbuf_free(&stats);
+    } else {
+        send_response(control_sock, 502, "Command not implemented.");
     }
-    // Ensure data_sock is closed if still open (client exited abnormally)
-    if (data_sock >= 0) {
-        close(data_sock);
-        data_sock = -1;
-        dlt_log_debug(APP_ID, "Closed lingering data_sock after client exit.");
+    return FTP_CMD_DONE;
+}
+
+// 会话就绪：继续等待数据连接的命令，读取控制连接并依次处理其中的完整命令行，之后重新交给事件线程监视
+static void ftp_session_process(ftp_session_t *session, arena_t *arena)
+{
+    ftp_cmd_result_t result;
+    if (session->pending_cmd[0] == '\0') {
+        size_t space = sizeof(session->cmd_buf) - session->cmd_len;
+        ssize_t n = recv(session->control_sock, session->cmd_buf + session->cmd_len, space, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            if (n < 0) {
+                dlt_log_error(APP_ID, "recv error: %s", strerror(errno));
+            } else {
+                dlt_log_debug(APP_ID, "Client disconnected.");
+            }
+            ftp_session_close(session);
+            return;
+        }
+        if (n > 0) {
+            session->cmd_len += n;
+        }
+    }
+
+    for (;;) {
+        result = FTP_CMD_DONE;
+        if (session->pending_cmd[0] != '\0') {
+            char line[sizeof(session->pending_cmd)];
+            memcpy(line, session->pending_cmd, sizeof(line));
+            session->pending_cmd[0] = '\0';
+            result = ftp_handle_command(session, line, arena);
+            arena_reset(arena);
+        }
+        char *eol;
+        while (result == FTP_CMD_DONE && (eol = memchr(session->cmd_buf, '\n', session->cmd_len)) != NULL) {
+            // 去掉行尾的CRLF，否则参数中会带上CR
+            *eol = '\0';
+            if (eol > session->cmd_buf && eol[-1] == '\r') {
+                eol[-1] = '\0';
+            }
+            print_raw_data("Received command", session->cmd_buf, strlen(session->cmd_buf));
+            metrics_inc(METRIC_FTP_COMMANDS);
+            result = ftp_handle_command(session, session->cmd_buf, arena);
+            arena_reset(arena);
+            size_t consumed = eol + 1 - session->cmd_buf;
+            session->cmd_len -= consumed;
+            memmove(session->cmd_buf, eol + 1, session->cmd_len);
+        }
+        if (result == FTP_CMD_CLOSE) {
+            ftp_session_close(session);
+            return;
+        }
+        if (result != FTP_CMD_WAIT_DATA) {
+            break;
+        }
+        // 数据连接仍未建立：会话处理到此为止，等待期间不读取后续命令，由事件线程在连接建立或超时后重新入队
+        pthread_mutex_lock(&ftp_sessions_lock);
+        bool ready = session->data_sock >= 0 || session->pasv_port < 0;
+        session->data_waiting = !ready;
+        pthread_mutex_unlock(&ftp_sessions_lock);
+        if (!ready) {
+            return;
+        }
+    }
+    if (session->cmd_len == sizeof(session->cmd_buf)) {
+        send_response(session->control_sock, 500, "Command line too long.");
+        session->cmd_len = 0;
     }
+    ftp_session_watch(session, EPOLL_CTL_MOD);
 }
 
-// 客户端处理线程
-void *client_thread(void *arg)
+// 工作线程：从就绪队列取出会话处理，会话处理期间不会再次入队
+static void *ftp_worker_main(void *arg)
 {
-    client_data_t *client = (client_data_t *)arg;
-    dlt_log_debug(APP_ID, "Client thread started.");
-    handle_client_commands(client->config, client->control_sock, &client->client_addr);
-    close(client->control_sock);
-    pthread_mutex_lock(&clients_mutex);
-    client->is_active = 0;
-    pthread_mutex_unlock(&clients_mutex);
-    dlt_log_debug(APP_ID, "Client thread exiting.");
+    (void)arg;
+    // 处理单条命令所需的临时内存，命令处理完后重置
+    arena_t arena;
+    arena_init(&arena, ftp_pool);
+    for (;;) {
+        pthread_mutex_lock(&ftp_queue_lock);
+        while (ftp_queue_head == NULL && !ftp_stopping) {
+            pthread_cond_wait(&ftp_queue_cond, &ftp_queue_lock);
+        }
+        if (ftp_stopping) {
+            pthread_mutex_unlock(&ftp_queue_lock);
+            break;
+        }
+        ftp_session_t *session = ftp_queue_head;
+        ftp_queue_head = session->queue_next;
+        if (ftp_queue_head == NULL) {
+            ftp_queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&ftp_queue_lock);
+        ftp_session_process(session, &arena);
+    }
+    arena_reset(&arena);
     return NULL;
 }
 
+static void ftp_queue_push(ftp_session_t *session)
+{
+    session->queue_next = NULL;
+    pthread_mutex_lock(&ftp_queue_lock);
+    if (ftp_queue_tail != NULL) {
+        ftp_queue_tail->queue_next = session;
+    } else {
+        ftp_queue_head = session;
+    }
+    ftp_queue_tail = session;
+    pthread_cond_signal(&ftp_queue_cond);
+    pthread_mutex_unlock(&ftp_queue_lock);
+}
+
 // 初始化服务器
 int init_server(const ServerConfig *srv_cfg)
 {
     int sockfd;
     struct sockaddr_in serv_addr;
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd < 0) {
         dlt_log_error(APP_ID, "Failed to create socket: %s", strerror(errno));
         return -1;
@@ -308,7 +1207,7 @@ int init_server(const ServerConfig *srv_cfg)
         close(sockfd);
         return -1;
     }
-    if (listen(sockfd, srv_cfg->ftp.max_connections) < 0) {
+    if (listen(sockfd, SOMAXCONN) < 0) {
         dlt_log_error(APP_ID, "Failed to listen: %s", strerror(errno));
         close(sockfd);
         return -1;
@@ -317,54 +1216,296 @@ int init_server(const ServerConfig *srv_cfg)
     return sockfd;
 }
 
-// ftp服务器主函数入口
-int ftp_server_main(void *arg)
+// 接受所有等待中的控制连接，超出连接数上限的回复421后关闭
+static void ftp_accept_sessions(int server_sock)
 {
-    const ServerConfig *srv_cfg = (const ServerConfig *)arg;
-    int server_sock = init_server(srv_cfg);
-    if (server_sock < 0) {
-        dlt_log_error(APP_ID, "FTP server failed to start.");
-        return -1;
-    }
-    dlt_log_debug(APP_ID, "FTP server main loop starting.");
-    while (server_running) {
+    for (;;) {
         struct sockaddr_in client_addr;
         socklen_t addrlen = sizeof(client_addr);
-        int client_sock = accept(server_sock, (struct sockaddr *)&client_addr, &addrlen);
+        int client_sock = accept4(server_sock, (struct sockaddr *)&client_addr, &addrlen, SOCK_CLOEXEC);
         if (client_sock < 0) {
             if (errno == EINTR) continue;
-            dlt_log_error(APP_ID, "Accept failed: %s", strerror(errno));
-            continue;
-        }
-        pthread_mutex_lock(&clients_mutex);
-        int slot = -1;
-        for (int i = 0; i < srv_cfg->ftp.max_connections; i++) {
-            if (!clients[i].is_active) {
-                slot = i;
-                break;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                dlt_log_error(APP_ID, "Accept failed: %s", strerror(errno));
             }
+            return;
         }
-        if (slot == -1) {
-            pthread_mutex_unlock(&clients_mutex);
+        if (__atomic_load_n(&ftp_active_sessions, __ATOMIC_RELAXED) >= ftp_server_config->ftp.max_connections) {
             send_response(client_sock, 421, "Too many connections.");
             close(client_sock);
             continue;
         }
-        clients[slot].control_sock = client_sock;
-        clients[slot].client_addr = client_addr;
-        clients[slot].is_active = 1;
-        clients[slot].config = (ServerConfig *)srv_cfg;
-        pthread_create(&clients[slot].thread_id, NULL, client_thread, &clients[slot]);
-        pthread_mutex_unlock(&clients_mutex);
+        ftp_session_t *session = calloc(1, sizeof(*session));
+        if (session == NULL) {
+            send_response(client_sock, 421, "Service not available.");
+            close(client_sock);
+            continue;
+        }
+        // 传输的150与226应答紧接着发送，不等待前一个应答被确认
+        int one = 1;
+        setsockopt(client_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        session->control_sock = client_sock;
+        session->data_sock = -1;
+        session->pasv_port = -1;
+        session->client_addr = client_addr;
+        strcpy(session->cwd, "/");
+
+        pthread_mutex_lock(&ftp_sessions_lock);
+        session->next = ftp_sessions;
+        if (ftp_sessions != NULL) {
+            ftp_sessions->prev = session;
+        }
+        ftp_sessions = session;
+        pthread_mutex_unlock(&ftp_sessions_lock);
+        __atomic_fetch_add(&ftp_active_sessions, 1, __ATOMIC_RELAXED);
+        metrics_inc(METRIC_FTP_SESSIONS);
+
+        send_response(client_sock, 220, "Welcome to Simple FTP Server");
+        ftp_session_watch(session, EPOLL_CTL_ADD);
     }
-    close(server_sock);
-    dlt_log_debug(APP_ID, "FTP server main loop exiting.");
+}
+
+// 被动模式端口收到连接：只接受来自控制连接同一地址的连接，交给会话，等待中的传输命令重新入队
+static void ftp_accept_data(ftp_data_port_t *port)
+{
+    ftp_session_t *resume = NULL;
+    pthread_mutex_lock(&ftp_sessions_lock);
+    ftp_session_t *session = port->owner;
+    while (session != NULL) {
+        struct sockaddr_in peer;
+        socklen_t addrlen = sizeof(peer);
+        int fd = accept4(port->listen_fd, (struct sockaddr *)&peer, &addrlen, SOCK_CLOEXEC);
+        if (fd < 0) {
+            struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = port };
+            epoll_ctl(ftp_epoll_fd, EPOLL_CTL_MOD, port->listen_fd, &ev);
+            break;
+        }
+        if (peer.sin_addr.s_addr != session->client_addr.sin_addr.s_addr) {
+            dlt_log_warn(APP_ID, "Rejected data connection from %s", inet_ntoa(peer.sin_addr));
+            close(fd);
+            continue;
+        }
+        // 客户端停止收发时，收发在data_timeout后返回EAGAIN而不是一直阻塞工作线程
+        struct timeval tv = { .tv_sec = ftp_server_config->ftp.data_timeout };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        session->data_sock = fd;
+        ftp_session_release_port(session);
+        if (session->data_waiting) {
+            session->data_waiting = false;
+            resume = session;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&ftp_sessions_lock);
+    if (resume != NULL) {
+        ftp_queue_push(resume);
+    }
+}
+
+// 释放等待数据连接超时的端口，等待中的传输命令重新入队后回复425
+static void ftp_expire_data_ports(uint64_t now)
+{
+    for (unsigned int i = 0; i < ftp_port_count; i++) {
+        uint64_t word = __atomic_load_n(&ftp_port_bits[i / 64], __ATOMIC_RELAXED);
+        if (word == 0) {
+            i |= 63;
+            continue;
+        }
+        if (!(word & (1ULL << (i % 64)))) {
+            continue;
+        }
+        ftp_session_t *resume = NULL;
+        pthread_mutex_lock(&ftp_sessions_lock);
+        ftp_session_t *session = ftp_ports[i].owner;
+        if (session != NULL && ftp_ports[i].deadline <= now) {
+            ftp_session_release_port(session);
+            session->data_failed = true;
+            if (session->data_waiting) {
+                session->data_waiting = false;
+                resume = session;
+            }
+        }
+        pthread_mutex_unlock(&ftp_sessions_lock);
+        if (resume != NULL) {
+            ftp_queue_push(resume);
+        }
+    }
+}
+
+// 退出时唤醒阻塞在控制连接或数据连接上的工作线程
+static void ftp_shutdown_sessions(void)
+{
+    pthread_mutex_lock(&ftp_sessions_lock);
+    for (ftp_session_t *session = ftp_sessions; session != NULL; session = session->next) {
+        shutdown(session->control_sock, SHUT_RDWR);
+        if (session->data_sock >= 0) {
+            shutdown(session->data_sock, SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&ftp_sessions_lock);
+}
+
+// 按data_port_range创建数据端口表，监听socket在首次分配时创建
+static int ftp_ports_init(const FtpServerConfig *ftp)
+{
+    int count = ftp->data_port_max - ftp->data_port_min + 1;
+    if (ftp->data_port_min <= 0 || count <= 0 || ftp->data_port_max > 65535) {
+        dlt_log_error(APP_ID, "Invalid FTP data port range %d-%d", ftp->data_port_min, ftp->data_port_max);
+        return -1;
+    }
+    ftp_ports = calloc(count, sizeof(*ftp_ports));
+    ftp_port_bits = calloc((count + 63) / 64, sizeof(*ftp_port_bits));
+    if (ftp_ports == NULL || ftp_port_bits == NULL) {
+        free(ftp_ports);
+        free(ftp_port_bits);
+        ftp_ports = NULL;
+        ftp_port_bits = NULL;
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        ftp_ports[i].listen_fd = -1;
+    }
+    ftp_port_count = (unsigned int)count;
     return 0;
 }
 
+static void ftp_ports_destroy(void)
+{
+    for (unsigned int i = 0; i < ftp_port_count; i++) {
+        if (ftp_ports[i].listen_fd >= 0) {
+            close(ftp_ports[i].listen_fd);
+        }
+    }
+    free(ftp_ports);
+    free(ftp_port_bits);
+    ftp_ports = NULL;
+    ftp_port_bits = NULL;
+    ftp_port_count = 0;
+}
+
+void ftp_server_wakeup(void)
+{
+    if (ftp_wakeup_fd != -1) {
+        uint64_t one = 1;
+        ssize_t ret = write(ftp_wakeup_fd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+// ftp服务器主函数入口：本线程以epoll监视监听socket及空闲会话，可读的会话交给固定数量的工作线程处理
+int ftp_server_main(void *arg)
+{
+    const ServerConfig *srv_cfg = (const ServerConfig *)arg;
+    ftp_server_config = srv_cfg;
+    metrics_register_gauge("server_ftp_sessions_active", "FTP control connections currently open.",
+                           &ftp_active_sessions);
+    ftp_pool = buffer_pool_create(FTP_ARENA_BLOCK_SIZE, 16, true);
+    if (ftp_pool == NULL) {
+        dlt_log_error(APP_ID, "FTP buffer pool alloc failed.");
+        return -1;
+    }
+    ftp_root_fd = open(srv_cfg->ftp.root_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (ftp_root_fd < 0) {
+        dlt_log_error(APP_ID, "Failed to open FTP root %s: %s", srv_cfg->ftp.root_dir, strerror(errno));
+        buffer_pool_destroy(ftp_pool);
+        ftp_pool = NULL;
+        return -1;
+    }
+    int server_sock = init_server(srv_cfg);
+    ftp_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ftp_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &ftp_listen_token };
+    bool ok = server_sock >= 0 && ftp_epoll_fd >= 0 && ftp_wakeup_fd >= 0 &&
+              ftp_ports_init(&srv_cfg->ftp) == 0 &&
+              epoll_ctl(ftp_epoll_fd, EPOLL_CTL_ADD, server_sock, &ev) == 0;
+    ev.data.ptr = &ftp_wakeup_token;
+    ok = ok && epoll_ctl(ftp_epoll_fd, EPOLL_CTL_ADD, ftp_wakeup_fd, &ev) == 0;
+
+    int nworkers = srv_cfg->ftp.workers > 0 ? srv_cfg->ftp.workers : SERVER_DEFAULT_FTP_WORKERS;
+    pthread_t *workers = ok ? calloc(nworkers, sizeof(*workers)) : NULL;
+    int started = 0;
+    ftp_stopping = false;
+    while (workers != NULL && started < nworkers &&
+           pthread_create(&workers[started], NULL, ftp_worker_main, NULL) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        dlt_log_error(APP_ID, "FTP server failed to start.");
+    }
 
+    dlt_log_debug(APP_ID, "FTP server main loop starting with %d workers.", started);
+    struct epoll_event events[FTP_MAX_EVENTS];
+    uint64_t next_expire = 0;
+    while (started > 0 && server_running) {
+        // 有会话等待数据连接时每秒检查一次超时
+        int timeout = __atomic_load_n(&ftp_ports_in_use, __ATOMIC_RELAXED) > 0 ? 1000 : -1;
+        int n = epoll_wait(ftp_epoll_fd, events, FTP_MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            dlt_log_error(APP_ID, "epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &ftp_listen_token) {
+                ftp_accept_sessions(server_sock);
+            } else if (ptr == &ftp_wakeup_token) {
+                uint64_t value;
+                ssize_t ret = read(ftp_wakeup_fd, &value, sizeof(value));
+                (void)ret;
+            } else if ((uintptr_t)ptr >= (uintptr_t)ftp_ports &&
+                       (uintptr_t)ptr < (uintptr_t)(ftp_ports + ftp_port_count)) {
+                ftp_accept_data(ptr);
+            } else {
+                ftp_queue_push(ptr);
+            }
+        }
+        uint64_t now = ftp_monotonic_ms();
+        if (timeout > 0 && now >= next_expire) {
+            ftp_expire_data_ports(now);
+            next_expire = now + 1000;
+        }
+    }
 
+    // 停止工作线程：先唤醒阻塞在网络操作上的线程，等待全部退出后再释放会话
+    pthread_mutex_lock(&ftp_queue_lock);
+    ftp_stopping = true;
+    ftp_queue_head = ftp_queue_tail = NULL;
+    pthread_cond_broadcast(&ftp_queue_cond);
+    pthread_mutex_unlock(&ftp_queue_lock);
+    ftp_shutdown_sessions();
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    while (ftp_sessions != NULL) {
+        ftp_session_close(ftp_sessions);
+    }
+    ftp_ports_destroy();
+    if (server_sock >= 0) {
+        close(server_sock);
+    }
+    if (ftp_epoll_fd >= 0) {
+        close(ftp_epoll_fd);
+        ftp_epoll_fd = -1;
+    }
+    if (ftp_wakeup_fd >= 0) {
+        close(ftp_wakeup_fd);
+        ftp_wakeup_fd = -1;
+    }
 
+    buffer_pool_stats_t stats;
+    buffer_pool_stats(ftp_pool, &stats);
+    dlt_log_debug(APP_ID, "FTP buffer pool: %zu/%zu in use, peak %zu x %zuB, %llu gets",
+                  stats.in_use, stats.total, stats.peak, stats.buffer_size, (unsigned long long)stats.gets);
+    buffer_pool_destroy(ftp_pool);
+    ftp_pool = NULL;
+    close(ftp_root_fd);
+    ftp_root_fd = -1;
+    dlt_log_debug(APP_ID, "FTP server main loop exiting.");
+    return started > 0 ? 0 : -1;
+}
 
 void *run_ftp_server(void *arg)
 {
@@ -374,7 +1515,7 @@ void *run_ftp_server(void *arg)
         return NULL;
     }
     dlt_log_debug(APP_ID, "FTP server thread started.");
-    ftp_server_main(&data->config);
+    ftp_server_main(data->config);
     dlt_log_debug(APP_ID, "FTP server thread exiting.");
     return NULL;
-}
\ No newline at end of file
+}
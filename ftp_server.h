@@ -1,4 +1,6 @@
 #ifndef FTP_SERVER_H
 #define FTP_SERVER_H
 void *run_ftp_server(void *arg);
+// 唤醒FTP事件线程，使其检查server_running后退出
+void ftp_server_wakeup(void);
 #endif // FTP_SERVER_H
\ No newline at end of file
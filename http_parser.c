@@ -0,0 +1,530 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <strings.h>
+
+#include "http_parser.h"
+
+// 解析状态
+enum {
+    S_METHOD,
+    S_URI_START,
+    S_URI,
+    S_VERSION,
+    S_REQ_LINE_LF,
+    S_HDR_START,
+    S_HDR_NAME,
+    S_HDR_VALUE_START,
+    S_HDR_VALUE,
+    S_HEAD_END_LF,
+    S_DONE
+};
+
+// RFC 7230 token字符表
+static const char token_chars[256] = {
+    ['!'] = 1, ['#'] = 1, ['$'] = 1, ['%'] = 1, ['&'] = 1, ['\''] = 1, ['*'] = 1,
+    ['+'] = 1, ['-'] = 1, ['.'] = 1, ['^'] = 1, ['_'] = 1, ['`'] = 1, ['|'] = 1, ['~'] = 1,
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1, ['6'] = 1, ['7'] = 1,
+    ['8'] = 1, ['9'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1, ['H'] = 1,
+    ['I'] = 1, ['J'] = 1, ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1,
+    ['Q'] = 1, ['R'] = 1, ['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1,
+    ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1, ['h'] = 1,
+    ['i'] = 1, ['j'] = 1, ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1,
+    ['q'] = 1, ['r'] = 1, ['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1,
+    ['y'] = 1, ['z'] = 1,
+};
+
+// 常用请求头名称，下标与http_header_id_t对应
+static const struct {
+    const char *name;
+    size_t len;
+} known_headers[HTTP_HDR_COUNT] = {
+    [HTTP_HDR_HOST]              = { "Host", 4 },
+    [HTTP_HDR_CONNECTION]        = { "Connection", 10 },
+    [HTTP_HDR_RANGE]             = { "Range", 5 },
+    [HTTP_HDR_IF_RANGE]          = { "If-Range", 8 },
+    [HTTP_HDR_IF_NONE_MATCH]     = { "If-None-Match", 13 },
+    [HTTP_HDR_IF_MODIFIED_SINCE] = { "If-Modified-Since", 17 },
+    [HTTP_HDR_ACCEPT_ENCODING]   = { "Accept-Encoding", 15 },
+};
+
+static inline http_slice_t make_slice(size_t start, size_t end) {
+    http_slice_t slice = { (uint32_t)start, (uint32_t)(end - start) };
+    return slice;
+}
+
+void http_parser_init(http_parser_t *parser, size_t max_header_size, int max_headers) {
+    parser->max_header_size = max_header_size;
+    parser->max_headers = max_headers > 0 && max_headers < HTTP_PARSER_MAX_HEADERS
+                          ? max_headers : HTTP_PARSER_MAX_HEADERS;
+    http_parser_reset(parser);
+}
+
+void http_parser_reset(http_parser_t *parser) {
+    parser->state = S_METHOD;
+    parser->pos = 0;
+    parser->mark = 0;
+    parser->error = 0;
+    parser->header_count = 0;
+    parser->version_minor = 0;
+    parser->method.len = parser->uri.len = parser->path.len = 0;
+    parser->query.len = parser->version.len = 0;
+    memset(parser->known, 0, sizeof(parser->known));
+}
+
+// 记录一个请求头，常用请求头同时归类到known
+static int add_header(http_parser_t *parser, const char *buf, http_slice_t name, http_slice_t value) {
+    if (parser->header_count >= parser->max_headers) {
+        parser->error = 431;
+        return -1;
+    }
+    http_header_t *header = &parser->headers[parser->header_count++];
+    header->name = name;
+    header->value = value;
+
+    for (int id = 0; id < HTTP_HDR_COUNT; id++) {
+        if (known_headers[id].len == name.len &&
+            strncasecmp(buf + name.off, known_headers[id].name, name.len) == 0) {
+            parser->known[id] = value;
+            break;
+        }
+    }
+    return 0;
+}
+
+// 校验版本字符串HTTP/1.x
+static int parse_version(http_parser_t *parser, const char *buf) {
+    const char *v = buf + parser->version.off;
+    if (parser->version.len != 8 || memcmp(v, "HTTP/1.", 7) != 0 || v[7] < '0' || v[7] > '9') {
+        return -1;
+    }
+    parser->version_minor = v[7] - '0';
+    return 0;
+}
+
+#define PARSE_FAIL(code) do { parser->error = (code); parser->pos = i; return HTTP_PARSE_ERROR; } while (0)
+
+int http_parser_execute(http_parser_t *parser, const char *buf, size_t len) {
+    if (parser->state == S_DONE) {
+        return HTTP_PARSE_DONE;
+    }
+    if (parser->error != 0) {
+        return HTTP_PARSE_ERROR;
+    }
+
+    size_t limit = len < parser->max_header_size ? len : parser->max_header_size;
+    size_t i = parser->pos;
+
+    for (; i < limit; i++) {
+        unsigned char c = (unsigned char)buf[i];
+        switch (parser->state) {
+        case S_METHOD:
+            if (c == ' ') {
+                if (i == parser->mark) {
+                    PARSE_FAIL(400);
+                }
+                parser->method = make_slice(parser->mark, i);
+                parser->state = S_URI_START;
+            } else if (!token_chars[c]) {
+                PARSE_FAIL(400);
+            }
+            break;
+
+        case S_URI_START:
+            if (c <= ' ' || c >= 0x7f) {
+                PARSE_FAIL(400);
+            }
+            parser->mark = i;
+            parser->query.off = parser->query.len = 0;
+            parser->path.off = (uint32_t)i;
+            parser->state = S_URI;
+            /* fall through */
+        case S_URI: {
+            // 快速跳到URI结束的空格
+            const char *space = memchr(buf + i, ' ', limit - i);
+            size_t end = space ? (size_t)(space - buf) : limit;
+            for (; i < end; i++) {
+                c = (unsigned char)buf[i];
+                if (c < 0x21 || c == 0x7f) {
+                    PARSE_FAIL(400);
+                }
+                if (c == '?' && parser->query.off == 0) {
+                    parser->path = make_slice(parser->path.off, i);
+                    parser->query.off = (uint32_t)(i + 1);
+                }
+            }
+            if (space == NULL) {
+                i = limit - 1;
+                continue;
+            }
+            parser->uri = make_slice(parser->mark, i);
+            if (parser->query.off != 0) {
+                parser->query = make_slice(parser->query.off, i);
+            } else {
+                parser->path = parser->uri;
+            }
+            parser->mark = i + 1;
+            parser->state = S_VERSION;
+            break;
+        }
+
+        case S_VERSION:
+            if (c == '\r' || c == '\n') {
+                parser->version = make_slice(parser->mark, i);
+                if (parse_version(parser, buf) != 0) {
+                    PARSE_FAIL(400);
+                }
+                parser->state = c == '\r' ? S_REQ_LINE_LF : S_HDR_START;
+            } else if (i - parser->mark >= 8) {
+                PARSE_FAIL(400);
+            }
+            break;
+
+        case S_REQ_LINE_LF:
+            if (c != '\n') {
+                PARSE_FAIL(400);
+            }
+            parser->state = S_HDR_START;
+            break;
+
+        case S_HDR_START:
+            if (c == '\r') {
+                parser->state = S_HEAD_END_LF;
+            } else if (c == '\n') {
+                parser->state = S_DONE;
+                parser->pos = i + 1;
+                return HTTP_PARSE_DONE;
+            } else if (token_chars[c]) {
+                parser->mark = i;
+                parser->state = S_HDR_NAME;
+            } else {
+                PARSE_FAIL(400);
+            }
+            break;
+
+        case S_HDR_NAME:
+            if (c == ':') {
+                parser->header_name = make_slice(parser->mark, i);
+                parser->state = S_HDR_VALUE_START;
+            } else if (!token_chars[c]) {
+                PARSE_FAIL(400);
+            }
+            break;
+
+        case S_HDR_VALUE_START:
+            if (c == ' ' || c == '\t') {
+                break;
+            }
+            parser->mark = i;
+            parser->state = S_HDR_VALUE;
+            /* fall through */
+        case S_HDR_VALUE: {
+            // 快速跳到行尾，值中不允许出现裸CR
+            const char *eol = memchr(buf + i, '\n', limit - i);
+            if (eol == NULL) {
+                i = limit - 1;
+                continue;
+            }
+            size_t end = eol - buf;
+            if (end > parser->mark && buf[end - 1] == '\r') {
+                end--;
+            }
+            if (memchr(buf + parser->mark, '\r', end - parser->mark) != NULL) {
+                PARSE_FAIL(400);
+            }
+            size_t value_end = end;
+            while (value_end > parser->mark && (buf[value_end - 1] == ' ' || buf[value_end - 1] == '\t')) {
+                value_end--;
+            }
+            if (add_header(parser, buf, parser->header_name, make_slice(parser->mark, value_end)) != 0) {
+                parser->pos = i;
+                return HTTP_PARSE_ERROR;
+            }
+            i = eol - buf;
+            parser->state = S_HDR_START;
+            break;
+        }
+
+        case S_HEAD_END_LF:
+            if (c != '\n') {
+                PARSE_FAIL(400);
+            }
+            parser->state = S_DONE;
+            parser->pos = i + 1;
+            return HTTP_PARSE_DONE;
+        }
+    }
+
+    parser->pos = i;
+    if (i >= parser->max_header_size) {
+        // 超出长度限制：仍在请求行时视为URI过长
+        parser->error = parser->state <= S_VERSION ? 414 : 431;
+        return HTTP_PARSE_ERROR;
+    }
+    return HTTP_PARSE_AGAIN;
+}
+
+const http_header_t *http_parser_find_header(const http_parser_t *parser, const char *buf,
+                                             const char *name) {
+    size_t name_len = strlen(name);
+    for (int i = 0; i < parser->header_count; i++) {
+        const http_header_t *header = &parser->headers[i];
+        if (header->name.len == name_len && strncasecmp(buf + header->name.off, name, name_len) == 0) {
+            return header;
+        }
+    }
+    return NULL;
+}
+
+bool http_slice_equals(const char *buf, http_slice_t slice, const char *str) {
+    size_t len = strlen(str);
+    return slice.len == len && memcmp(buf + slice.off, str, len) == 0;
+}
+
+bool http_slice_has_token(const char *buf, http_slice_t slice, const char *token) {
+    size_t token_len = strlen(token);
+    const char *value = buf + slice.off;
+    const char *end = value + slice.len;
+    while (value < end) {
+        while (value < end && (*value == ' ' || *value == '\t' || *value == ',')) {
+            value++;
+        }
+        const char *item = value;
+        while (value < end && *value != ',') {
+            value++;
+        }
+        const char *item_end = value;
+        while (item_end > item && (item_end[-1] == ' ' || item_end[-1] == '\t')) {
+            item_end--;
+        }
+        if ((size_t)(item_end - item) == token_len && strncasecmp(item, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 解析列表项中的q参数，q=0（含0.000等写法）表示不接受
+static bool qvalue_nonzero(const char *p, const char *end) {
+    while (p < end) {
+        while (p < end && (*p == ';' || *p == ' ' || *p == '\t')) {
+            p++;
+        }
+        if (end - p >= 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+            for (p += 2; p < end && *p != ';'; p++) {
+                if (*p >= '1' && *p <= '9') {
+                    return true;
+                }
+            }
+            return false;
+        }
+        while (p < end && *p != ';') {
+            p++;
+        }
+    }
+    return true;
+}
+
+bool http_accepts_encoding(const char *buf, http_slice_t value, const char *coding) {
+    size_t coding_len = strlen(coding);
+    const char *p = buf + value.off;
+    const char *end = p + value.len;
+    int wildcard = -1;      // "*"项：-1未出现，0不接受，1接受
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+        const char *item = p;
+        while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        const char *item_end = p;
+        while (p < end && *p != ',') {
+            p++;
+        }
+        if ((size_t)(item_end - item) == coding_len && strncasecmp(item, coding, coding_len) == 0) {
+            return qvalue_nonzero(item_end, p);
+        }
+        if (item_end - item == 1 && item[0] == '*') {
+            wildcard = qvalue_nonzero(item_end, p);
+        }
+    }
+    return wildcard == 1;
+}
+
+// 解析非负十进制整数，返回下一个字符位置，没有数字或溢出时返回NULL
+static const char *parse_offset(const char *p, const char *end, off_t *out) {
+    off_t value = 0;
+    const char *start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (value > ((off_t)1 << 53)) {
+            return NULL;
+        }
+        value = value * 10 + (*p++ - '0');
+    }
+    if (p == start) {
+        return NULL;
+    }
+    *out = value;
+    return p;
+}
+
+int http_parse_range(const char *buf, http_slice_t value, off_t size,
+                     http_range_t *ranges, int max_ranges) {
+    const char *p = buf + value.off;
+    const char *end = p + value.len;
+    int count = 0;
+    bool any = false;
+
+    if (value.len < 6 || strncasecmp(p, "bytes=", 6) != 0) {
+        return 0;
+    }
+    p += 6;
+    while (p < end) {
+        // 跳过空白及空列表项
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        off_t first = -1, last = -1;
+        if (*p != '-') {
+            p = parse_offset(p, end, &first);
+            if (p == NULL) {
+                return 0;
+            }
+        }
+        if (p == end || *p != '-') {
+            return 0;
+        }
+        p++;
+        if (p < end && *p >= '0' && *p <= '9') {
+            p = parse_offset(p, end, &last);
+            if (p == NULL) {
+                return 0;
+            }
+        }
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        if (p < end && *p != ',') {
+            return 0;
+        }
+
+        http_range_t range;
+        if (first >= 0) {
+            if (last >= 0 && last < first) {
+                return 0;
+            }
+            if (first >= size) {
+                any = true;
+                continue;   // 起始位置超出文件，不可满足
+            }
+            range.start = first;
+            range.end = (last < 0 || last >= size) ? size - 1 : last;
+        } else {
+            // "-n"表示最后n个字节
+            if (last < 0) {
+                return 0;
+            }
+            if (last == 0 || size == 0) {
+                any = true;
+                continue;
+            }
+            range.start = last < size ? size - last : 0;
+            range.end = size - 1;
+        }
+        if (count == max_ranges) {
+            return 0;
+        }
+        ranges[count++] = range;
+        any = true;
+    }
+    if (count == 0) {
+        return any ? -1 : 0;
+    }
+    return count;
+}
+
+// 解析两位数字
+static int parse_2digit(const char *p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
+        return -1;
+    }
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+time_t http_parse_date(const char *buf, http_slice_t value) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    // 固定格式："Sun, 06 Nov 1994 08:49:37 GMT"
+    const char *p = buf + value.off;
+    if (value.len != 29 || p[3] != ',' || p[4] != ' ' || p[7] != ' ' || p[11] != ' ' ||
+        p[16] != ' ' || p[19] != ':' || p[22] != ':' || memcmp(p + 25, " GMT", 4) != 0) {
+        return -1;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_mday = parse_2digit(p + 5);
+    int century = parse_2digit(p + 12);
+    int year = parse_2digit(p + 14);
+    tm.tm_hour = parse_2digit(p + 17);
+    tm.tm_min = parse_2digit(p + 20);
+    tm.tm_sec = parse_2digit(p + 23);
+    tm.tm_mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (memcmp(p + 8, months + i * 3, 3) == 0) {
+            tm.tm_mon = i;
+            break;
+        }
+    }
+    if (tm.tm_mday < 1 || century < 0 || year < 0 || tm.tm_hour < 0 || tm.tm_hour > 23 ||
+        tm.tm_min < 0 || tm.tm_min > 59 || tm.tm_sec < 0 || tm.tm_sec > 60 || tm.tm_mon < 0) {
+        return -1;
+    }
+    tm.tm_year = century * 100 + year - 1900;
+    return timegm(&tm);
+}
+
+bool http_etag_matches(const char *buf, http_slice_t value, const char *etag, bool weak) {
+    size_t etag_len = strlen(etag);
+    const char *p = buf + value.off;
+    const char *end = p + value.len;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        if (*p == '*') {
+            return true;
+        }
+        bool is_weak = false;
+        if (end - p >= 2 && p[0] == 'W' && p[1] == '/') {
+            is_weak = true;
+            p += 2;
+        }
+        // 实体标签为带引号的字符串，其中不含逗号
+        const char *tag = p;
+        if (p < end && *p == '"') {
+            p++;
+            while (p < end && *p != '"') {
+                p++;
+            }
+            if (p < end) {
+                p++;
+            }
+        }
+        if ((size_t)(p - tag) == etag_len && memcmp(tag, etag, etag_len) == 0 && (weak || !is_weak)) {
+            return true;
+        }
+        while (p < end && *p != ',') {
+            p++;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+// 单个请求最多记录的请求头数量
+#define HTTP_PARSER_MAX_HEADERS 64
+// 单个Range请求最多处理的区间数，超出时忽略Range返回完整内容
+#define HTTP_MAX_RANGES 16
+
+// http_parser_execute返回值
+#define HTTP_PARSE_ERROR  -1    // 请求非法，错误状态码见parser->error
+#define HTTP_PARSE_AGAIN   0    // 请求头尚不完整，收到更多数据后继续解析
+#define HTTP_PARSE_DONE    1    // 请求头解析完毕，请求长度为parser->pos
+
+// 字符串片段，以相对读缓冲区起始位置的偏移表示，不复制数据
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} http_slice_t;
+
+// 处理请求时关心的请求头，解析时直接归类
+typedef enum {
+    HTTP_HDR_HOST,
+    HTTP_HDR_CONNECTION,
+    HTTP_HDR_RANGE,
+    HTTP_HDR_IF_RANGE,
+    HTTP_HDR_IF_NONE_MATCH,
+    HTTP_HDR_IF_MODIFIED_SINCE,
+    HTTP_HDR_ACCEPT_ENCODING,
+    HTTP_HDR_COUNT
+} http_header_id_t;
+
+typedef struct {
+    http_slice_t name;
+    http_slice_t value;
+} http_header_t;
+
+// Range请求中的一个字节区间，start与end均包含在内
+typedef struct {
+    off_t start;
+    off_t end;
+} http_range_t;
+
+// 可恢复的请求解析器，数据分多次到达时从上次停止的位置继续
+typedef struct {
+    int state;
+    size_t pos;                 // 已扫描的字节数，完成后即请求长度
+    size_t mark;                // 当前token的起始偏移
+    size_t max_header_size;     // 请求行加请求头的最大字节数
+    int max_headers;            // 请求头最大数量
+    int error;                  // 解析失败时应返回的HTTP状态码
+    http_slice_t header_name;   // 正在解析的请求头名称
+
+    http_slice_t method;
+    http_slice_t uri;           // 完整URI（含查询串）
+    http_slice_t path;          // URI中的路径部分
+    http_slice_t query;         // 查询串（不含'?'），无则长度为0
+    http_slice_t version;
+    int version_minor;          // HTTP/1.x中的x
+
+    http_header_t headers[HTTP_PARSER_MAX_HEADERS];
+    int header_count;
+    http_slice_t known[HTTP_HDR_COUNT];     // 常用请求头的值，未出现时长度为0
+} http_parser_t;
+
+// 初始化解析器并设置长度限制
+void http_parser_init(http_parser_t *parser, size_t max_header_size, int max_headers);
+
+// 重置解析器以解析下一个请求，保留长度限制
+void http_parser_reset(http_parser_t *parser);
+
+// 解析buf中的前len字节，len可以随数据到达逐次增大
+int http_parser_execute(http_parser_t *parser, const char *buf, size_t len);
+
+// 按名称查找请求头（不区分大小写），未找到返回NULL
+const http_header_t *http_parser_find_header(const http_parser_t *parser, const char *buf,
+                                             const char *name);
+
+// 片段在缓冲区中的起始地址
+static inline const char *http_slice_ptr(const char *buf, http_slice_t slice) {
+    return buf + slice.off;
+}
+
+// 比较片段与字符串是否相同（区分大小写）
+bool http_slice_equals(const char *buf, http_slice_t slice, const char *str);
+
+// 判断逗号分隔的字段值中是否包含指定token（不区分大小写）
+bool http_slice_has_token(const char *buf, http_slice_t slice, const char *token);
+
+// 判断Accept-Encoding是否接受指定的内容编码（不区分大小写）
+// 编码出现且q值大于0时接受；未出现时按"*"项的q值决定
+bool http_accepts_encoding(const char *buf, http_slice_t value, const char *coding);
+
+// 解析Range头的bytes区间列表，size为文件大小，不可满足的区间被跳过
+// 返回区间数；格式错误、单位不是bytes或区间超过max_ranges时返回0，表示忽略Range；
+// 全部区间都不可满足时返回-1，应回复416
+int http_parse_range(const char *buf, http_slice_t value, off_t size,
+                     http_range_t *ranges, int max_ranges);
+
+// 解析IMF-fixdate格式的HTTP日期（如"Sun, 06 Nov 1994 08:49:37 GMT"），失败返回-1
+time_t http_parse_date(const char *buf, http_slice_t value);
+
+// 判断实体标签列表（If-None-Match/If-Range）是否与etag匹配，etag需带引号
+// weak为真时使用弱比较（忽略W/前缀），否则带W/前缀的标签不匹配
+bool http_etag_matches(const char *buf, http_slice_t value, const char *etag, bool weak);
+
+#endif // HTTP_PARSER_H
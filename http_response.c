@@ -0,0 +1,107 @@
+#define _GNU_SOURCE
+#include "http_response.h"
+#include <stdio.h>
+
+// 预先生成的状态行
+typedef struct {
+    int code;
+    const char *line;
+    size_t len;
+} http_status_line_t;
+
+#define STATUS_LINE(code, reason) \
+    { code, "HTTP/1.1 " #code " " reason "\r\n", sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1 }
+
+static const http_status_line_t http_status_lines[] = {
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(206, "Partial Content"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(403, "Forbidden"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(414, "Request-URI Too Long"),
+    STATUS_LINE(416, "Range Not Satisfiable"),
+    STATUS_LINE(431, "Request Header Fields Too Large"),
+    STATUS_LINE(500, "Internal Server Error"),
+};
+
+#define STATUS_COUNT (sizeof(http_status_lines) / sizeof(http_status_lines[0]))
+
+// 查找状态行，未知状态码按500处理
+static const http_status_line_t *http_status_line(int status_code) {
+    for (size_t i = 0; i < STATUS_COUNT; i++) {
+        if (http_status_lines[i].code == status_code) {
+            return &http_status_lines[i];
+        }
+    }
+    return &http_status_lines[STATUS_COUNT - 1];
+}
+
+size_t format_http_date(char *buf, time_t t) {
+    static const char days[7][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char months[12][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    int year = tm.tm_year + 1900;
+    memcpy(buf, days[tm.tm_wday], 3);
+    buf[3] = ',';
+    buf[4] = ' ';
+    buf[5] = '0' + tm.tm_mday / 10;
+    buf[6] = '0' + tm.tm_mday % 10;
+    buf[7] = ' ';
+    memcpy(buf + 8, months[tm.tm_mon], 3);
+    buf[11] = ' ';
+    buf[12] = '0' + year / 1000 % 10;
+    buf[13] = '0' + year / 100 % 10;
+    buf[14] = '0' + year / 10 % 10;
+    buf[15] = '0' + year % 10;
+    buf[16] = ' ';
+    buf[17] = '0' + tm.tm_hour / 10;
+    buf[18] = '0' + tm.tm_hour % 10;
+    buf[19] = ':';
+    buf[20] = '0' + tm.tm_min / 10;
+    buf[21] = '0' + tm.tm_min % 10;
+    buf[22] = ':';
+    buf[23] = '0' + tm.tm_sec / 10;
+    buf[24] = '0' + tm.tm_sec % 10;
+    memcpy(buf + 25, " GMT", 5);
+    return 29;
+}
+
+void append_number(strbuf_t *sb, uint64_t value) {
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    strbuf_append(sb, p, digits + sizeof(digits) - p);
+}
+
+int http_begin_header(strbuf_t *sb, int status_code, const char *date, bool keep_alive) {
+    const http_status_line_t *status = http_status_line(status_code);
+    if (strbuf_reserve(sb, 256) != 0) {
+        perror("HTTP response buffer");
+        return status->code;
+    }
+    strbuf_append(sb, status->line, status->len);
+    APPEND_LITERAL(sb, "Server: MultiProtocolServer\r\nDate: ");
+    strbuf_append(sb, date, HTTP_DATE_LEN);
+    if (keep_alive) {
+        APPEND_LITERAL(sb, "\r\nConnection: keep-alive\r\n");
+    } else {
+        APPEND_LITERAL(sb, "\r\nConnection: close\r\n");
+    }
+    return status->code;
+}
+
+void append_entity_headers(strbuf_t *sb, const char *content_type, off_t content_length) {
+    APPEND_LITERAL(sb, "Content-Type: ");
+    append_str(sb, content_type);
+    if (content_length >= 0) {
+        APPEND_LITERAL(sb, "\r\nContent-Length: ");
+        append_number(sb, (uint64_t)content_length);
+    }
+    APPEND_LITERAL(sb, "\r\n");
+}
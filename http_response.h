@@ -0,0 +1,37 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "utils.h"
+
+// 响应头的格式化：状态行、通用头及正文描述头，只追加到strbuf，不涉及连接状态
+
+// HTTP日期（IMF-fixdate）的长度
+#define HTTP_DATE_LEN 29
+
+// 追加字符串字面量，长度在编译时确定
+#define APPEND_LITERAL(sb, lit) strbuf_append((sb), (lit), sizeof(lit) - 1)
+
+// 追加C字符串
+static inline void append_str(strbuf_t *sb, const char *str) {
+    strbuf_append(sb, str, strlen(str));
+}
+
+// 追加十进制整数
+void append_number(strbuf_t *sb, uint64_t value);
+
+// 格式化IMF-fixdate格式的HTTP日期（固定29字节），buf至少30字节
+size_t format_http_date(char *buf, time_t t);
+
+// 写入状态行及通用响应头：预先生成的状态行、Server、Date（date为已格式化的29字节）和Connection
+// 返回实际使用的状态码，未知状态码按500处理
+int http_begin_header(strbuf_t *sb, int status_code, const char *date, bool keep_alive);
+
+// 追加描述响应正文的头字段，content_length小于0时省略Content-Length
+void append_entity_headers(strbuf_t *sb, const char *content_type, off_t content_length);
+
+#endif // HTTP_RESPONSE_H
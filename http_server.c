@@ -13,84 +13,283 @@
 #include <errno.h>
 #include <ctype.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <poll.h>
 
 #include "config.h"
 #include "server.h"
 #include "http_server.h"
 #include "utils.h"
+#include "http_parser.h"
+#include "path_cache.h"
+#include "file_cache.h"
+#include "dir_cache.h"
+#include "compress.h"
+#include "mime.h"
+#include "mempool.h"
+#include "logMgr.h"
+#include "uring.h"
+#include "access_log.h"
+#include "metrics.h"
+#include "http_response.h"
+#include "listing.h"
+#define APP_ID "SRV"
 
 
 #define BUFFER_SIZE 4096
 #define MAX_PATH 4096
+#define MAX_EVENTS 64
+// 每个连接单轮最多发送的文件字节数，保证大文件下载与其他客户端交错进行
+#define SEND_QUANTUM (512 * 1024)
+// 禁用长连接时，读取请求及关闭前等待对端的超时（秒）
+#define HTTP_IDLE_TIMEOUT 10
 
-// 全局变量，保存HTTP服务器socket
-static int http_server_fd = -1;
+// conn_flush返回值
+#define FLUSH_ERROR   -1
+#define FLUSH_BLOCKED  0    // socket不可写，等待EPOLLOUT（io_uring后端：等待可写或splice完成）
+#define FLUSH_DONE     1    // 响应已全部发送
+#define FLUSH_YIELD    2    // 本轮配额用完，稍后继续发送
 
+// io_uring后端参数
+#define URING_ENTRIES           256     // 提交队列项数
+#define URING_RECV_BUFFERS      512     // 每个工作线程的接收缓冲区数（2的幂）
+#define URING_RECV_BUFFER_SIZE  4096
+#define URING_RECV_HELD_MAX     16      // 单个连接最多暂存的接收缓冲区，超出时暂停接收
+#define URING_SPLICE_CHUNK      (64 * 1024) // 每对splice发送的字节数，不超过默认管道容量
 
+// io_uring请求标识：连接指针（按缓存行对齐）的低位记录请求类型
+#define URING_OP_RECV       1
+#define URING_OP_POLL       2
+#define URING_OP_SPLICE_IN  3
+#define URING_OP_SPLICE_OUT 4
+#define URING_OP_CANCEL     5
+#define URING_OP_MASK       7
 
-// 发送HTTP响应头
-static void send_http_header(int client_fd, int status_code, 
-                            const char *content_type, off_t content_length) {
-    char header[BUFFER_SIZE];
-    const char *status_msg;
-    
-    switch (status_code) {
-        case 200: status_msg = "OK"; break;
-        case 403: status_msg = "Forbidden"; break;
-        case 404: status_msg = "Not Found"; break;
-        case 414: status_msg = "Request-URI Too Long"; break;
-        case 500: status_msg = "Internal Server Error"; break;
-        default:  status_msg = "Unknown";
+// 退出通知用的eventfd，所有工作线程共享，信号处理函数写入后epoll立即返回
+static int http_wakeup_fd = -1;
+// 所有工作线程当前持有的连接数，受max_connections约束
+static int http_active_conns = 0;
+// 工作线程启动失败时用于单独停止HTTP服务，不影响FTP
+static volatile bool http_stopping = false;
+// 路径解析及文件信息缓存，所有工作线程共享
+static path_cache_t *http_path_cache = NULL;
+// 小文件内容缓存，所有工作线程共享，禁用时为NULL
+static file_cache_t *http_file_cache = NULL;
+// 即时gzip压缩结果缓存，按源文件路径索引，禁用或不支持压缩时为NULL
+static file_cache_t *http_gzip_cache = NULL;
+// 目录列表缓存，所有工作线程共享，禁用时为NULL
+static dir_cache_t *http_dir_cache = NULL;
+// MIME类型表，启动时构建，之后只读
+static mime_registry_t *http_mime_types = NULL;
+// 多段Range响应的边界序号
+static uint32_t http_boundary_seq = 0;
+
+
+// epoll事件（及io_uring请求）标识：监听socket、唤醒fd和目录监视fd使用固定标记，其余为连接指针
+static int listen_token, wakeup_token, inotify_token;
+
+typedef struct http_conn http_conn_t;
+
+// HTTP工作线程上下文，每个线程拥有独立的监听socket和epoll（或io_uring）实例
+typedef struct {
+    int id;
+    pthread_t thread;
+    int listen_fd;
+    int epoll_fd;               // epoll后端，使用io_uring时为-1
+    uring_t *ring;              // io_uring后端，NULL表示使用epoll
+    http_conn_t *closed;        // 已关闭、等待io_uring请求全部结束后释放的连接
+    uint16_t *held_next;        // 按缓冲区编号：连接暂存队列中的下一个缓冲区
+    uint32_t *held_len;         // 按缓冲区编号：接收到的字节数
+    unsigned bufs_held;         // 连接暂存的缓冲区总数
+    bool recv_starved;          // 有连接因缓冲区耗尽停止接收
+    const HttpServerConfig *config;
+    http_conn_t *pending;       // 配额用完、待继续发送的连接
+    http_conn_t *conn_head;     // 全部连接，按最近活动时间排序，用于空闲超时
+    http_conn_t *conn_tail;
+    buffer_pool_t *conn_pool;   // 连接结构
+    buffer_pool_t *buf_pool;    // 读缓冲区及连接arena的块，大小为max_header_size
+    uint64_t now_ms;            // 本轮事件循环的单调时钟（毫秒）
+    time_t date_sec;            // date对应的秒数
+    char date[32];              // 缓存的Date头取值，每秒更新一次
+} http_worker_t;
+
+// HTTP连接状态
+struct http_conn {
+    int fd;
+    struct sockaddr_in addr;
+    http_worker_t *worker;
+    char *rbuf;                 // 请求读缓冲区，可包含多个流水线请求，容量为max_header_size
+                                // 取自工作线程的缓冲区池，连接空闲且无未处理数据时归还
+    size_t rlen;
+    size_t rcap;
+    http_parser_t parser;       // 当前请求的解析状态，字段以rbuf内偏移表示
+    arena_t arena;              // 处理当前请求的临时内存，响应发送完毕后重置
+    size_t req_len;             // 当前请求在读缓冲区中占用的字节数
+    bool readable;              // 上次读取后socket可能仍有数据（边缘触发）
+    bool peer_closed;           // 对端已关闭写端
+    bool keep_alive;            // 当前响应完成后保持连接
+    bool lingering;             // 已关闭写端，丢弃剩余请求数据直到对端关闭
+    int requests;               // 该连接已处理的请求数
+    strbuf_t wbuf;              // 待发送数据（响应头及内存中生成的正文）
+    size_t wpos;
+    int file_fd;                // 待发送的文件正文，-1表示无
+    path_cache_entry_t *file_entry; // file_fd所属的路径缓存项（持有引用），fd由缓存项管理
+    const char *body;           // 内存中的正文（缓存内容或预生成的错误页），与wbuf一起writev发送，NULL表示无
+    size_t body_len;
+    size_t body_pos;            // 缓存正文已发送的字节数
+    file_cache_entry_t *body_file;  // body所属的内容缓存项（持有引用）
+    dir_cache_entry_t *body_dir;    // body所属的目录列表缓存项（持有引用）
+    off_t file_off;             // 文件下一个待发送字节的偏移
+    off_t file_end;             // 文件正文结束偏移
+    http_range_t ranges[HTTP_MAX_RANGES];   // 多段Range响应的各区间
+    int range_count;            // 多段响应的区间数，0表示不是多段响应
+    int range_next;             // 下一个待发送的区间
+    off_t range_size;           // 文件总大小，用于Content-Range
+    const char *range_type;     // 文件的MIME类型，写入每个分段头
+    char boundary[24];          // multipart/byteranges的分隔边界
+    int pipe_fds[2];            // sendfile不可用时splice使用的管道，-1表示未创建
+    size_t pipe_len;            // 已进入管道尚未发往socket的字节数
+    bool use_splice;
+    bool responded;             // 响应已生成，等待发送完毕
+    bool pending;               // 是否在工作线程的待发送链表中
+    http_conn_t *prev;
+    http_conn_t *next;
+    uint64_t last_active;       // 最近一次活动时间（毫秒）
+    http_conn_t *lru_prev;
+    http_conn_t *lru_next;
+    // 当前请求各阶段的单调时钟（纳秒），用于运行统计及访问日志，0表示尚未经历
+    uint64_t t_start;           // 收到请求的首个字节
+    uint64_t t_parse;
+    uint64_t t_resolve;
+    uint64_t t_first_byte;
+    uint64_t bytes_sent;        // 当前响应已发送的字节数
+    int status;                 // 当前响应的状态码
+    // io_uring后端
+    int uring_ops;              // 未结束的请求数，为0后才能释放连接结构
+    int held_count;             // 已接收、尚未复制到读缓冲区的提供缓冲区
+    uint16_t held_head;
+    uint16_t held_tail;
+    uint32_t held_off;          // 队首缓冲区已复制的字节数
+    int splicing;               // 进行中的splice请求数
+    int splice_err;             // splice失败的负errno，1表示文件提前结束
+    bool closing;               // 已关闭，等待请求取消完毕
+    bool recv_armed;            // 多次接收请求仍然有效
+    bool recv_cancel;           // 暂存过多，已请求取消接收
+    bool recv_eof;              // 接收到对端关闭
+    bool poll_armed;            // 正在等待socket可写
+};
+
+// 更新工作线程缓存的Date头，每秒只格式化一次
+static void worker_update_date(http_worker_t *worker) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    if (ts.tv_sec != worker->date_sec) {
+        worker->date_sec = ts.tv_sec;
+        format_http_date(worker->date, ts.tv_sec);
     }
-    
-    snprintf(header, sizeof(header), 
-             "HTTP/1.1 %d %s\r\n"
-             "Server: MultiProtocolServer\r\n"
-             "Content-Type: %s\r\n",
-             status_code, status_msg, content_type);
-    
-    if (content_length >= 0) {
-        char length_str[64];
-        snprintf(length_str, sizeof(length_str), "Content-Length: %ld\r\n", (long)content_length);
-        strncat(header, length_str, sizeof(header) - strlen(header) - 1);
+}
+
+// 写入状态行及通用响应头，使用工作线程缓存的Date
+static void begin_http_header(http_conn_t *conn, int status_code) {
+    conn->status = http_begin_header(&conn->wbuf, status_code, conn->worker->date, conn->keep_alive);
+}
+
+// 文件响应的表示：MIME类型、内容编码及由实际发送的文件得出的校验器
+typedef struct {
+    const char *mime_type;
+    const char *encoding;       // Content-Encoding，NULL表示未编码
+    bool vary;                  // 按Accept-Encoding协商，需输出Vary
+    char etag[48];
+    char last_modified[32];
+} file_repr_t;
+
+// 以十六进制写入value，返回写入的字符数
+static size_t format_hex(char *buf, uint64_t value) {
+    char digits[16];
+    size_t n = 0;
+    do {
+        digits[n++] = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = digits[n - 1 - i];
     }
-    
-    strncat(header, "\r\n", sizeof(header) - strlen(header) - 1);
-    ssize_t written = write(client_fd, header, strlen(header));
-    if (written <= 0) {
-        perror("write");
-        // Optionally handle partial write or error
+    return n;
+}
+
+// 生成表示的校验器：强ETag由修改时间（毫秒）和大小组成，编码后的表示附加编码名以示区别
+static void format_file_validators(file_repr_t *repr, const struct stat *st) {
+    uint64_t mtime_ms = (uint64_t)st->st_mtim.tv_sec * 1000 + st->st_mtim.tv_nsec / 1000000;
+    char *p = repr->etag;
+    *p++ = '"';
+    p += format_hex(p, mtime_ms);
+    *p++ = '-';
+    p += format_hex(p, (uint64_t)st->st_size);
+    if (repr->encoding != NULL) {
+        size_t len = strlen(repr->encoding);
+        *p++ = '-';
+        memcpy(p, repr->encoding, len);
+        p += len;
     }
+    *p++ = '"';
+    *p = '\0';
+    format_http_date(repr->last_modified, st->st_mtime);
 }
 
-// 发送错误页面
-static void send_error_page(int client_fd, int status_code) {
-    const char *title, *message;
-    
-    switch (status_code) {
-        case 403:
-            title = "403 Forbidden";
-            message = "You don't have permission to access this resource.";
-            break;
-        case 404:
-            title = "404 Not Found";
-            message = "The requested resource was not found on this server.";
-            break;
-        case 414:
-            title = "414 Request-URI Too Long";
-            message = "The requested URL is too long for the server to process.";
-            break;
-        case 500:
-            title = "500 Internal Server Error";
-            message = "The server encountered an internal error.";
-            break;
-        default:
-            title = "Error";
-            message = "An unknown error occurred.";
+// 追加文件响应的头字段，包括编码、校验器及Accept-Ranges（编码后的表示不支持Range）
+static void append_file_headers(strbuf_t *sb, const file_repr_t *repr,
+                                const char *content_type, off_t content_length) {
+    append_entity_headers(sb, content_type, content_length);
+    if (repr->encoding != NULL) {
+        APPEND_LITERAL(sb, "Content-Encoding: ");
+        append_str(sb, repr->encoding);
+        APPEND_LITERAL(sb, "\r\n");
     }
-    
-    char html[BUFFER_SIZE];
-    snprintf(html, sizeof(html),
+    if (repr->vary) {
+        APPEND_LITERAL(sb, "Vary: Accept-Encoding\r\n");
+    }
+    APPEND_LITERAL(sb, "Last-Modified: ");
+    strbuf_append(sb, repr->last_modified, 29);
+    APPEND_LITERAL(sb, "\r\nETag: ");
+    append_str(sb, repr->etag);
+    APPEND_LITERAL(sb, "\r\n");
+    if (repr->encoding == NULL) {
+        APPEND_LITERAL(sb, "Accept-Ranges: bytes\r\n");
+    }
+}
+
+// 预先生成的错误响应：实体头、结束空行与HTML正文，启动时生成一次
+// 发送时只写入状态行等通用头，错误正文与其一起writev发出
+typedef struct {
+    int code;
+    const char *title;
+    const char *message;
+    strbuf_t response;
+} http_error_page_t;
+
+static http_error_page_t http_error_pages[] = {
+    { 400, "400 Bad Request", "The server could not understand the request.", {0} },
+    { 403, "403 Forbidden", "You don't have permission to access this resource.", {0} },
+    { 404, "404 Not Found", "The requested resource was not found on this server.", {0} },
+    { 414, "414 Request-URI Too Long", "The requested URL is too long for the server to process.", {0} },
+    { 431, "431 Request Header Fields Too Large", 
+      "The request headers are too large for the server to process.", {0} },
+    { 503, "503 Service Unavailable", "The server is temporarily unable to handle the request.", {0} },
+    // 500需放在最后，作为未知状态码的默认页面
+    { 500, "500 Internal Server Error", "The server encountered an internal error.", {0} },
+};
+
+#define ERROR_PAGE_COUNT (sizeof(http_error_pages) / sizeof(http_error_pages[0]))
+
+// 生成全部错误响应
+static int http_error_pages_init(void) {
+    for (size_t i = 0; i < ERROR_PAGE_COUNT; i++) {
+        http_error_page_t *page = &http_error_pages[i];
+        strbuf_t html = {0};
+        int ret = strbuf_printf(&html,
              "<!DOCTYPE html>\n"
              "<html>\n"
              "<head>\n"
@@ -112,26 +311,61 @@ static void send_error_page(int client_fd, int status_code) {
              "    </div>\n"
              "</body>\n"
              "</html>",
-             title, title, message);
-    
-    send_http_header(client_fd, status_code, "text/html", strlen(html));
-    ssize_t written = write(client_fd, html, strlen(html));
-    if (written <= 0) {
-        perror("write");
-        // Optionally handle partial write or error
+             page->title, page->title, page->message);
+        if (ret == 0) {
+            append_entity_headers(&page->response, "text/html", html.len);
+            APPEND_LITERAL(&page->response, "\r\n");
+            ret = strbuf_append(&page->response, html.data, html.len);
+        }
+        strbuf_free(&html);
+        if (ret != 0) {
+            perror("HTTP error pages");
+            return -1;
+        }
     }
+    return 0;
 }
 
-// 发送目录列表页面
-static void send_directory_listing(int client_fd, const char *request_path, 
-                                  const char *full_path, const HttpServerConfig *http_config) {
+static void http_error_pages_free(void) {
+    for (size_t i = 0; i < ERROR_PAGE_COUNT; i++) {
+        strbuf_free(&http_error_pages[i].response);
+    }
+}
+
+// 发送错误页面，未知状态码按500处理
+static void send_error_page(http_conn_t *conn, int status_code) {
+    const http_error_page_t *page = &http_error_pages[ERROR_PAGE_COUNT - 1];
+    for (size_t i = 0; i < ERROR_PAGE_COUNT; i++) {
+        if (http_error_pages[i].code == status_code) {
+            page = &http_error_pages[i];
+            break;
+        }
+    }
+    begin_http_header(conn, page->code);
+    conn->body = page->response.data;
+    conn->body_len = page->response.len;
+    conn->body_pos = 0;
+}
+
+// 将目录列表HTML生成到可增长缓冲区，目录无法打开或内存不足时返回-1
+// dir_fd为路径缓存中已打开的目录，另行打开一次以获得独立的读取位置，多个线程可同时生成
+static int render_directory_listing(strbuf_t *html, const char *request_path, 
+                                    int dir_fd, const HttpServerConfig *http_config) {
     DIR *dir;
     struct dirent *entry;
-    char html[BUFFER_SIZE * 4];
-    int html_len = 0;
+    
+    // 尝试打开目录
+    int fd = openat(dir_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if ((dir = fdopendir(fd)) == NULL) {
+        close(fd);
+        return -1;
+    }
     
     // 开始构建HTML
-    html_len += snprintf(html + html_len, sizeof(html) - html_len,
+    int ret = strbuf_printf(html,
                         "<!DOCTYPE html>\n"
                         "<html>\n"
                         "<head>\n"
@@ -161,346 +395,1983 @@ static void send_directory_listing(int client_fd, const char *request_path,
                         "        </tr>\n",
                         request_path, request_path);
     
-    // 尝试打开目录
-    if ((dir = opendir(full_path)) == NULL) {
-        send_error_page(client_fd, 403);
-        return;
+    // 添加上级目录链接（如果不是根目录），忽略末尾的斜杠
+    size_t path_len = strlen(request_path);
+    while (path_len > 1 && request_path[path_len - 1] == '/') {
+        path_len--;
     }
-    
-    // 添加上级目录链接（如果不是根目录）
-    if (strcmp(request_path, "/") != 0) {
-        char parent_path[MAX_PATH];
-        const char *last_slash = strrchr(request_path, '/');
-        
-        if (last_slash == request_path) {
-            strcpy(parent_path, "/");
-        } else {
-            size_t parent_len = last_slash - request_path;
-            if (parent_len >= MAX_PATH) {
-                goto skip_parent;  // 路径过长，跳过上级目录处理
-            }
-            strncpy(parent_path, request_path, parent_len);
-            parent_path[parent_len] = '\0';
-            if (parent_path[0] == '\0') strcpy(parent_path, "/");
+    if (ret == 0 && path_len > 1) {
+        size_t parent_len = path_len - 1;
+        while (parent_len > 0 && request_path[parent_len] != '/') {
+            parent_len--;
         }
-        
-        html_len += snprintf(html + html_len, sizeof(html) - html_len,
+        ret = strbuf_printf(html,
                             "        <tr>\n"
-                            "            <td><a href=\"%s\" class=\"dir\">../</a></td>\n"
+                            "            <td><a href=\"%.*s\" class=\"dir\">../</a></td>\n"
                             "            <td></td>\n"
                             "            <td class=\"size\"></td>\n"
                             "        </tr>\n",
-                            parent_path);
+                            parent_len > 0 ? (int)parent_len : 1, request_path);
     }
-    skip_parent:  // 用于跳过上级目录处理的标签
     
-    // 列出目录中的所有条目
-    while ((entry = readdir(dir)) != NULL) {
+    // 列出目录中的所有条目，相对目录fd获取文件信息，无需拼接完整路径
+    const char *separator = request_path[strlen(request_path) - 1] == '/' ? "" : "/";
+    while (ret == 0 && (entry = readdir(dir)) != NULL) {
         // 跳过.和..
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
             continue;
         
-        // 安全构建条目路径
-        char entry_path[MAX_PATH];
-        if (!safe_path_join(entry_path, sizeof(entry_path), full_path, entry->d_name, "/")) {
-            fprintf(stderr, "Path too long: %s/%s\n", full_path, entry->d_name);
-            continue;  // 路径过长，跳过该条目
-        }
-        
         struct stat st;
-        if (stat(entry_path, &st) == -1)
+        if (fstatat(dir_fd, entry->d_name, &st, 0) == -1)
             continue;
-        
-        // 安全构建URL路径
-        char url_path[MAX_PATH];
-        if (strcmp(request_path, "/") == 0) {
-            if (!safe_path_join(url_path, sizeof(url_path), "", entry->d_name, "/")) {
-                fprintf(stderr, "URL too long: /%s\n", entry->d_name);
-                continue;
+        ret = listing_append_html_row(html, request_path, separator, entry->d_name, &st);
+    }
+    
+    closedir(dir);
+    
+    // 完成HTML
+    if (ret == 0) {
+        ret = strbuf_printf(html,
+                            "    </table>\n"
+                            "    <div style=\"margin-top: 20px; color: #666;\">\n"
+                            "        MultiProtocol Server - HTTP on port %d\n"
+                            "    </div>\n"
+                            "</body>\n"
+                            "</html>",
+                            http_config->port);
+    }
+    return ret;
+}
+
+// 写入目录列表的响应头，encoding为NULL时正文为未压缩的HTML
+static void send_listing_header(http_conn_t *conn, off_t content_length, const char *encoding, bool vary) {
+    begin_http_header(conn, 200);
+    append_entity_headers(&conn->wbuf, "text/html", content_length);
+    if (encoding != NULL) {
+        APPEND_LITERAL(&conn->wbuf, "Content-Encoding: ");
+        append_str(&conn->wbuf, encoding);
+        APPEND_LITERAL(&conn->wbuf, "\r\n");
+    }
+    if (vary) {
+        APPEND_LITERAL(&conn->wbuf, "Vary: Accept-Encoding\r\n");
+    }
+    APPEND_LITERAL(&conn->wbuf, "\r\n");
+}
+
+// 发送目录列表页面
+// 生成的列表按请求路径缓存，目录内容变化时由inotify通知失效，重复请求只需一次哈希查找
+static void send_directory_listing(http_conn_t *conn, const char *request_path, 
+                                  const path_cache_entry_t *dir_entry, const HttpServerConfig *http_config) {
+    dir_cache_entry_t *cached = NULL;
+    dir_cache_ticket_t ticket = { -1, 0 };
+    metrics_inc(METRIC_HTTP_LISTING_RESPONSES);
+    
+    if (http_dir_cache != NULL) {
+        cached = dir_cache_get(http_dir_cache, request_path, &dir_entry->st);
+        if (cached == NULL) {
+            dir_cache_watch(http_dir_cache, dir_entry->real_path, &ticket);
+        }
+    }
+    
+    if (cached == NULL) {
+        strbuf_t html = {0};
+        if (render_directory_listing(&html, request_path, dir_entry->fd, http_config) != 0) {
+            int err = errno;
+            strbuf_free(&html);
+            if (http_dir_cache != NULL) {
+                dir_cache_unwatch(http_dir_cache, &ticket);
             }
-        } else {
-            if (!safe_path_join(url_path, sizeof(url_path), request_path, entry->d_name, "/")) {
-                fprintf(stderr, "URL too long: %s/%s\n", request_path, entry->d_name);
-                continue;
+            send_error_page(conn, err == ENOMEM ? 500 : 403);
+            return;
+        }
+        if (http_dir_cache != NULL && dir_cache_fits(http_dir_cache, request_path, html.len)) {
+            // 压缩版本与列表一起缓存，只在生成时压缩一次；两者合计超出容量时只缓存列表
+            char *gz = NULL;
+            size_t gz_len = 0;
+            if (http_config->compression && html.len >= (size_t)http_config->compression_min_size &&
+                gzip_compress(html.data, html.len, http_config->compression_level, &gz, &gz_len) != 0) {
+                gz = NULL;
+            }
+            if (gz != NULL && !dir_cache_fits(http_dir_cache, request_path, html.len + gz_len)) {
+                free(gz);
+                gz = NULL;
             }
+            cached = dir_cache_put(http_dir_cache, request_path, &ticket, &dir_entry->st, 
+                                   html.data, html.len, gz, gz_len);
+            free(gz);
+        } else if (http_dir_cache != NULL) {
+            // 列表超出缓存容量，不压缩，每次请求都重新生成
+            dir_cache_unwatch(http_dir_cache, &ticket);
         }
-        
-        // 如果是目录，确保路径以斜杠结尾
-        if (S_ISDIR(st.st_mode) && url_path[strlen(url_path)-1] != '/') {
-            if (strlen(url_path) + 1 < sizeof(url_path)) {
-                strcat(url_path, "/");
-            } else {
-                fprintf(stderr, "URL too long: %s/\n", url_path);
-                continue;
+        if (cached == NULL) {
+            // 未能缓存（目录正在变化、列表过大等），直接从缓冲区发送，不随Accept-Encoding变化
+            send_listing_header(conn, html.len, NULL, false);
+            if (strbuf_append(&conn->wbuf, html.data, html.len) != 0) {
+                perror("HTTP response buffer");
             }
+            strbuf_free(&html);
+            return;
         }
+        strbuf_free(&html);
+    }
+    
+    // 响应头写入发送缓冲区，缓存的列表与其一起writev发出
+    http_slice_t accept = conn->parser.known[HTTP_HDR_ACCEPT_ENCODING];
+    conn->body_dir = cached;
+    conn->body_pos = 0;
+    if (cached->gz_body != NULL && accept.len > 0 && http_accepts_encoding(conn->rbuf, accept, "gzip")) {
+        send_listing_header(conn, cached->gz_len, "gzip", true);
+        conn->body = cached->gz_body;
+        conn->body_len = cached->gz_len;
+    } else {
+        send_listing_header(conn, cached->body_len, NULL, cached->gz_body != NULL);
+        conn->body = cached->body;
+        conn->body_len = cached->body_len;
+    }
+}
+
+// 条件请求：If-None-Match优先于If-Modified-Since，文件未变化时返回true
+static bool file_not_modified(const http_conn_t *conn, const file_repr_t *repr, time_t mtime) {
+    http_slice_t if_none_match = conn->parser.known[HTTP_HDR_IF_NONE_MATCH];
+    if (if_none_match.len > 0) {
+        return http_etag_matches(conn->rbuf, if_none_match, repr->etag, true);
+    }
+    http_slice_t if_modified_since = conn->parser.known[HTTP_HDR_IF_MODIFIED_SINCE];
+    if (if_modified_since.len > 0) {
+        time_t since = http_parse_date(conn->rbuf, if_modified_since);
+        return since != -1 && mtime <= since;
+    }
+    return false;
+}
+
+// If-Range中的校验器与文件当前一致时才发送部分内容，否则发送完整文件
+static bool file_range_applies(const http_conn_t *conn, const file_repr_t *repr) {
+    http_slice_t if_range = conn->parser.known[HTTP_HDR_IF_RANGE];
+    if (if_range.len == 0) {
+        return true;
+    }
+    const char *value = http_slice_ptr(conn->rbuf, if_range);
+    if (value[0] == '"' || (if_range.len > 2 && value[0] == 'W' && value[1] == '/')) {
+        return http_etag_matches(conn->rbuf, if_range, repr->etag, false);
+    }
+    return http_slice_equals(conn->rbuf, if_range, repr->last_modified);
+}
+
+// 多段响应中每个区间前的边界及分段头
+static void append_range_part(strbuf_t *sb, const http_conn_t *conn, const http_range_t *range) {
+    APPEND_LITERAL(sb, "\r\n--");
+    append_str(sb, conn->boundary);
+    APPEND_LITERAL(sb, "\r\nContent-Type: ");
+    append_str(sb, conn->range_type);
+    APPEND_LITERAL(sb, "\r\nContent-Range: bytes ");
+    append_number(sb, range->start);
+    APPEND_LITERAL(sb, "-");
+    append_number(sb, range->end);
+    APPEND_LITERAL(sb, "/");
+    append_number(sb, conn->range_size);
+    APPEND_LITERAL(sb, "\r\n\r\n");
+}
+
+// 多段响应的结束边界
+static void append_range_end(strbuf_t *sb, const http_conn_t *conn) {
+    APPEND_LITERAL(sb, "\r\n--");
+    append_str(sb, conn->boundary);
+    APPEND_LITERAL(sb, "--\r\n");
+}
+
+// 发送文件的部分内容（206），接管entry的引用
+// 单个区间直接从对应偏移sendfile；多个区间按multipart/byteranges逐段发送，分段头在发送时生成
+static void send_file_ranges(http_conn_t *conn, path_cache_entry_t *entry, const file_repr_t *repr,
+                             int nranges) {
+    strbuf_t *sb = &conn->wbuf;
+    off_t size = entry->st.st_size;
+    
+    begin_http_header(conn, 206);
+    if (nranges == 1) {
+        const http_range_t *range = &conn->ranges[0];
+        append_file_headers(sb, repr, repr->mime_type, range->end - range->start + 1);
+        APPEND_LITERAL(sb, "Content-Range: bytes ");
+        append_number(sb, range->start);
+        APPEND_LITERAL(sb, "-");
+        append_number(sb, range->end);
+        APPEND_LITERAL(sb, "/");
+        append_number(sb, size);
+        APPEND_LITERAL(sb, "\r\n\r\n");
+        conn->file_off = range->start;
+        conn->file_end = range->end + 1;
+    } else {
+        uint32_t seq = __atomic_add_fetch(&http_boundary_seq, 1, __ATOMIC_RELAXED);
+        snprintf(conn->boundary, sizeof(conn->boundary), "%08x%08x",
+                 (unsigned)conn->worker->now_ms, (unsigned)seq);
+        conn->range_type = repr->mime_type;
+        conn->range_size = size;
         
-        // 格式化最后修改时间
-        char time_str[64];
-        struct tm *tm_info = localtime(&st.st_mtime);
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", tm_info);
-        
-        // 获取文件大小
-        const char *size_str = "-";
-        if (!S_ISDIR(st.st_mode)) {
-            size_str = get_file_size_str(st.st_size);
+        // 预先计算整个multipart正文的长度：分段头先写入缓冲区尾部计量，再截掉
+        size_t mark = sb->len;
+        append_range_end(sb, conn);
+        for (int i = 0; i < nranges; i++) {
+            append_range_part(sb, conn, &conn->ranges[i]);
+        }
+        off_t total = sb->len - mark;
+        sb->len = mark;
+        for (int i = 0; i < nranges; i++) {
+            total += conn->ranges[i].end - conn->ranges[i].start + 1;
         }
         
-        // 添加到HTML
-        html_len += snprintf(html + html_len, sizeof(html) - html_len,
-                            "        <tr>\n"
-                            "            <td><a href=\"%s\" class=\"%s\">%s%s</a></td>\n"
-                            "            <td>%s</td>\n"
-                            "            <td class=\"size\">%s</td>\n"
-                            "        </tr>\n",
-                            url_path,
-                            S_ISDIR(st.st_mode) ? "dir" : "file",
-                            entry->d_name,
-                            S_ISDIR(st.st_mode) ? "/" : "",
-                            time_str,
-                            size_str);
+        char content_type[64];
+        snprintf(content_type, sizeof(content_type), "multipart/byteranges; boundary=%s", conn->boundary);
+        append_file_headers(sb, repr, content_type, total);
+        APPEND_LITERAL(sb, "\r\n");
+        append_range_part(sb, conn, &conn->ranges[0]);
+        conn->range_count = nranges;
+        conn->range_next = 1;
+        conn->file_off = conn->ranges[0].start;
+        conn->file_end = conn->ranges[0].end + 1;
     }
-    
-    closedir(dir);
-    
-    // 完成HTML
-    html_len += snprintf(html + html_len, sizeof(html) - html_len,
-                        "    </table>\n"
-                        "    <div style=\"margin-top: 20px; color: #666;\">\n"
-                        "        MultiProtocol Server - HTTP on port %d\n"
-                        "    </div>\n"
-                        "</body>\n"
-                        "</html>",
-                        http_config->port);
-    
-    // 发送响应
-    send_http_header(client_fd, 200, "text/html", html_len);
-    ssize_t written = write(client_fd, html, html_len);
-    if (written != html_len) {
-    perror("write");
-    // Optionally handle partial write or error
+    conn->file_entry = entry;
+    conn->file_fd = entry->fd;
+}
+
+// 查找与原文件同名的预压缩文件（如app.js.gz），比原文件旧的视为过期，不使用
+// 查找结果（包括不存在）由路径缓存缓存，重复查找无需系统调用
+static path_cache_entry_t *find_sidecar(http_conn_t *conn, const path_cache_entry_t *entry, const char *suffix) {
+    size_t key_len = strlen(entry->key), suffix_len = strlen(suffix);
+    char *key = arena_alloc(&conn->arena, key_len + suffix_len + 1);
+    if (key == NULL) {
+        return NULL;
     }
+    memcpy(key, entry->key, key_len);
+    memcpy(key + key_len, suffix, suffix_len + 1);
+    path_cache_entry_t *sidecar = path_cache_get(http_path_cache, key, conn->worker->now_ms);
+    if (sidecar == NULL) {
+        return NULL;
+    }
+    const struct timespec *mtime = &sidecar->st.st_mtim;
+    const struct timespec *source_mtime = &entry->st.st_mtim;
+    if (sidecar->status != 0 || !S_ISREG(sidecar->st.st_mode) || mtime->tv_sec < source_mtime->tv_sec ||
+        (mtime->tv_sec == source_mtime->tv_sec && mtime->tv_nsec < source_mtime->tv_nsec)) {
+        path_cache_release(sidecar);
+        return NULL;
+    }
+    return sidecar;
 }
 
-// 发送文件内容
-static void send_file(int client_fd, const char *full_path) {
-    int fd = open(full_path, O_RDONLY);
-    if (fd == -1) {
-        send_error_page(client_fd, 403);
-        return;
+// 发送内容缓存中的响应，接管cached的引用
+// 缓存项中的头字段已包含结束空行，正文与响应头由conn_flush一起writev发出
+static void send_cached_file(http_conn_t *conn, file_cache_entry_t *cached) {
+    begin_http_header(conn, 200);
+    if (strbuf_append(&conn->wbuf, cached->header, cached->header_len) != 0) {
+        perror("HTTP response buffer");
     }
-    
-    // 获取文件信息
-    struct stat st;
-    if (fstat(fd, &st) == -1) {
-        close(fd);
-        send_error_page(client_fd, 500);
-        return;
-    }
-    
-    // 确定MIME类型
-    const char *mime_type = "application/octet-stream";
-    const char *ext = strrchr(full_path, '.');
-    if (ext) {
-        if (strcmp(ext, ".html") == 0 || strcmp(ext, ".htm") == 0)
-            mime_type = "text/html";
-        else if (strcmp(ext, ".txt") == 0)
-            mime_type = "text/plain";
-        else if (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".jpeg") == 0)
-            mime_type = "image/jpeg";
-        else if (strcmp(ext, ".png") == 0)
-            mime_type = "image/png";
-        else if (strcmp(ext, ".gif") == 0)
-            mime_type = "image/gif";
-        else if (strcmp(ext, ".css") == 0)
-            mime_type = "text/css";
-        else if (strcmp(ext, ".js") == 0)
-            mime_type = "application/javascript";
-        else if (strcmp(ext, ".pdf") == 0)
-            mime_type = "application/pdf";
-    }
-    
-    // 发送HTTP头
-    send_http_header(client_fd, 200, mime_type, st.st_size);
-    
-    // 发送文件内容
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read;
-    while ((bytes_read = read(fd, buffer, BUFFER_SIZE)) > 0) {
-        if (write(client_fd, buffer, bytes_read) != bytes_read) {
-            perror("write");
-            break;
+    conn->body_file = cached;
+    conn->body = cached->body;
+    conn->body_len = cached->body_len;
+    conn->body_pos = 0;
+}
+
+// 即时gzip压缩并发送，每个文件只压缩一次，结果按源文件路径缓存，源文件变化后重新压缩
+// 成功时接管entry的引用并返回true，失败时由调用者改为发送原始内容
+static bool send_file_gzip(http_conn_t *conn, path_cache_entry_t *entry, const file_repr_t *repr) {
+    const struct stat *st = &entry->st;
+    file_cache_entry_t *cached = file_cache_get(http_gzip_cache, entry->real_path, st);
+    if (cached == NULL) {
+        size_t size = (size_t)st->st_size;
+        char *data = malloc(size);
+        char *gz = NULL;
+        size_t gz_len = 0;
+        if (data != NULL && pread_full(entry->fd, data, size, 0) == (ssize_t)size &&
+            gzip_compress(data, size, conn->worker->config->compression_level, &gz, &gz_len) == 0) {
+            // 头字段先生成到发送缓冲区尾部，复制进缓存后截掉
+            strbuf_t *sb = &conn->wbuf;
+            size_t mark = sb->len;
+            append_file_headers(sb, repr, repr->mime_type, gz_len);
+            APPEND_LITERAL(sb, "\r\n");
+            if (sb->data != NULL) {
+                cached = file_cache_put_data(http_gzip_cache, entry->real_path, st,
+                                             sb->data + mark, sb->len - mark, gz, gz_len);
+            }
+            sb->len = mark;
+            if (cached == NULL) {
+                // 未能缓存（如压缩后仍大于一个分片），已压缩的内容直接从发送缓冲区发出，不再回退为原始内容
+                begin_http_header(conn, 200);
+                append_file_headers(sb, repr, repr->mime_type, gz_len);
+                APPEND_LITERAL(sb, "\r\n");
+                if (strbuf_append(sb, gz, gz_len) != 0) {
+                    perror("HTTP response buffer");
+                }
+                free(data);
+                free(gz);
+                path_cache_release(entry);
+                return true;
+            }
+        }
+        free(data);
+        free(gz);
+        if (cached == NULL) {
+            return false;
         }
     }
     
-    close(fd);
+    send_cached_file(conn, cached);
+    path_cache_release(entry);
+    return true;
 }
 
-// 处理客户端请求
-static void handle_client(int client_fd, const HttpServerConfig *http_config) {
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read = read(client_fd, buffer, BUFFER_SIZE - 1);
+// 发送文件内容，接管entry的引用直到正文发送完毕
+// 缓存项中的fd由多个连接共享，sendfile/splice均显式传入偏移，不改变文件位置
+static void send_file(http_conn_t *conn, path_cache_entry_t *entry) {
+    const HttpServerConfig *http_config = conn->worker->config;
+    const mime_type_t *mime = mime_registry_lookup(http_mime_types, entry->real_path);
+    file_repr_t repr = { .mime_type = mime->type };
+    bool gzip_on_the_fly = false;
+    metrics_inc(METRIC_HTTP_FILE_RESPONSES);
     
-    if (bytes_read <= 0) {
-        close(client_fd);
-        return;
+    // 内容协商：优先使用预压缩文件，其次即时gzip；Range只针对原始内容，有Range时不压缩
+    if (http_config->compression && (mime->flags & MIME_COMPRESSIBLE)) {
+        repr.vary = true;
+        http_slice_t accept = conn->parser.known[HTTP_HDR_ACCEPT_ENCODING];
+        if (accept.len > 0 && conn->parser.known[HTTP_HDR_RANGE].len == 0 &&
+            entry->st.st_size >= http_config->compression_min_size) {
+            path_cache_entry_t *sidecar = NULL;
+            if (http_accepts_encoding(conn->rbuf, accept, "br")) {
+                sidecar = find_sidecar(conn, entry, ".br");
+                repr.encoding = "br";
+            }
+            if (sidecar == NULL && http_accepts_encoding(conn->rbuf, accept, "gzip")) {
+                sidecar = find_sidecar(conn, entry, ".gz");
+                repr.encoding = "gzip";
+                gzip_on_the_fly = sidecar == NULL && http_gzip_cache != NULL &&
+                                  (size_t)entry->st.st_size <= file_cache_max_file_size(http_gzip_cache);
+            }
+            if (sidecar != NULL) {
+                path_cache_release(entry);
+                entry = sidecar;
+            } else if (!gzip_on_the_fly) {
+                repr.encoding = NULL;
+            }
+        }
     }
     
-    buffer[bytes_read] = '\0';
+    // 校验器由实际发送的文件得出，缓存的文件信息变化时随之变化
+    const char *full_path = entry->real_path;
+    const struct stat *st = &entry->st;
+    format_file_validators(&repr, st);
     
-    // 解析HTTP请求行
-    char method[16], path[MAX_PATH], version[16];
-    if (sscanf(buffer, "%s %s %s", method, path, version) != 3) {
-        send_error_page(client_fd, 500);
-        close(client_fd);
+    // 客户端缓存的副本仍然有效，回复304且不发送正文
+    if (file_not_modified(conn, &repr, st->st_mtime)) {
+        begin_http_header(conn, 304);
+        APPEND_LITERAL(&conn->wbuf, "Last-Modified: ");
+        append_str(&conn->wbuf, repr.last_modified);
+        APPEND_LITERAL(&conn->wbuf, "\r\nETag: ");
+        append_str(&conn->wbuf, repr.etag);
+        APPEND_LITERAL(&conn->wbuf, "\r\n");
+        if (repr.vary) {
+            APPEND_LITERAL(&conn->wbuf, "Vary: Accept-Encoding\r\n");
+        }
+        APPEND_LITERAL(&conn->wbuf, "\r\n");
+        path_cache_release(entry);
         return;
     }
     
-    // 只支持GET方法
-    if (strcmp(method, "GET") != 0) {
-        send_error_page(client_fd, 403);
-        close(client_fd);
-        return;
+    // Range请求
+    if (repr.encoding == NULL && conn->parser.known[HTTP_HDR_RANGE].len > 0 && file_range_applies(conn, &repr)) {
+        int nranges = http_parse_range(conn->rbuf, conn->parser.known[HTTP_HDR_RANGE], st->st_size,
+                                       conn->ranges, HTTP_MAX_RANGES);
+        if (nranges < 0) {
+            begin_http_header(conn, 416);
+            APPEND_LITERAL(&conn->wbuf, "Content-Range: bytes */");
+            append_number(&conn->wbuf, st->st_size);
+            APPEND_LITERAL(&conn->wbuf, "\r\nContent-Length: 0\r\n\r\n");
+            path_cache_release(entry);
+            return;
+        }
+        if (nranges > 0) {
+            send_file_ranges(conn, entry, &repr, nranges);
+            return;
+        }
     }
     
-    // 构建完整文件系统路径
-    char full_path[MAX_PATH];
-    if (strcmp(path, "/") == 0) {
-        strncpy(full_path, http_config->root_dir, sizeof(full_path) - 1);
-        full_path[sizeof(full_path) - 1] = '\0';
-    } else {
-        // URL解码
-        char decoded_path[MAX_PATH];
-        long unsigned int i = 0, j = 0;
-        while (path[i] && j < sizeof(decoded_path) - 1) {
-            if (path[i] == '%' && isxdigit(path[i+1]) && isxdigit(path[i+2])) {
-                // 简单的URL解码
-                char hex[3] = {path[i+1], path[i+2], '\0'};
-                decoded_path[j++] = strtol(hex, NULL, 16);
-                i += 3;
-            } else {
-                decoded_path[j++] = path[i++];
+    if (gzip_on_the_fly) {
+        if (send_file_gzip(conn, entry, &repr)) {
+            return;
+        }
+        // 压缩失败，改为发送原始内容
+        repr.encoding = NULL;
+        format_file_validators(&repr, st);
+    }
+    
+    // 小文件优先从内容缓存发送，响应头字段已预先生成，与正文一次writev发出
+    // 预压缩文件的响应头与直接请求该文件时不同，缓存键加上编码名以区分
+    if (http_file_cache != NULL && (mime->flags & MIME_CACHEABLE) &&
+        (size_t)st->st_size <= file_cache_max_file_size(http_file_cache)) {
+        const char *key = full_path;
+        if (repr.encoding != NULL) {
+            size_t enc_len = strlen(repr.encoding), path_len = strlen(full_path);
+            char *encoded_key = arena_alloc(&conn->arena, enc_len + 1 + path_len + 1);
+            if (encoded_key != NULL) {
+                memcpy(encoded_key, repr.encoding, enc_len);
+                encoded_key[enc_len] = ':';
+                memcpy(encoded_key + enc_len + 1, full_path, path_len + 1);
+            }
+            key = encoded_key;
+        }
+        file_cache_entry_t *cached = key != NULL ? file_cache_get(http_file_cache, key, st) : NULL;
+        if (cached == NULL && key != NULL) {
+            strbuf_t *sb = &conn->wbuf;
+            size_t mark = sb->len;
+            append_file_headers(sb, &repr, repr.mime_type, st->st_size);
+            APPEND_LITERAL(sb, "\r\n");
+            if (sb->data != NULL) {
+                cached = file_cache_put(http_file_cache, key, st, entry->fd, sb->data + mark, sb->len - mark);
             }
+            sb->len = mark;
         }
-        decoded_path[j] = '\0';
-        // 安全拼接根目录和解码后的路径
-        if (!safe_path_join(full_path, sizeof(full_path), http_config->root_dir, decoded_path, "")) {
-            send_error_page(client_fd, 414); // 请求URL过长
-            close(client_fd);
+        if (cached != NULL) {
+            send_cached_file(conn, cached);
+            path_cache_release(entry);
             return;
         }
     }
-    // 检查路径安全性
-    if (!is_path_safe(full_path, http_config->root_dir)) {
-        send_error_page(client_fd, 403);
-        close(client_fd);
+    
+    // 发送HTTP头，文件内容在socket可写时由内核直接发送
+    begin_http_header(conn, 200);
+    append_file_headers(&conn->wbuf, &repr, repr.mime_type, st->st_size);
+    APPEND_LITERAL(&conn->wbuf, "\r\n");
+    conn->file_entry = entry;
+    conn->file_fd = entry->fd;
+    conn->file_off = 0;
+    conn->file_end = st->st_size;
+}
+
+// 发送运行统计（Prometheus文本格式），每次请求时汇总各线程的计数
+static void send_stats(http_conn_t *conn) {
+    strbuf_t body = {0};
+    if (metrics_render(&body, NULL) != 0) {
+        strbuf_free(&body);
+        send_error_page(conn, 500);
+        return;
+    }
+    begin_http_header(conn, 200);
+    append_entity_headers(&conn->wbuf, "text/plain; version=0.0.4; charset=utf-8", body.len);
+    APPEND_LITERAL(&conn->wbuf, "Cache-Control: no-store\r\n\r\n");
+    strbuf_append(&conn->wbuf, body.data, body.len);
+    strbuf_free(&body);
+}
+
+// 根据请求版本、Connection头及配置决定响应后是否保持连接
+static bool conn_wants_keep_alive(const http_conn_t *conn, const HttpServerConfig *http_config) {
+    if (http_config->keepalive_timeout <= 0 || conn->peer_closed) {
+        return false;
+    }
+    if (http_config->keepalive_requests > 0 && conn->requests + 1 >= http_config->keepalive_requests) {
+        return false;
+    }
+    
+    http_slice_t value = conn->parser.known[HTTP_HDR_CONNECTION];
+    if (value.len > 0 && http_slice_has_token(conn->rbuf, value, "close")) {
+        return false;
+    }
+    if (conn->parser.version_minor >= 1) {
+        return true;
+    }
+    return value.len > 0 && http_slice_has_token(conn->rbuf, value, "keep-alive");
+}
+
+// 处理客户端请求，响应写入连接的发送缓冲区
+static void handle_client(http_conn_t *conn, const HttpServerConfig *http_config) {
+    const http_parser_t *req = &conn->parser;
+    conn->keep_alive = false;
+    metrics_inc(METRIC_HTTP_REQUESTS);
+    
+    // 请求解析失败（格式错误或超出长度限制），回复后关闭连接
+    if (req->error != 0) {
+        send_error_page(conn, req->error);
         return;
     }
     
-    // 检查文件/目录是否存在
-    struct stat st;
-    if (stat(full_path, &st) == -1) {
-        send_error_page(client_fd, 404);
-        close(client_fd);
+    // 只支持GET方法，其他方法的请求体长度未知，回复后关闭连接
+    if (!http_slice_equals(conn->rbuf, req->method, "GET")) {
+        send_error_page(conn, 403);
+        return;
+    }
+    conn->keep_alive = conn_wants_keep_alive(conn, http_config);
+    
+    if (http_config->stats_path[0] != '\0' && http_slice_equals(conn->rbuf, req->path, http_config->stats_path)) {
+        send_stats(conn);
+        return;
+    }
+    
+    // 取出URI中的路径部分（不含查询串），按实际长度分配在连接的arena中
+    if (req->path.len >= MAX_PATH) {
+        send_error_page(conn, 414);
+        return;
+    }
+    char *path = arena_strndup(&conn->arena, http_slice_ptr(conn->rbuf, req->path), req->path.len);
+    char *decoded_path = arena_alloc(&conn->arena, req->path.len + 1);
+    if (path == NULL || decoded_path == NULL) {
+        send_error_page(conn, 500);
+        return;
+    }
+    
+    url_decode(decoded_path, path);
+    
+    // 解析文件系统路径：规范化、越界检查、stat及打开文件均由缓存完成，命中时无需系统调用
+    path_cache_entry_t *entry = path_cache_get(http_path_cache, decoded_path, conn->worker->now_ms);
+    conn->t_resolve = access_log_now();
+    metrics_observe(METRIC_HTTP_RESOLVE, (conn->t_resolve - conn->t_parse) / 1000);
+    if (entry == NULL) {
+        send_error_page(conn, 500);
+        return;
+    }
+    if (entry->status != 0) {
+        send_error_page(conn, entry->status);
+        path_cache_release(entry);
         return;
     }
     
     // 如果是目录，发送目录列表
-    if (S_ISDIR(st.st_mode)) {
-        send_directory_listing(client_fd, path, full_path, http_config);
+    if (S_ISDIR(entry->st.st_mode)) {
+        send_directory_listing(conn, path, entry, http_config);
+        path_cache_release(entry);
     } 
     // 如果是文件，发送文件内容
-    else if (S_ISREG(st.st_mode)) {
-        send_file(client_fd, full_path);
+    else if (S_ISREG(entry->st.st_mode)) {
+        send_file(conn, entry);
     } 
     // 其他类型（如设备文件）禁止访问
     else {
-        send_error_page(client_fd, 403);
+        send_error_page(conn, 403);
+        path_cache_release(entry);
     }
-    
-    close(client_fd);
 }
 
-// HTTP服务器主函数
-int http_server_main(const HttpServerConfig *http_config) {
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    
-    // 创建socket
-    if ((http_server_fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-        perror("HTTP socket creation failed");
-        return -1;
+// 将连接加入待发送链表，由工作线程在本轮事件处理后继续发送
+static void conn_defer(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    if (conn->pending) {
+        return;
     }
-    
-    // 设置socket选项，允许端口重用
-    int opt = 1;
-    if (setsockopt(http_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
-        perror("HTTP setsockopt failed");
-        close(http_server_fd);
-        return -1;
+    conn->pending = true;
+    conn->prev = NULL;
+    conn->next = worker->pending;
+    if (worker->pending != NULL) {
+        worker->pending->prev = conn;
     }
-    
-    // 绑定地址和端口
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = inet_addr(http_config->ip);
-    server_addr.sin_port = htons(http_config->port);
-    
-    if (bind(http_server_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
-        perror("HTTP bind failed");
-        close(http_server_fd);
-        return -1;
+    worker->pending = conn;
+}
+
+// 从待发送链表中移除连接
+static void conn_undefer(http_conn_t *conn) {
+    if (!conn->pending) {
+        return;
     }
-    
-    // 监听连接
-    if (listen(http_server_fd, 10) == -1) {
-        perror("HTTP listen failed");
-        close(http_server_fd);
-        return -1;
+    if (conn->prev != NULL) {
+        conn->prev->next = conn->next;
+    } else {
+        conn->worker->pending = conn->next;
     }
-    
-    printf("HTTP server running on port %d, root directory: %s\n", http_config->port, http_config->root_dir);
-    // 创建根目录（如果不存在）
-    mkdir(http_config->root_dir, 0755);
-    
-    // 主循环，接受并处理连接
-    while (server_running) {
-        // 设置非阻塞模式，以便能响应退出信号
-        int flags = fcntl(http_server_fd, F_GETFL, 0);
-        fcntl(http_server_fd, F_SETFL, flags | O_NONBLOCK);
-        
-        int client_fd = accept(http_server_fd, (struct sockaddr *)&client_addr, &client_len);
-        
-        // 恢复阻塞模式
-        fcntl(http_server_fd, F_SETFL, flags);
-        
-        if (client_fd == -1) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                perror("HTTP accept failed");
-            }
-            // 短暂休眠，减少CPU占用
-            usleep(10000);
-            continue;
+    if (conn->next != NULL) {
+        conn->next->prev = conn->prev;
+    }
+    conn->prev = conn->next = NULL;
+    conn->pending = false;
+}
+
+// 记录连接活动，移到活动链表尾部
+static void conn_touch(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    conn->last_active = worker->now_ms;
+    if (worker->conn_tail == conn) {
+        return;
+    }
+    // 从原位置摘下（新连接不在链表中）
+    if (conn->lru_prev != NULL) {
+        conn->lru_prev->lru_next = conn->lru_next;
+    } else if (worker->conn_head == conn) {
+        worker->conn_head = conn->lru_next;
+    }
+    if (conn->lru_next != NULL) {
+        conn->lru_next->lru_prev = conn->lru_prev;
+    }
+    conn->lru_next = NULL;
+    conn->lru_prev = worker->conn_tail;
+    if (worker->conn_tail != NULL) {
+        worker->conn_tail->lru_next = conn;
+    } else {
+        worker->conn_head = conn;
+    }
+    worker->conn_tail = conn;
+}
+
+// 正文发送完毕或连接关闭时释放文件
+static void conn_release_file(http_conn_t *conn) {
+    if (conn->file_entry != NULL) {
+        path_cache_release(conn->file_entry);
+        conn->file_entry = NULL;
+    } else if (conn->file_fd != -1) {
+        close(conn->file_fd);
+    }
+    conn->file_fd = -1;
+    conn->range_count = 0;
+    if (conn->body_file != NULL) {
+        file_cache_release(conn->body_file);
+        conn->body_file = NULL;
+    }
+    if (conn->body_dir != NULL) {
+        dir_cache_release(conn->body_dir);
+        conn->body_dir = NULL;
+    }
+    conn->body = NULL;
+}
+
+// 累计已发送的字节，首次发送时记下首字节时间
+static void conn_account_sent(http_conn_t *conn, size_t n) {
+    conn->bytes_sent += n;
+    if (conn->t_first_byte == 0 && conn->t_start != 0) {
+        conn->t_first_byte = access_log_now();
+    }
+}
+
+// 当前请求结束：更新运行统计并写入访问记录，aborted表示响应未发送完毕连接即关闭
+static void conn_end_request(http_conn_t *conn, bool aborted) {
+    if (conn->t_start == 0) {
+        return;
+    }
+    uint64_t now = access_log_now();
+    metrics_add(METRIC_HTTP_BYTES_SENT, conn->bytes_sent);
+    if (aborted) {
+        metrics_inc(METRIC_HTTP_ABORTED);
+    } else if (conn->status >= 100 && conn->status < 600) {
+        metrics_inc(METRIC_HTTP_RESPONSES_1XX + conn->status / 100 - 1);
+        metrics_observe(METRIC_HTTP_REQUEST_DURATION, (now - conn->t_start) / 1000);
+        if (conn->t_first_byte != 0) {
+            metrics_observe(METRIC_HTTP_FIRST_BYTE, (conn->t_first_byte - conn->t_start) / 1000);
         }
-        
-        printf("HTTP: Received connection from %s:%d\n", 
-               inet_ntoa(client_addr.sin_addr), 
-               ntohs(client_addr.sin_port));
-        
-        // 处理客户端请求
-    handle_client(client_fd, http_config);
     }
-    
-    // 关闭服务器socket
-    if (http_server_fd != -1) {
-        close(http_server_fd);
-        http_server_fd = -1;
+    if (!access_log_enabled()) {
+        conn->t_start = conn->t_parse = conn->t_resolve = conn->t_first_byte = 0;
+        return;
     }
-    
-    printf("HTTP server stopped\n");
+
+    const http_parser_t *req = &conn->parser;
+    bool parsed = conn->t_parse != 0 && conn->rbuf != NULL;
+    access_record_t rec;
+    access_record_init(&rec, ACCESS_PROTO_HTTP, conn->t_start,
+                       parsed ? http_slice_ptr(conn->rbuf, req->method) : NULL, req->method.len,
+                       parsed ? http_slice_ptr(conn->rbuf, req->path) : NULL, req->path.len);
+    rec.addr = conn->addr.sin_addr.s_addr;
+    rec.port = ntohs(conn->addr.sin_port);
+    rec.status = (uint16_t)conn->status;
+    rec.bytes = conn->bytes_sent;
+    rec.worker = (uint16_t)conn->worker->id;
+    rec.flags = (aborted ? ACCESS_FLAG_ABORTED : 0) | (conn->keep_alive && !aborted ? ACCESS_FLAG_KEEPALIVE : 0);
+    rec.parse_us = access_log_elapsed_us(conn->t_start, conn->t_parse);
+    rec.resolve_us = access_log_elapsed_us(conn->t_start, conn->t_resolve);
+    rec.first_byte_us = access_log_elapsed_us(conn->t_start, conn->t_first_byte);
+    rec.complete_us = access_log_elapsed_us(conn->t_start, now);
+    access_log_write(&rec);
+    conn->t_start = conn->t_parse = conn->t_resolve = conn->t_first_byte = 0;
+}
+
+// io_uring请求的user_data
+static uint64_t conn_uring_data(const http_conn_t *conn, int op) {
+    return (uint64_t)(uintptr_t)conn | op;
+}
+
+// 归还暂存队列的队首缓冲区
+static void conn_drop_held(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    unsigned bid = conn->held_head;
+    conn->held_head = worker->held_next[bid];
+    conn->held_off = 0;
+    conn->held_count--;
+    worker->bufs_held--;
+    uring_recycle_buffer(worker->ring, bid);
+}
+
+// 释放连接的全部资源
+static void conn_destroy(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    conn_release_file(conn);
+    if (conn->pipe_fds[0] != -1) {
+        close(conn->pipe_fds[0]);
+        close(conn->pipe_fds[1]);
+    }
+    close(conn->fd);
+    arena_reset(&conn->arena);
+    buffer_pool_put(worker->buf_pool, conn->rbuf);
+    strbuf_free(&conn->wbuf);
+    buffer_pool_put(worker->conn_pool, conn);
+    __atomic_fetch_sub(&http_active_conns, 1, __ATOMIC_RELAXED);
+}
+
+// 关闭连接并释放资源，fd关闭后epoll会自动移除
+// io_uring后端中内核仍持有未结束请求的引用，先取消请求，连接结构在本轮事件处理后由worker_reap_closed释放
+static void conn_close(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    if (conn->closing) {
+        return;
+    }
+    conn_end_request(conn, true);
+    conn_undefer(conn);
+    if (conn->lru_prev != NULL) {
+        conn->lru_prev->lru_next = conn->lru_next;
+    } else {
+        worker->conn_head = conn->lru_next;
+    }
+    if (conn->lru_next != NULL) {
+        conn->lru_next->lru_prev = conn->lru_prev;
+    } else {
+        worker->conn_tail = conn->lru_prev;
+    }
+    if (worker->ring == NULL) {
+        conn_destroy(conn);
+        return;
+    }
+    
+    conn->closing = true;
+    while (conn->held_count > 0) {
+        conn_drop_held(conn);
+    }
+    if (conn->uring_ops > 0 &&
+        uring_prep_cancel_fd(worker->ring, conn->fd, conn_uring_data(conn, URING_OP_CANCEL)) == 0) {
+        conn->uring_ops++;
+    }
+    conn->next = worker->closed;
+    worker->closed = conn;
+}
+
+// 释放请求已全部结束的已关闭连接，force为true时不再等待（工作线程退出时）
+static void worker_reap_closed(http_worker_t *worker, bool force) {
+    http_conn_t **link = &worker->closed;
+    while (*link != NULL) {
+        http_conn_t *conn = *link;
+        if (conn->uring_ops > 0 && !force) {
+            link = &conn->next;
+            continue;
+        }
+        *link = conn->next;
+        conn_destroy(conn);
+    }
+}
+
+// io_uring后端：将暂存的接收数据复制到读缓冲区，全部取完相当于读到EAGAIN
+static void conn_read_held(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    while (conn->held_count > 0 && conn->rlen < conn->rcap) {
+        unsigned bid = conn->held_head;
+        size_t avail = worker->held_len[bid] - conn->held_off;
+        size_t n = conn->rcap - conn->rlen;
+        if (n > avail) {
+            n = avail;
+        }
+        memcpy(conn->rbuf + conn->rlen, uring_buffer(worker->ring, bid) + conn->held_off, n);
+        conn->rlen += n;
+        conn->held_off += n;
+        if (conn->held_off == worker->held_len[bid]) {
+            conn_drop_held(conn);
+        }
+    }
+    if (conn->held_count == 0) {
+        conn->readable = false;
+        conn->peer_closed = conn->recv_eof;
+    }
+}
+
+// 读取请求数据直到EAGAIN、缓冲区满或对端关闭，出错时返回-1
+static int conn_read_request(http_conn_t *conn) {
+    if (conn->rbuf == NULL) {
+        conn->rbuf = buffer_pool_get(conn->worker->buf_pool);
+        if (conn->rbuf == NULL) {
+            perror("HTTP read buffer alloc failed");
+            return -1;
+        }
+    }
+    if (conn->worker->ring != NULL) {
+        conn_read_held(conn);
+        return 0;
+    }
+    while (conn->rlen < conn->rcap) {
+        ssize_t n = read(conn->fd, conn->rbuf + conn->rlen, conn->rcap - conn->rlen);
+        if (n > 0) {
+            conn->rlen += n;
+            continue;
+        }
+        if (n == 0) {
+            conn->peer_closed = true;
+            conn->readable = false;
+            return 0;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            conn->readable = false;
+            return 0;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+// 从上次停止处继续解析读缓冲区中的请求，返回请求长度，尚不完整时返回0
+// 解析失败时返回已读取的全部长度，由handle_client回复错误并关闭连接
+static size_t conn_parse_request(http_conn_t *conn) {
+    int ret = http_parser_execute(&conn->parser, conn->rbuf, conn->rlen);
+    if (ret == HTTP_PARSE_DONE) {
+        return conn->parser.pos;
+    }
+    if (ret == HTTP_PARSE_ERROR) {
+        return conn->rlen;
+    }
+    // 对端已关闭而请求不完整
+    if (conn->peer_closed && conn->rlen > 0) {
+        conn->parser.error = 400;
+        return conn->rlen;
+    }
+    return 0;
+}
+
+// 当前响应发送完毕，准备处理同一连接上的下一个请求
+static bool conn_next_request(http_conn_t *conn) {
+    if (!conn->keep_alive) {
+        return false;
+    }
+    conn->rlen -= conn->req_len;
+    memmove(conn->rbuf, conn->rbuf + conn->req_len, conn->rlen);
+    conn->req_len = 0;
+    http_parser_reset(&conn->parser);
+    arena_reset(&conn->arena);
+    conn->wbuf.len = conn->wpos = 0;
+    conn->responded = false;
+    conn->bytes_sent = 0;
+    conn->status = 0;
+    conn->requests++;
+    return true;
+}
+
+// 用sendfile发送文件正文，最多count字节
+static ssize_t send_body_sendfile(http_conn_t *conn, size_t count) {
+    return sendfile(conn->fd, conn->file_fd, &conn->file_off, count);
+}
+
+// 创建splice使用的管道
+static int conn_open_pipe(http_conn_t *conn) {
+    if (conn->pipe_fds[0] == -1 && pipe2(conn->pipe_fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+        conn->pipe_fds[0] = conn->pipe_fds[1] = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// 文件系统不支持sendfile时，经由管道splice发送文件正文
+static ssize_t send_body_splice(http_conn_t *conn, size_t count) {
+    if (conn_open_pipe(conn) == -1) {
+        return -1;
+    }
+    
+    // 管道为空时从文件填充，上次未发完的数据优先发送
+    if (conn->pipe_len == 0) {
+        ssize_t n = splice(conn->file_fd, &conn->file_off, conn->pipe_fds[1], NULL, count,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n <= 0) {
+            return n;
+        }
+        conn->pipe_len = n;
+    }
+    
+    ssize_t n = splice(conn->pipe_fds[0], NULL, conn->fd, NULL, conn->pipe_len,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0) {
+        conn->pipe_len -= n;
+    }
+    return n;
+}
+
+// io_uring后端：提交文件到管道、管道到socket的一对链接splice，两者在同一批中提交
+// 管道中还有上次未发完的数据时只提交后者，偏移在完成事件中更新
+static int send_body_uring(http_conn_t *conn, size_t count) {
+    uring_t *ring = conn->worker->ring;
+    if (conn_open_pipe(conn) == -1) {
+        return -1;
+    }
+    if (count > URING_SPLICE_CHUNK) {
+        count = URING_SPLICE_CHUNK;
+    }
+    
+    if (conn->pipe_len == 0) {
+        if (uring_reserve(ring, 2) != 0 ||
+            uring_prep_splice(ring, conn->file_fd, conn->file_off, conn->pipe_fds[1], count, URING_LINK,
+                              conn_uring_data(conn, URING_OP_SPLICE_IN)) != 0) {
+            return -1;
+        }
+        conn->splicing++;
+        conn->uring_ops++;
+    } else {
+        count = conn->pipe_len;
+    }
+    if (uring_prep_splice(ring, conn->pipe_fds[0], -1, conn->fd, count, 0,
+                          conn_uring_data(conn, URING_OP_SPLICE_OUT)) != 0) {
+        return -1;
+    }
+    conn->splicing++;
+    conn->uring_ops++;
+    conn->splice_err = 0;
     return 0;
 }
 
+// 多段响应的一个区间发送完毕，将下一分段头（或结束边界）放入发送缓冲区
+// 没有后续内容时返回false
+static bool conn_next_range(http_conn_t *conn) {
+    if (conn->range_count == 0) {
+        return false;
+    }
+    conn->wbuf.len = conn->wpos = 0;
+    if (conn->range_next < conn->range_count) {
+        const http_range_t *range = &conn->ranges[conn->range_next++];
+        append_range_part(&conn->wbuf, conn, range);
+        conn->file_off = range->start;
+        conn->file_end = range->end + 1;
+    } else {
+        append_range_end(&conn->wbuf, conn);
+        conn->range_count = 0;
+    }
+    return true;
+}
+
+// 尽可能多地发送待发数据，返回FLUSH_*
+static int conn_flush(http_conn_t *conn) {
+    // io_uring后端：splice进行中或正在等待可写，由完成事件继续
+    if (conn->splicing > 0 || conn->poll_armed) {
+        return FLUSH_BLOCKED;
+    }
+    
+    // 缓存命中：响应头与缓存中的正文合并为一次writev
+    while (conn->body != NULL) {
+        struct iovec iov[2];
+        int iovcnt = 0;
+        size_t head_left = conn->wbuf.len - conn->wpos;
+        size_t body_left = conn->body_len - conn->body_pos;
+        if (head_left > 0) {
+            iov[iovcnt].iov_base = conn->wbuf.data + conn->wpos;
+            iov[iovcnt++].iov_len = head_left;
+        }
+        if (body_left > 0) {
+            iov[iovcnt].iov_base = (void *)(conn->body + conn->body_pos);
+            iov[iovcnt++].iov_len = body_left;
+        }
+        if (iovcnt == 0) {
+            conn_release_file(conn);
+            return FLUSH_DONE;
+        }
+        
+        ssize_t n = writev(conn->fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return FLUSH_BLOCKED;
+            }
+            return FLUSH_ERROR;
+        }
+        conn_account_sent(conn, n);
+        if ((size_t)n <= head_left) {
+            conn->wpos += n;
+        } else {
+            conn->wpos = conn->wbuf.len;
+            conn->body_pos += n - head_left;
+        }
+    }
+    
+    size_t budget = SEND_QUANTUM;
+    for (;;) {
+        // 先发送缓冲区中的响应头（或分段头）及内存中生成的正文
+        // 其后紧跟文件正文时带MSG_MORE，响应头与正文开头合并为同一个TCP段，效果同TCP_CORK而无需额外系统调用
+        while (conn->wpos < conn->wbuf.len) {
+            ssize_t n = send(conn->fd, conn->wbuf.data + conn->wpos, conn->wbuf.len - conn->wpos,
+                             conn->file_fd != -1 ? MSG_MORE : 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return FLUSH_BLOCKED;
+                }
+                return FLUSH_ERROR;
+            }
+            conn_account_sent(conn, n);
+            conn->wpos += n;
+        }
+        if (conn->file_fd == -1) {
+            return FLUSH_DONE;
+        }
+        
+        // 再由内核直接发送文件正文，部分发送时保留偏移以便下次继续
+        while (conn->file_off < conn->file_end || conn->pipe_len > 0) {
+            if (budget == 0) {
+                return FLUSH_YIELD;
+            }
+            
+            size_t count = conn->file_end - conn->file_off;
+            if (count > budget) {
+                count = budget;
+            }
+            if (conn->worker->ring != NULL) {
+                if (send_body_uring(conn, count) != 0) {
+                    perror("HTTP send file");
+                    return FLUSH_ERROR;
+                }
+                return FLUSH_BLOCKED;
+            }
+            ssize_t n = conn->use_splice ? send_body_splice(conn, count) 
+                                         : send_body_sendfile(conn, count);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return FLUSH_BLOCKED;
+                }
+                if (!conn->use_splice && (errno == EINVAL || errno == ENOSYS)) {
+                    conn->use_splice = true;
+                    continue;
+                }
+                perror("HTTP send file");
+                return FLUSH_ERROR;
+            }
+            if (n == 0) {
+                // 文件在发送过程中被截断，无法补齐Content-Length
+                fprintf(stderr, "HTTP send file: unexpected end of file\n");
+                return FLUSH_ERROR;
+            }
+            conn_account_sent(conn, n);
+            budget -= (size_t)n < budget ? (size_t)n : budget;
+        }
+        
+        // 当前区间发送完毕，多段响应继续下一分段，否则正文结束
+        if (!conn_next_range(conn)) {
+            conn_release_file(conn);
+            return FLUSH_DONE;
+        }
+    }
+}
+
+static void conn_serve(http_conn_t *conn);
+
+// 发送受阻：epoll后端等待EPOLLOUT（边缘触发已注册），io_uring后端提交一次可写等待
+static void conn_wait_writable(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    if (worker->ring == NULL || conn->splicing > 0 || conn->poll_armed) {
+        return;
+    }
+    if (uring_prep_poll(worker->ring, conn->fd, POLLOUT, false, conn_uring_data(conn, URING_OP_POLL)) != 0) {
+        conn_close(conn);
+        return;
+    }
+    conn->poll_armed = true;
+    conn->uring_ops++;
+}
+
+// 读缓冲区中没有待处理的数据时归还给缓冲区池，空闲的长连接不占用读缓冲区
+static void conn_release_rbuf(http_conn_t *conn) {
+    if (conn->rbuf != NULL && (conn->rlen == 0 || conn->lingering)) {
+        buffer_pool_put(conn->worker->buf_pool, conn->rbuf);
+        conn->rbuf = NULL;
+        conn->rlen = 0;
+    }
+}
+
+// 丢弃对端继续发来的数据，对端关闭或出错时关闭连接
+static void conn_drain(http_conn_t *conn) {
+    if (conn->worker->ring != NULL) {
+        while (conn->held_count > 0) {
+            conn_drop_held(conn);
+        }
+        conn->readable = false;
+        if (conn->recv_eof) {
+            conn_close(conn);
+        }
+        return;
+    }
+    
+    char discard[4096];
+    for (;;) {
+        ssize_t n = read(conn->fd, discard, sizeof(discard));
+        if (n > 0) {
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        conn_close(conn);
+        return;
+    }
+}
+
+// 响应发送完毕且不再复用连接
+// 若仍可能有未读的请求数据，直接close会使内核发送RST并冲掉尚未送达的响应，
+// 因此先关闭写端，丢弃剩余数据直到对端关闭或超时
+static void conn_finish(http_conn_t *conn) {
+    if (conn->peer_closed || (!conn->readable && conn->rlen <= conn->req_len)) {
+        conn_close(conn);
+        return;
+    }
+    shutdown(conn->fd, SHUT_WR);
+    conn->lingering = true;
+    conn_release_rbuf(conn);
+    conn_drain(conn);
+}
+
+// 发送响应，完成后继续处理下一个请求，未发完则等待下次可写或下一轮配额
+static void conn_send(http_conn_t *conn) {
+    int ret = conn_flush(conn);
+    if (ret == FLUSH_BLOCKED) {
+        conn_wait_writable(conn);
+    } else if (ret == FLUSH_YIELD) {
+        conn_defer(conn);
+    } else if (ret == FLUSH_DONE) {
+        conn_end_request(conn, false);
+        if (conn_next_request(conn)) {
+            conn_serve(conn);
+        } else {
+            conn_finish(conn);
+        }
+    } else if (ret == FLUSH_ERROR) {
+        conn_close(conn);
+    }
+}
+
+// 依次处理读缓冲区中的请求，流水线请求无需再次read
+static void conn_serve(http_conn_t *conn) {
+    for (;;) {
+        if (conn->t_start == 0 && conn->rlen > 0) {
+            conn->t_start = access_log_now();
+        }
+        conn->req_len = conn_parse_request(conn);
+        if (conn->req_len == 0) {
+            if (conn->peer_closed && conn->rlen == 0) {
+                conn_close(conn);
+                return;
+            }
+            if (!conn->readable) {
+                conn_release_rbuf(conn);
+                return;     // 等待下一次EPOLLIN
+            }
+            if (conn_read_request(conn) < 0) {
+                conn_close(conn);
+                return;
+            }
+            continue;
+        }
+        if (conn->t_start != 0) {
+            conn->t_parse = access_log_now();
+        }
+        
+        handle_client(conn, conn->worker->config);
+        conn->responded = true;
+        
+        int ret = conn_flush(conn);
+        if (ret == FLUSH_BLOCKED) {
+            conn_wait_writable(conn);
+            return;
+        }
+        if (ret == FLUSH_YIELD) {
+            conn_defer(conn);
+            return;
+        }
+        if (ret == FLUSH_ERROR) {
+            conn_close(conn);
+            return;
+        }
+        conn_end_request(conn, false);
+        if (!conn_next_request(conn)) {
+            conn_finish(conn);
+            return;
+        }
+    }
+}
+
+// 连接有新数据或可写时，按所处阶段继续处理
+static void conn_resume(http_conn_t *conn) {
+    conn_touch(conn);
+    if (conn->lingering) {
+        conn_drain(conn);
+    } else if (conn->responded) {
+        conn_send(conn);
+    } else {
+        conn_serve(conn);
+    }
+}
+
+// 处理连接上的epoll事件
+static void handle_conn_event(http_conn_t *conn, uint32_t events) {
+    if (events & EPOLLERR) {
+        conn_close(conn);
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        conn->readable = true;
+    }
+    conn_resume(conn);
+}
+
+// io_uring后端：按需重新提交多次接收请求
+// 请求结束（内核停止或缓冲区耗尽）且仍需读取时重新提交，单个连接暂存过多时取消以免占满缓冲区
+static void conn_update_recv(http_conn_t *conn) {
+    http_worker_t *worker = conn->worker;
+    if (conn->closing || conn->recv_eof) {
+        return;
+    }
+    if (conn->recv_armed) {
+        if (conn->held_count >= URING_RECV_HELD_MAX && !conn->recv_cancel &&
+            uring_prep_cancel(worker->ring, conn_uring_data(conn, URING_OP_RECV),
+                              conn_uring_data(conn, URING_OP_CANCEL)) == 0) {
+            conn->recv_cancel = true;
+            conn->uring_ops++;
+        }
+        return;
+    }
+    if (conn->held_count >= URING_RECV_HELD_MAX / 2 || worker->bufs_held >= uring_buffer_count(worker->ring)) {
+        return;
+    }
+    if (uring_prep_recv_multishot(worker->ring, conn->fd, conn_uring_data(conn, URING_OP_RECV)) != 0) {
+        conn_close(conn);
+        return;
+    }
+    conn->recv_armed = true;
+    conn->uring_ops++;
+}
+
+// io_uring后端：收到数据或对端关闭
+static void conn_recv_complete(http_conn_t *conn, const uring_cqe_t *cqe) {
+    http_worker_t *worker = conn->worker;
+    if (!(cqe->flags & URING_CQE_MORE)) {
+        conn->recv_armed = false;
+        conn->recv_cancel = false;
+    }
+    if (cqe->res > 0 && (cqe->flags & URING_CQE_BUFFER)) {
+        unsigned bid = uring_cqe_buffer(cqe);
+        worker->held_len[bid] = (uint32_t)cqe->res;
+        if (conn->closing) {
+            uring_recycle_buffer(worker->ring, bid);
+            return;
+        }
+        if (conn->held_count++ == 0) {
+            conn->held_head = bid;
+        } else {
+            worker->held_next[conn->held_tail] = bid;
+        }
+        conn->held_tail = bid;
+        worker->bufs_held++;
+    } else if (cqe->res == 0) {
+        conn->recv_eof = true;
+    } else if (cqe->res == -ENOBUFS) {
+        worker->recv_starved = true;
+        return;
+    } else if (cqe->res < 0) {
+        if (cqe->res != -ECANCELED) {
+            conn_close(conn);
+        }
+        return;
+    }
+    if (!conn->closing) {
+        conn->readable = true;
+        conn_resume(conn);
+    }
+}
+
+// io_uring后端：一对splice中的一个完成，全部完成后继续发送
+static void conn_splice_complete(http_conn_t *conn, int op, int res) {
+    conn->splicing--;
+    if (res > 0) {
+        if (op == URING_OP_SPLICE_IN) {
+            conn->file_off += res;
+            conn->pipe_len += res;
+        } else {
+            conn->pipe_len -= res;
+            conn_account_sent(conn, res);
+        }
+    } else if (res == 0 && op == URING_OP_SPLICE_IN) {
+        conn->splice_err = 1;
+    } else if (res < 0 && res != -ECANCELED && conn->splice_err == 0) {
+        conn->splice_err = res;
+    }
+    if (conn->splicing > 0 || conn->closing) {
+        return;
+    }
+    
+    if (conn->splice_err == -EAGAIN) {
+        conn_wait_writable(conn);
+    } else if (conn->splice_err == 1) {
+        // 文件在发送过程中被截断，无法补齐Content-Length
+        fprintf(stderr, "HTTP send file: unexpected end of file\n");
+        conn_close(conn);
+    } else if (conn->splice_err < 0) {
+        fprintf(stderr, "HTTP send file: %s\n", strerror(-conn->splice_err));
+        conn_close(conn);
+    } else {
+        conn_touch(conn);
+        conn_send(conn);
+    }
+}
+
+// 处理连接请求的完成事件
+static void handle_conn_completion(http_conn_t *conn, int op, const uring_cqe_t *cqe) {
+    if (!(cqe->flags & URING_CQE_MORE)) {
+        conn->uring_ops--;
+    }
+    switch (op) {
+    case URING_OP_RECV:
+        conn_recv_complete(conn, cqe);
+        break;
+    case URING_OP_POLL:
+        conn->poll_armed = false;
+        if (conn->closing) {
+            break;
+        }
+        if (cqe->res < 0 || (cqe->res & (POLLERR | POLLHUP))) {
+            conn_close(conn);
+        } else {
+            conn_resume(conn);
+        }
+        break;
+    case URING_OP_SPLICE_IN:
+    case URING_OP_SPLICE_OUT:
+        conn_splice_complete(conn, op, cqe->res);
+        break;
+    default:
+        break;  // 取消请求本身的完成事件
+    }
+    conn_update_recv(conn);
+}
+
+// 超出连接数上限时返回的响应
+static const char http_busy_response[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Server: MultiProtocolServer\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+// 读缓冲区容量，同时作为连接arena的块大小
+static size_t worker_rbuf_size(const HttpServerConfig *http_config) {
+    return http_config->max_header_size > 0 ? (size_t)http_config->max_header_size : BUFFER_SIZE;
+}
+
+// 占用一个连接名额，超出max_connections时返回false
+static bool acquire_conn_slot(int max_connections) {
+    int active = __atomic_fetch_add(&http_active_conns, 1, __ATOMIC_RELAXED);
+    if (max_connections > 0 && active >= max_connections) {
+        __atomic_fetch_sub(&http_active_conns, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+// 为新接受的连接创建连接结构并开始等待请求
+static void conn_open(http_worker_t *worker, int client_fd, const struct sockaddr_in *client_addr) {
+    if (!acquire_conn_slot(worker->config->max_connections)) {
+        ssize_t ret = write(client_fd, http_busy_response, sizeof(http_busy_response) - 1);
+        (void)ret;
+        close(client_fd);
+        metrics_inc(METRIC_HTTP_REJECTED);
+        return;
+    }
+    metrics_inc(METRIC_HTTP_CONNECTIONS);
+    
+    dlt_log_debug(APP_ID, "HTTP[%d]: Received connection from %s:%d", worker->id,
+           inet_ntoa(client_addr->sin_addr), 
+           ntohs(client_addr->sin_port));
+    
+    http_conn_t *conn = buffer_pool_get(worker->conn_pool);
+    if (conn == NULL) {
+        perror("HTTP connection alloc failed");
+        close(client_fd);
+        __atomic_fetch_sub(&http_active_conns, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = client_fd;
+    conn->addr = *client_addr;
+    conn->worker = worker;
+    conn->file_fd = -1;
+    conn->pipe_fds[0] = conn->pipe_fds[1] = -1;
+    conn->rcap = worker_rbuf_size(worker->config);
+    arena_init(&conn->arena, worker->buf_pool);
+    http_parser_init(&conn->parser, conn->rcap, worker->config->max_headers);
+    conn_touch(conn);
+    
+    if (worker->ring != NULL) {
+        conn_update_recv(conn);
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) == -1) {
+        perror("HTTP epoll_ctl failed");
+        conn_close(conn);
+    }
+}
+
+// 接受所有待处理的连接（边缘触发，需循环至EAGAIN）
+static void accept_connections(http_worker_t *worker) {
+    for (;;) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = accept4(worker->listen_fd, (struct sockaddr *)&client_addr, &client_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("HTTP accept failed");
+            }
+            return;
+        }
+        conn_open(worker, client_fd, &client_addr);
+    }
+}
+
+// io_uring后端：多次accept接受的连接，地址需另行获取
+static void accept_complete(http_worker_t *worker, int client_fd) {
+    if (!server_running || http_stopping) {
+        close(client_fd);
+        return;
+    }
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    if (getpeername(client_fd, (struct sockaddr *)&client_addr, &client_len) == -1) {
+        memset(&client_addr, 0, sizeof(client_addr));
+    }
+    conn_open(worker, client_fd, &client_addr);
+}
+
+// 唤醒HTTP事件循环（可在信号处理函数中调用）
+void http_server_wakeup(void) {
+    if (http_wakeup_fd != -1) {
+        uint64_t one = 1;
+        ssize_t ret = write(http_wakeup_fd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+// 创建工作线程的监听socket，SO_REUSEPORT使内核在各线程间分发新连接
+static int create_listen_socket(const HttpServerConfig *http_config) {
+    struct sockaddr_in server_addr;
+    int fd;
+    
+    // 创建socket
+    if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+        perror("HTTP socket creation failed");
+        return -1;
+    }
+    
+    // 设置socket选项，允许端口重用
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+        perror("HTTP setsockopt failed");
+        close(fd);
+        return -1;
+    }
+    
+    // 绑定地址和端口
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = inet_addr(http_config->ip);
+    server_addr.sin_port = htons(http_config->port);
+    
+    if (bind(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
+        perror("HTTP bind failed");
+        close(fd);
+        return -1;
+    }
+    
+    // 监听连接
+    if (listen(fd, SOMAXCONN) == -1) {
+        perror("HTTP listen failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// io_uring后端：创建实例、注册接收缓冲区，并提交监听socket、唤醒fd及目录监视fd上的多次请求
+static int worker_init_uring(http_worker_t *worker) {
+    worker->ring = uring_create(URING_ENTRIES);
+    if (worker->ring == NULL) {
+        return -1;
+    }
+    worker->held_next = calloc(URING_RECV_BUFFERS, sizeof(*worker->held_next));
+    worker->held_len = calloc(URING_RECV_BUFFERS, sizeof(*worker->held_len));
+    if (worker->held_next == NULL || worker->held_len == NULL ||
+        uring_provide_buffers(worker->ring, URING_RECV_BUFFERS, URING_RECV_BUFFER_SIZE) != 0 ||
+        uring_prep_accept_multishot(worker->ring, worker->listen_fd, (uintptr_t)&listen_token) != 0 ||
+        uring_prep_poll(worker->ring, http_wakeup_fd, POLLIN, true, (uintptr_t)&wakeup_token) != 0) {
+        goto fail;
+    }
+    // 目录监视fd由所有工作线程共享，没有EPOLLEXCLUSIVE的对应功能，事件由先读到的线程处理
+    if (http_dir_cache != NULL && dir_cache_fd(http_dir_cache) != -1 &&
+        uring_prep_poll(worker->ring, dir_cache_fd(http_dir_cache), POLLIN, true,
+                        (uintptr_t)&inotify_token) != 0) {
+        goto fail;
+    }
+    return 0;
+    
+fail:
+    uring_destroy(worker->ring);
+    worker->ring = NULL;
+    free(worker->held_next);
+    free(worker->held_len);
+    worker->held_next = NULL;
+    worker->held_len = NULL;
+    return -1;
+}
+
+// 初始化工作线程的监听socket和epoll（或io_uring）实例
+static int worker_init(http_worker_t *worker, bool use_uring) {
+    // 连接结构与读缓冲区按slab批量分配，只由本线程使用，无需加锁
+    worker->conn_pool = buffer_pool_create(sizeof(http_conn_t), 64, false);
+    worker->buf_pool = buffer_pool_create(worker_rbuf_size(worker->config), 32, false);
+    if (worker->conn_pool == NULL || worker->buf_pool == NULL) {
+        perror("HTTP buffer pool alloc failed");
+        buffer_pool_destroy(worker->conn_pool);
+        buffer_pool_destroy(worker->buf_pool);
+        return -1;
+    }
+    
+    worker->listen_fd = create_listen_socket(worker->config);
+    if (worker->listen_fd == -1) {
+        buffer_pool_destroy(worker->conn_pool);
+        buffer_pool_destroy(worker->buf_pool);
+        return -1;
+    }
+    
+    worker->epoll_fd = -1;
+    if (use_uring) {
+        if (worker_init_uring(worker) == 0) {
+            return 0;
+        }
+        fprintf(stderr, "HTTP[%d] io_uring setup failed (%s), falling back to epoll\n",
+                worker->id, strerror(errno));
+    }
+    
+    worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epoll_fd == -1) {
+        perror("HTTP epoll_create1 failed");
+        close(worker->listen_fd);
+        buffer_pool_destroy(worker->conn_pool);
+        buffer_pool_destroy(worker->buf_pool);
+        return -1;
+    }
+    
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &listen_token;
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->listen_fd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &wakeup_token;
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, http_wakeup_fd, &ev);
+    
+    // 目录监视fd由所有工作线程共享，EPOLLEXCLUSIVE避免每个事件唤醒全部线程
+    if (http_dir_cache != NULL && dir_cache_fd(http_dir_cache) != -1) {
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.ptr = &inotify_token;
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, dir_cache_fd(http_dir_cache), &ev);
+    }
+    return 0;
+}
+
+// 单调时钟（毫秒）
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 关闭空闲超时的连接，返回距下一个连接超时的毫秒数，无需等待超时时返回-1
+static int expire_idle_connections(http_worker_t *worker) {
+    int timeout = worker->config->keepalive_timeout > 0 ? worker->config->keepalive_timeout 
+                                                        : HTTP_IDLE_TIMEOUT;
+    uint64_t timeout_ms = (uint64_t)timeout * 1000;
+    while (worker->conn_head != NULL) {
+        uint64_t deadline = worker->conn_head->last_active + timeout_ms;
+        if (deadline > worker->now_ms) {
+            return (int)(deadline - worker->now_ms);
+        }
+        conn_close(worker->conn_head);
+    }
+    return -1;
+}
+
+// 释放工作线程的监听socket、epoll（或io_uring）实例及缓冲区池，连接需已全部关闭
+static void worker_release(http_worker_t *worker) {
+    if (worker->ring != NULL) {
+        uring_destroy(worker->ring);
+        free(worker->held_next);
+        free(worker->held_len);
+    } else {
+        close(worker->epoll_fd);
+    }
+    close(worker->listen_fd);
+    buffer_pool_destroy(worker->conn_pool);
+    buffer_pool_destroy(worker->buf_pool);
+}
+
+// epoll后端：等待并处理一轮事件
+static void worker_poll_epoll(http_worker_t *worker, int timeout) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(worker->epoll_fd, events, MAX_EVENTS, timeout);
+    worker->now_ms = monotonic_ms();
+    worker_update_date(worker);
+    if (n == -1) {
+        if (errno != EINTR) {
+            perror("HTTP epoll_wait failed");
+        }
+        return;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        void *ptr = events[i].data.ptr;
+        if (ptr == &wakeup_token) {
+            continue;   // 退出标志由循环条件检查
+        }
+        if (ptr == &listen_token) {
+            accept_connections(worker);
+            continue;
+        }
+        if (ptr == &inotify_token) {
+            dir_cache_process_events(http_dir_cache);
+            continue;
+        }
+        handle_conn_event((http_conn_t *)ptr, events[i].events);
+    }
+}
+
+// io_uring后端：提交本轮准备的请求（与等待合并为一次系统调用）并处理完成事件
+static void worker_poll_uring(http_worker_t *worker, int timeout) {
+    uring_cqe_t cqes[MAX_EVENTS];
+    uring_t *ring = worker->ring;
+    int n = uring_wait(ring, cqes, MAX_EVENTS, timeout);
+    worker->now_ms = monotonic_ms();
+    worker_update_date(worker);
+    if (n == -1) {
+        perror("HTTP io_uring_enter failed");
+        return;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        const uring_cqe_t *cqe = &cqes[i];
+        bool more = (cqe->flags & URING_CQE_MORE) != 0;
+        if (cqe->user_data == (uintptr_t)&wakeup_token) {
+            // 退出标志由循环条件检查
+            if (!more) {
+                uring_prep_poll(ring, http_wakeup_fd, POLLIN, true, (uintptr_t)&wakeup_token);
+            }
+            continue;
+        }
+        if (cqe->user_data == (uintptr_t)&listen_token) {
+            if (cqe->res >= 0) {
+                accept_complete(worker, cqe->res);
+            } else if (cqe->res != -ECONNABORTED && cqe->res != -EINTR) {
+                fprintf(stderr, "HTTP accept failed: %s\n", strerror(-cqe->res));
+            }
+            if (!more) {
+                uring_prep_accept_multishot(ring, worker->listen_fd, (uintptr_t)&listen_token);
+            }
+            continue;
+        }
+        if (cqe->user_data == (uintptr_t)&inotify_token) {
+            dir_cache_process_events(http_dir_cache);
+            if (!more) {
+                uring_prep_poll(ring, dir_cache_fd(http_dir_cache), POLLIN, true, (uintptr_t)&inotify_token);
+            }
+            continue;
+        }
+        http_conn_t *conn = (http_conn_t *)(uintptr_t)(cqe->user_data & ~(uint64_t)URING_OP_MASK);
+        handle_conn_completion(conn, (int)(cqe->user_data & URING_OP_MASK), cqe);
+    }
+    
+    // 缓冲区耗尽而停止接收的连接在有缓冲区归还后重新提交
+    if (worker->recv_starved && worker->bufs_held < uring_buffer_count(ring)) {
+        worker->recv_starved = false;
+        http_conn_t *conn = worker->conn_head;
+        while (conn != NULL) {
+            http_conn_t *next = conn->lru_next;
+            conn_update_recv(conn);
+            conn = next;
+        }
+    }
+}
+
+// 工作线程主循环，等待事件就绪
+static void *http_worker_run(void *arg) {
+    http_worker_t *worker = (http_worker_t *)arg;
+    
+    worker->now_ms = monotonic_ms();
+    worker_update_date(worker);
+    while (server_running && !http_stopping) {
+        // 有待继续发送的连接时不阻塞等待，否则最多等到最早的空闲连接超时
+        int timeout = expire_idle_connections(worker);
+        // 路径缓存项过期后及时关闭其fd，由第一个工作线程负责
+        if (worker->id == 0) {
+            int expire = path_cache_expire(http_path_cache, worker->now_ms);
+            if (expire >= 0 && (timeout < 0 || expire < timeout)) {
+                timeout = expire;
+            }
+        }
+        if (worker->pending != NULL) {
+            timeout = 0;
+        }
+        if (worker->ring != NULL) {
+            worker_poll_uring(worker, timeout);
+        } else {
+            worker_poll_epoll(worker, timeout);
+        }
+        
+        // 轮流为配额用完的连接继续发送下一段
+        http_conn_t *conn = worker->pending;
+        worker->pending = NULL;
+        while (conn != NULL) {
+            http_conn_t *next = conn->next;
+            conn->pending = false;
+            conn->prev = conn->next = NULL;
+            conn_touch(conn);
+            conn_send(conn);
+            // io_uring后端的连接结构在本轮结束前不会释放
+            if (worker->ring != NULL) {
+                conn_update_recv(conn);
+            }
+            conn = next;
+        }
+        worker_reap_closed(worker, false);
+    }
+    
+    // 关闭仍然打开的连接，io_uring后端等待已提交的请求取消完毕（最多约1秒）
+    while (worker->conn_head != NULL) {
+        conn_close(worker->conn_head);
+    }
+    for (int i = 0; worker->closed != NULL && i < 100; i++) {
+        worker_poll_uring(worker, 10);
+        worker_reap_closed(worker, false);
+    }
+    worker_reap_closed(worker, true);
+    
+    buffer_pool_stats_t cstats, bstats;
+    buffer_pool_stats(worker->conn_pool, &cstats);
+    buffer_pool_stats(worker->buf_pool, &bstats);
+    printf("HTTP[%d] buffer pools: connections peak %zu/%zu, buffers peak %zu/%zu x %zuB, %llu gets\n",
+           worker->id, cstats.peak, cstats.total, bstats.peak, bstats.total, bstats.buffer_size,
+           (unsigned long long)bstats.gets);
+    worker_release(worker);
+    return NULL;
+}
+
+// 解析工作线程数，workers=auto时取在线CPU核数
+static int resolve_worker_count(const HttpServerConfig *http_config) {
+    if (http_config->workers > 0) {
+        return http_config->workers;
+    }
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    return ncpu > 0 ? (int)ncpu : 1;
+}
+
+// 创建所有工作线程共享的MIME类型表及缓存，根目录只在此处解析一次
+static int http_caches_init(const HttpServerConfig *http_config) {
+    http_mime_types = mime_registry_create(http_config->mime_types_file, http_config->mime_rules);
+    if (http_mime_types == NULL) {
+        fprintf(stderr, "HTTP failed to build MIME type registry\n");
+        return -1;
+    }
+    size_t types, extensions;
+    mime_registry_stats(http_mime_types, &types, &extensions);
+    printf("HTTP MIME types: %zu types, %zu extensions\n", types, extensions);
+    
+    http_path_cache = path_cache_create(http_config->root_dir, 
+                                        http_config->path_cache_size > 0 ? http_config->path_cache_size : 0,
+                                        http_config->path_cache_ttl);
+    if (http_path_cache == NULL) {
+        fprintf(stderr, "HTTP failed to initialize path cache for %s\n", http_config->root_dir);
+        mime_registry_destroy(http_mime_types);
+        http_mime_types = NULL;
+        return -1;
+    }
+    if (http_config->file_cache_size_mb > 0) {
+        http_file_cache = file_cache_create((size_t)http_config->file_cache_size_mb * 1024 * 1024,
+                                            (size_t)http_config->file_cache_max_file_kb * 1024);
+        if (http_file_cache == NULL) {
+            fprintf(stderr, "HTTP failed to initialize file cache, serving without it\n");
+        }
+    }
+    if (http_config->compression && http_config->compression_cache_size_mb > 0 && gzip_available()) {
+        http_gzip_cache = file_cache_create((size_t)http_config->compression_cache_size_mb * 1024 * 1024,
+                                            (size_t)http_config->compression_max_file_kb * 1024);
+        if (http_gzip_cache == NULL) {
+            fprintf(stderr, "HTTP failed to initialize compression cache, serving without it\n");
+        }
+    }
+    if (http_config->dir_cache_size_mb > 0) {
+        http_dir_cache = dir_cache_create((size_t)http_config->dir_cache_size_mb * 1024 * 1024);
+        if (http_dir_cache == NULL) {
+            fprintf(stderr, "HTTP failed to initialize directory listing cache, serving without it\n");
+        }
+    }
+    return 0;
+}
+
+// 打印缓存统计并销毁缓存
+static void http_caches_destroy(void) {
+    uint64_t hits, misses;
+    path_cache_stats(http_path_cache, &hits, &misses);
+    printf("HTTP path cache: %llu hits, %llu misses\n", 
+           (unsigned long long)hits, (unsigned long long)misses);
+    path_cache_destroy(http_path_cache);
+    http_path_cache = NULL;
+    mime_registry_destroy(http_mime_types);
+    http_mime_types = NULL;
+    
+    if (http_file_cache != NULL) {
+        file_cache_stats_t fstats;
+        file_cache_stats(http_file_cache, &fstats);
+        printf("HTTP file cache: %llu hits, %llu misses, %llu evictions, %llu invalidations, "
+               "%zu entries, %zu/%zu bytes\n",
+               (unsigned long long)fstats.hits, (unsigned long long)fstats.misses,
+               (unsigned long long)fstats.evictions, (unsigned long long)fstats.invalidations,
+               fstats.entries, fstats.bytes, fstats.capacity);
+        file_cache_destroy(http_file_cache);
+        http_file_cache = NULL;
+    }
+    
+    if (http_gzip_cache != NULL) {
+        file_cache_stats_t gstats;
+        file_cache_stats(http_gzip_cache, &gstats);
+        printf("HTTP compression cache: %llu hits, %llu misses, %llu evictions, %llu invalidations, "
+               "%zu entries, %zu/%zu bytes\n",
+               (unsigned long long)gstats.hits, (unsigned long long)gstats.misses,
+               (unsigned long long)gstats.evictions, (unsigned long long)gstats.invalidations,
+               gstats.entries, gstats.bytes, gstats.capacity);
+        file_cache_destroy(http_gzip_cache);
+        http_gzip_cache = NULL;
+    }
+    
+    if (http_dir_cache != NULL) {
+        dir_cache_stats_t dstats;
+        dir_cache_stats(http_dir_cache, &dstats);
+        printf("HTTP directory cache: %llu hits, %llu misses, %llu evictions, %llu invalidations, "
+               "%zu entries, %zu/%zu bytes\n",
+               (unsigned long long)dstats.hits, (unsigned long long)dstats.misses,
+               (unsigned long long)dstats.evictions, (unsigned long long)dstats.invalidations,
+               dstats.entries, dstats.bytes, dstats.capacity);
+        dir_cache_destroy(http_dir_cache);
+        http_dir_cache = NULL;
+    }
+}
+
+// HTTP服务器主函数
+int http_server_main(const HttpServerConfig *http_config) {
+    int nworkers = resolve_worker_count(http_config);
+    
+    // 创建根目录（如果不存在）
+    mkdir(http_config->root_dir, 0755);
+    
+    metrics_register_gauge("server_http_connections_active", "HTTP connections currently open.",
+                           &http_active_conns);
+    
+    // 错误响应只生成一次，之后各线程只读共享
+    if (http_error_pages_init() != 0) {
+        perror("HTTP error pages alloc failed");
+        return -1;
+    }
+    if (http_caches_init(http_config) != 0) {
+        http_error_pages_free();
+        return -1;
+    }
+    
+    http_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (http_wakeup_fd == -1) {
+        perror("HTTP eventfd failed");
+        http_caches_destroy();
+        http_error_pages_free();
+        return -1;
+    }
+    
+    http_worker_t *workers = calloc(nworkers, sizeof(*workers));
+    if (workers == NULL) {
+        perror("HTTP workers alloc failed");
+        close(http_wakeup_fd);
+        http_wakeup_fd = -1;
+        http_caches_destroy();
+        http_error_pages_free();
+        return -1;
+    }
+    
+    // 内核不支持io_uring（或编译时未启用）时全部工作线程使用epoll
+    bool use_uring = false;
+    if (http_config->io_backend == IO_BACKEND_IO_URING) {
+        const char *reason = NULL;
+        use_uring = uring_available(&reason);
+        if (!use_uring) {
+            fprintf(stderr, "HTTP io_uring backend unavailable (%s), falling back to epoll\n", reason);
+        }
+    }
+    
+    // 先创建全部监听socket，任何一个失败则整体退出
+    int started = 0;
+    for (int i = 0; i < nworkers; i++) {
+        workers[i].id = i;
+        workers[i].config = http_config;
+        if (worker_init(&workers[i], use_uring) != 0) {
+            break;
+        }
+        started++;
+    }
+    
+    if (started == nworkers) {
+        for (started = 0; started < nworkers; started++) {
+            int ret = pthread_create(&workers[started].thread, NULL, http_worker_run, &workers[started]);
+            if (ret != 0) {
+                fprintf(stderr, "Failed to create HTTP worker thread: %d\n", ret);
+                break;
+            }
+        }
+        if (started == nworkers) {
+            printf("HTTP server running on port %d, root directory: %s, workers: %d, I/O backend: %s\n",
+                   http_config->port, http_config->root_dir, nworkers, workers[0].ring != NULL ? "io_uring" : "epoll");
+        } else {
+            // 部分线程创建失败，通知已启动的线程退出
+            http_stopping = true;
+            http_server_wakeup();
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        // 未启动线程的资源在此释放
+        for (int i = started; i < nworkers; i++) {
+            worker_release(&workers[i]);
+        }
+    } else {
+        for (int i = 0; i < started; i++) {
+            worker_release(&workers[i]);
+        }
+    }
+    
+    bool ok = started == nworkers;
+    free(workers);
+    close(http_wakeup_fd);
+    http_wakeup_fd = -1;
+    http_caches_destroy();
+    http_error_pages_free();
+    
+    printf("HTTP server stopped\n");
+    return ok ? 0 : -1;
+}
+
 // HTTP服务器线程函数
 void *run_http_server(void *arg) {
     ThreadData *data = (ThreadData *)arg;
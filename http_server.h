@@ -1,4 +1,5 @@
 #ifndef HTTP_SERVER_H
 #define HTTP_SERVER_H
 void *run_http_server(void *arg);
+void http_server_wakeup(void);
 #endif // HTTP_SERVER_H
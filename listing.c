@@ -0,0 +1,130 @@
+#define _GNU_SOURCE
+#include "listing.h"
+#include <stdio.h>
+#include <time.h>
+
+int listing_append_html_row(strbuf_t *html, const char *request_path, const char *separator,
+                            const char *name, const struct stat *st) {
+    bool is_dir = S_ISDIR(st->st_mode);
+
+    // 格式化最后修改时间
+    char time_str[64];
+    struct tm tm_info;
+    localtime_r(&st->st_mtime, &tm_info);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", &tm_info);
+
+    // 获取文件大小
+    const char *size_str = "-";
+    if (!is_dir) {
+        size_str = get_file_size_str(st->st_size);
+    }
+
+    // 目录的链接以斜杠结尾
+    return strbuf_printf(html,
+                         "        <tr>\n"
+                         "            <td><a href=\"%s%s%s%s\" class=\"%s\">%s%s</a></td>\n"
+                         "            <td>%s</td>\n"
+                         "            <td class=\"size\">%s</td>\n"
+                         "        </tr>\n",
+                         request_path, separator, name, is_dir ? "/" : "",
+                         is_dir ? "dir" : "file",
+                         name,
+                         is_dir ? "/" : "",
+                         time_str,
+                         size_str);
+}
+
+size_t listing_format_ftp_line(char *buf, size_t size, const char *name, const struct stat *st) {
+    // 文件权限
+    char perms[11];
+    snprintf(perms, sizeof(perms), "%c%c%c%c%c%c%c%c%c%c",
+             S_ISDIR(st->st_mode) ? 'd' : '-',
+             (st->st_mode & S_IRUSR) ? 'r' : '-',
+             (st->st_mode & S_IWUSR) ? 'w' : '-',
+             (st->st_mode & S_IXUSR) ? 'x' : '-',
+             (st->st_mode & S_IRGRP) ? 'r' : '-',
+             (st->st_mode & S_IWGRP) ? 'w' : '-',
+             (st->st_mode & S_IXGRP) ? 'x' : '-',
+             (st->st_mode & S_IROTH) ? 'r' : '-',
+             (st->st_mode & S_IWOTH) ? 'w' : '-',
+             (st->st_mode & S_IXOTH) ? 'x' : '-');
+
+    // 文件时间
+    struct tm tm_info;
+    localtime_r(&st->st_mtime, &tm_info);
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%b %d %H:%M", &tm_info);
+
+    int len = snprintf(buf, size, "%s %3ld %-8ld %-8ld %-8ld %s %s\r\n",
+                       perms,
+                       (long)st->st_nlink,
+                       (long)st->st_uid,
+                       (long)st->st_gid,
+                       (long)st->st_size,
+                       time_str,
+                       name);
+    if (len < 0) {
+        return 0;
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+// 按固定位数写入十进制数字
+static char *put_digits(char *p, unsigned int value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        p[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return p + width;
+}
+
+size_t listing_format_mlsx_facts(char *buf, size_t size, const struct stat *st) {
+    // 最长的一项："type=file;size=" + 20位数字 + ";modify=" + 14位时间 + ";perm=" + 权限 + "; "
+    char tmp[96];
+    char *p = tmp;
+    bool is_dir = S_ISDIR(st->st_mode);
+    const char *type = is_dir ? "type=dir;" : S_ISREG(st->st_mode) ? "type=file;" : "type=OS.unix=other;";
+    size_t type_len = strlen(type);
+    memcpy(p, type, type_len);
+    p += type_len;
+    if (!is_dir) {
+        memcpy(p, "size=", 5);
+        p += 5;
+        char digits[24];
+        int n = 0;
+        unsigned long long value = (unsigned long long)st->st_size;
+        do {
+            digits[n++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) {
+            *p++ = digits[--n];
+        }
+        *p++ = ';';
+    }
+    struct tm tm_info;
+    gmtime_r(&st->st_mtime, &tm_info);
+    memcpy(p, "modify=", 7);
+    p += 7;
+    p = put_digits(p, (unsigned int)(tm_info.tm_year + 1900), 4);
+    p = put_digits(p, (unsigned int)(tm_info.tm_mon + 1), 2);
+    p = put_digits(p, (unsigned int)tm_info.tm_mday, 2);
+    p = put_digits(p, (unsigned int)tm_info.tm_hour, 2);
+    p = put_digits(p, (unsigned int)tm_info.tm_min, 2);
+    p = put_digits(p, (unsigned int)tm_info.tm_sec, 2);
+    // 权限事实与服务器支持的命令对应：目录可进入、列出、上传文件，文件可下载、覆盖、追加
+    const char *perm = is_dir ? ";perm=cel; " : ";perm=arw; ";
+    memcpy(p, perm, 11);
+    p += 11;
+
+    size_t len = (size_t)(p - tmp);
+    if (size == 0) {
+        return 0;
+    }
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(buf, tmp, len);
+    buf[len] = '\0';
+    return len;
+}
@@ -0,0 +1,21 @@
+#ifndef LISTING_H
+#define LISTING_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+#include "utils.h"
+
+// 目录列表的逐项格式化，HTTP目录页面与FTP LIST共用，只依赖目录项名称及其stat
+
+// 追加HTML目录页面中的一行，separator为请求路径与名称之间的分隔符，内存不足时返回-1
+int listing_append_html_row(strbuf_t *html, const char *request_path, const char *separator,
+                            const char *name, const struct stat *st);
+
+// 格式化一行ls -l风格的LIST输出（以CRLF结尾），返回行长度，超出size时截断
+size_t listing_format_ftp_line(char *buf, size_t size, const char *name, const struct stat *st);
+
+// 格式化MLSD/MLST（RFC 3659）一项的事实部分"type=..;size=..;modify=..;perm=..; "，名称由调用者追加
+// modify为UTC时间，返回长度，超出size时截断
+size_t listing_format_mlsx_facts(char *buf, size_t size, const struct stat *st);
+
+#endif // LISTING_H
@@ -1,83 +1,286 @@
+#define _GNU_SOURCE
 #include "logMgr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
+// 每个线程的日志环大小（2的幂）及单条日志的最大长度，超出部分截断
+#define LOG_RING_SIZE       (64 * 1024)
+#define LOG_MAX_MESSAGE     1024
+// 写线程没有取到日志时的休眠间隔
+#define LOG_FLUSH_INTERVAL_MS 10
+// 写线程的输出缓冲区，满时或每轮结束时一次write
+#define LOG_OUTPUT_SIZE     (64 * 1024)
 
+// 环中的一条日志，正文紧随其后，总长度按8字节对齐
+typedef struct {
+    uint32_t len;               // 含记录头的总长度
+    uint16_t level;             // LOG_LEVEL_*，LOG_PAD表示环尾的填充
+    uint16_t text_len;
+    const char *app_id;         // 调用者传入的字符串常量
+} log_record_t;
 
-int dlt_init_client(const char *app_id) {
-    // 初始化日志客户端
-    // 这里假设初始化总是成功的
-    return 0;
+#define LOG_PAD 0xffff
+#define LOG_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+// 单生产者（所属线程）单消费者（写线程）的字节环，head与tail只增不减
+typedef struct log_ring {
+    struct log_ring *next;      // 全部日志环的链表，只在表头插入，从不删除
+    int in_use;                 // 所属线程退出后为0，可被新线程接管
+    uint64_t dropped;           // 环满丢弃的日志数
+    uint64_t reported;          // 写线程已报告的丢弃数
+    char pad1[64];
+    uint64_t head;              // 写入位置，只由生产者修改
+    char pad2[64];
+    uint64_t tail;              // 读取位置，只由写线程修改
+    char pad3[64];
+    char data[LOG_RING_SIZE];
+} log_ring_t;
+
+int log_runtime_level = LOG_LEVEL_INFO;
+
+static log_ring_t *log_rings = NULL;
+static pthread_key_t log_ring_key;
+static pthread_t log_writer;
+static bool log_started = false;
+static volatile bool log_stopping = false;
+
+static __thread log_ring_t *log_thread_ring = NULL;
+
+static const char *const log_level_names[] = {
+    "OFF", "FATAL", "ERROR", "WARN", "INFO", "DEBUG", "VERBOSE",
+};
+
+void log_set_level(int level) {
+    if (level < LOG_LEVEL_OFF) {
+        level = LOG_LEVEL_OFF;
+    } else if (level > LOG_LEVEL_VERBOSE) {
+        level = LOG_LEVEL_VERBOSE;
+    }
+    __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
 }
 
+// 线程退出时释放其日志环，剩余日志仍由写线程输出
+static void log_ring_release(void *arg) {
+    log_ring_t *ring = arg;
+    __atomic_store_n(&ring->in_use, 0, __ATOMIC_RELEASE);
+}
 
-int dlt_free_client(const char *app_id) {
-    // 释放日志客户端资源
-    return 0;
+// 取本线程的日志环：优先接管已退出线程的环，否则新建并插入链表头
+static log_ring_t *log_ring_acquire(void) {
+    if (log_thread_ring != NULL) {
+        return log_thread_ring;
+    }
+    log_ring_t *ring;
+    for (ring = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+        int expected = 0;
+        if (__atomic_load_n(&ring->in_use, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&ring->in_use, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (ring == NULL) {
+        if (posix_memalign((void **)&ring, 64, sizeof(*ring)) != 0) {
+            return NULL;
+        }
+        memset(ring, 0, offsetof(log_ring_t, data));
+        ring->in_use = 1;
+        ring->next = __atomic_load_n(&log_rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&log_rings, &ring->next, ring, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    pthread_setspecific(log_ring_key, ring);
+    log_thread_ring = ring;
+    return ring;
 }
 
+// 写线程未运行时同步输出，与原先的格式相同
+static void log_write_direct(int level, const char *app_id, const char *text, int len) {
+    FILE *out = level <= LOG_LEVEL_WARN ? stderr : stdout;
+    fprintf(out, "[%s] [%s] %.*s\n", log_level_names[level], app_id, len, text);
+}
 
-int dlt_log_fatal(const char *app_id, const char *format, ...) {
+int log_write(int level, const char *app_id, const char *format, ...) {
+    char text[LOG_MAX_MESSAGE];
     va_list args;
     va_start(args, format);
-    fprintf(stderr, "[FATAL] [%s] ", app_id);
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
+    int len = vsnprintf(text, sizeof(text), format, args);
     va_end(args);
+    if (len < 0) {
+        return -1;
+    }
+    if (len >= (int)sizeof(text)) {
+        len = sizeof(text) - 1;
+    }
+
+    log_ring_t *ring = __atomic_load_n(&log_started, __ATOMIC_ACQUIRE) ? log_ring_acquire() : NULL;
+    if (ring == NULL) {
+        log_write_direct(level, app_id, text, len);
+        return 0;
+    }
+
+    // 记录在环尾放不下时，用填充记录跳到环首
+    size_t need = LOG_ALIGN(sizeof(log_record_t) + len);
+    uint64_t head = ring->head;
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t pos = head & (LOG_RING_SIZE - 1);
+    size_t room = LOG_RING_SIZE - pos;
+    size_t skip = need > room ? room : 0;
+    if (head + skip + need - tail > LOG_RING_SIZE) {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    if (skip > 0) {
+        if (room >= sizeof(log_record_t)) {
+            log_record_t *pad = (log_record_t *)(ring->data + pos);
+            pad->len = (uint32_t)room;
+            pad->level = LOG_PAD;
+        }
+        head += skip;
+        pos = 0;
+    }
+
+    log_record_t *rec = (log_record_t *)(ring->data + pos);
+    rec->len = (uint32_t)need;
+    rec->level = (uint16_t)level;
+    rec->text_len = (uint16_t)len;
+    rec->app_id = app_id;
+    memcpy(rec + 1, text, len);
+    __atomic_store_n(&ring->head, head + need, __ATOMIC_RELEASE);
     return 0;
 }
 
-int dlt_log_error(const char *app_id, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stderr, "[ERROR] [%s] ", app_id);
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
-    va_end(args);
-    return 0;
+// 写线程的输出缓冲区
+typedef struct {
+    int fd;
+    size_t len;
+    char data[LOG_OUTPUT_SIZE];
+} log_output_t;
+
+static void log_output_flush(log_output_t *out) {
+    size_t pos = 0;
+    while (pos < out->len) {
+        ssize_t n = write(out->fd, out->data + pos, out->len - pos);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;  // 输出出错时丢弃，不影响服务
+        }
+        pos += n;
+    }
+    out->len = 0;
 }
 
-int dlt_log_warn(const char *app_id, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stderr, "[WARN] [%s] ", app_id);
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
-    va_end(args);
-    return 0;
+static void log_output_line(log_output_t *out, int level, const char *app_id, const char *text, size_t len) {
+    char prefix[64];
+    int plen = snprintf(prefix, sizeof(prefix), "[%s] [%s] ", log_level_names[level], app_id);
+    if (plen < 0 || (size_t)plen >= sizeof(prefix)) {
+        plen = 0;
+    }
+    if (out->len + plen + len + 1 > sizeof(out->data)) {
+        log_output_flush(out);
+    }
+    memcpy(out->data + out->len, prefix, plen);
+    memcpy(out->data + out->len + plen, text, len);
+    out->len += plen + len;
+    out->data[out->len++] = '\n';
 }
 
-int dlt_log_debug(const char *app_id, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stdout, "[DEBUG] [%s] ", app_id);
-    vfprintf(stdout, format, args);
-    fprintf(stdout, "\n");
-    va_end(args);
-    return 0;
+// 取出一个环中的全部日志，返回取出的条数
+static size_t log_ring_drain(log_ring_t *ring, log_output_t *out, log_output_t *err) {
+    uint64_t tail = ring->tail;
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t count = 0;
+    while (tail != head) {
+        size_t pos = tail & (LOG_RING_SIZE - 1);
+        size_t room = LOG_RING_SIZE - pos;
+        if (room < sizeof(log_record_t)) {
+            tail += room;
+            continue;
+        }
+        const log_record_t *rec = (const log_record_t *)(ring->data + pos);
+        if (rec->level != LOG_PAD) {
+            log_output_line(rec->level <= LOG_LEVEL_WARN ? err : out, rec->level, rec->app_id,
+                            (const char *)(rec + 1), rec->text_len);
+            count++;
+        }
+        tail += rec->len;
+    }
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+    uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    if (dropped != ring->reported) {
+        char text[64];
+        int len = snprintf(text, sizeof(text), "%llu log messages dropped (ring full)",
+                           (unsigned long long)(dropped - ring->reported));
+        log_output_line(err, LOG_LEVEL_WARN, "LOG", text, len);
+        ring->reported = dropped;
+    }
+    return count;
 }
 
-int dlt_log_info(const char *app_id, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stdout, "[INFO] [%s] ", app_id);
-    vfprintf(stdout, format, args);
-    fprintf(stdout, "\n");
-    va_end(args);
-    return 0;
+static void *log_writer_run(void *arg) {
+    (void)arg;
+    static log_output_t out = { .fd = STDOUT_FILENO };
+    static log_output_t err = { .fd = STDERR_FILENO };
+    struct timespec interval = { 0, LOG_FLUSH_INTERVAL_MS * 1000000L };
+
+    for (;;) {
+        // 停止标志须在取日志之前读取，保证停止前写入的日志全部输出
+        bool stopping = __atomic_load_n(&log_stopping, __ATOMIC_ACQUIRE);
+        size_t count = 0;
+        for (log_ring_t *ring = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+            count += log_ring_drain(ring, &out, &err);
+        }
+        // 先输出stdout上已缓冲的内容，与直接printf的输出大致保持顺序
+        fflush(stdout);
+        log_output_flush(&err);
+        log_output_flush(&out);
+        if (stopping) {
+            break;
+        }
+        if (count == 0) {
+            nanosleep(&interval, NULL);
+        }
+    }
+    return NULL;
 }
 
-int dlt_log_verbose(const char *app_id, const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-    fprintf(stdout, "[VERBOSE] [%s] ", app_id);
-    vfprintf(stdout, format, args);
-    fprintf(stdout, "\n");
-    va_end(args);
+int dlt_init_client(const char *app_id) {
+    (void)app_id;
+    if (log_started) {
+        return 0;
+    }
+    if (pthread_key_create(&log_ring_key, log_ring_release) != 0) {
+        return -1;
+    }
+    log_stopping = false;
+    if (pthread_create(&log_writer, NULL, log_writer_run, NULL) != 0) {
+        pthread_key_delete(log_ring_key);
+        return -1;
+    }
+    pthread_setname_np(log_writer, "log-writer");
+    __atomic_store_n(&log_started, true, __ATOMIC_RELEASE);
     return 0;
 }
 
-
+int dlt_free_client(const char *app_id) {
+    (void)app_id;
+    if (!log_started) {
+        return 0;
+    }
+    // 之后的日志改为同步输出，写线程取完剩余日志后退出
+    __atomic_store_n(&log_started, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&log_stopping, true, __ATOMIC_RELEASE);
+    pthread_join(log_writer, NULL);
+    return 0;
+}
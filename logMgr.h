@@ -2,16 +2,63 @@
 #ifndef LOGMGR_H
 #define LOGMGR_H
 
+#include <stdbool.h>
+
+// 日志级别，与DLT一致，数值越大越详细
+#define LOG_LEVEL_OFF     0
+#define LOG_LEVEL_FATAL   1
+#define LOG_LEVEL_ERROR   2
+#define LOG_LEVEL_WARN    3
+#define LOG_LEVEL_INFO    4
+#define LOG_LEVEL_DEBUG   5
+#define LOG_LEVEL_VERBOSE 6
+
+// 编译时级别，由CMake选项LOG_COMPILE_LEVEL设置
+// 更详细的dlt_log_debug/dlt_log_verbose调用在编译时移除，参数不会求值
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_VERBOSE
+#endif
+
+// 启动后台写线程，此前及dlt_free_client之后的日志直接同步输出
 int dlt_init_client(const char *app_id);
+// 输出全部缓冲的日志并停止写线程
 int dlt_free_client(const char *app_id);
 
+// 运行时级别，更详细的日志在格式化之前即被丢弃
+extern int log_runtime_level;
+void log_set_level(int level);
+
+static inline bool log_enabled(int level) {
+    return level <= __atomic_load_n(&log_runtime_level, __ATOMIC_RELAXED);
+}
+
+// 格式化后放入本线程的日志环，由写线程批量输出；环满时丢弃并计数，从不阻塞
+int log_write(int level, const char *app_id, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// 先检查运行时级别再求值参数
+#define LOG_CALL(level, app_id, ...) \
+    (log_enabled(level) ? (void)log_write((level), (app_id), __VA_ARGS__) : (void)0)
+// 编译时移除：仍做格式检查，但条件为常量0，参数不会求值
+#define LOG_ELIDED(level, app_id, ...) \
+    (0 ? (void)log_write((level), (app_id), __VA_ARGS__) : (void)0)
+
+#define dlt_log_fatal(app_id, ...)   LOG_CALL(LOG_LEVEL_FATAL, app_id, __VA_ARGS__)
+#define dlt_log_error(app_id, ...)   LOG_CALL(LOG_LEVEL_ERROR, app_id, __VA_ARGS__)
+#define dlt_log_warn(app_id, ...)    LOG_CALL(LOG_LEVEL_WARN, app_id, __VA_ARGS__)
+#define dlt_log_info(app_id, ...)    LOG_CALL(LOG_LEVEL_INFO, app_id, __VA_ARGS__)
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG
+#define dlt_log_debug(app_id, ...)   LOG_CALL(LOG_LEVEL_DEBUG, app_id, __VA_ARGS__)
+#else
+#define dlt_log_debug(app_id, ...)   LOG_ELIDED(LOG_LEVEL_DEBUG, app_id, __VA_ARGS__)
+#endif
 
-int dlt_log_fatal(const char *app_id, const char *format, ...);
-int dlt_log_error(const char *app_id, const char *format, ...);
-int dlt_log_warn(const char *app_id, const char *format, ...);
-int dlt_log_debug(const char *app_id, const char *format, ...); 
-int dlt_log_info(const char *app_id, const char *format, ...);
-int dlt_log_verbose(const char *app_id, const char *format, ...);
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_VERBOSE
+#define dlt_log_verbose(app_id, ...) LOG_CALL(LOG_LEVEL_VERBOSE, app_id, __VA_ARGS__)
+#else
+#define dlt_log_verbose(app_id, ...) LOG_ELIDED(LOG_LEVEL_VERBOSE, app_id, __VA_ARGS__)
+#endif
 
 #endif // LOGMGR_H
-#endif // USE_DLT_LIB
\ No newline at end of file
+#endif // USE_DLT_LIB
@@ -0,0 +1,205 @@
+#include "utils.h"
+#include "mempool.h"
+
+#define CACHE_LINE 64
+
+// 空闲缓冲区的前几个字节用作链表指针
+typedef struct free_buffer {
+    struct free_buffer *next;
+} free_buffer_t;
+
+// slab头单独分配，slab内存全部用于缓冲区
+typedef struct slab {
+    struct slab *next;
+    void *mem;
+} slab_t;
+
+struct buffer_pool {
+    size_t buffer_size;
+    size_t buffers_per_slab;
+    bool shared;
+    pthread_mutex_t lock;
+    free_buffer_t *free_list;
+    slab_t *slabs;
+    size_t slab_count;
+    size_t in_use;
+    size_t peak;
+    uint64_t gets;
+};
+
+buffer_pool_t *buffer_pool_create(size_t buffer_size, size_t buffers_per_slab, bool shared) {
+    buffer_pool_t *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (buffer_size < sizeof(free_buffer_t)) {
+        buffer_size = sizeof(free_buffer_t);
+    }
+    pool->buffer_size = (buffer_size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    pool->buffers_per_slab = buffers_per_slab > 0 ? buffers_per_slab : 1;
+    pool->shared = shared;
+    if (shared) {
+        pthread_mutex_init(&pool->lock, NULL);
+    }
+    return pool;
+}
+
+void buffer_pool_destroy(buffer_pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    while (pool->slabs != NULL) {
+        slab_t *slab = pool->slabs;
+        pool->slabs = slab->next;
+        free(slab->mem);
+        free(slab);
+    }
+    if (pool->shared) {
+        pthread_mutex_destroy(&pool->lock);
+    }
+    free(pool);
+}
+
+// 分配一个slab并把其中的缓冲区全部放入空闲链表，需持有锁
+static int pool_grow(buffer_pool_t *pool) {
+    slab_t *slab = malloc(sizeof(*slab));
+    if (slab == NULL) {
+        return -1;
+    }
+    if (posix_memalign(&slab->mem, CACHE_LINE, pool->buffer_size * pool->buffers_per_slab) != 0) {
+        free(slab);
+        return -1;
+    }
+    char *mem = slab->mem;
+    for (size_t i = pool->buffers_per_slab; i-- > 0;) {
+        free_buffer_t *buf = (free_buffer_t *)(mem + i * pool->buffer_size);
+        buf->next = pool->free_list;
+        pool->free_list = buf;
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slab_count++;
+    return 0;
+}
+
+void *buffer_pool_get(buffer_pool_t *pool) {
+    if (pool->shared) {
+        pthread_mutex_lock(&pool->lock);
+    }
+    free_buffer_t *buf = NULL;
+    if (pool->free_list != NULL || pool_grow(pool) == 0) {
+        buf = pool->free_list;
+        pool->free_list = buf->next;
+        pool->gets++;
+        if (++pool->in_use > pool->peak) {
+            pool->peak = pool->in_use;
+        }
+    }
+    if (pool->shared) {
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return buf;
+}
+
+void buffer_pool_put(buffer_pool_t *pool, void *buf) {
+    if (buf == NULL) {
+        return;
+    }
+    if (pool->shared) {
+        pthread_mutex_lock(&pool->lock);
+    }
+    free_buffer_t *node = buf;
+    node->next = pool->free_list;
+    pool->free_list = node;
+    pool->in_use--;
+    if (pool->shared) {
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+size_t buffer_pool_buffer_size(const buffer_pool_t *pool) {
+    return pool->buffer_size;
+}
+
+void buffer_pool_stats(buffer_pool_t *pool, buffer_pool_stats_t *stats) {
+    if (pool->shared) {
+        pthread_mutex_lock(&pool->lock);
+    }
+    stats->buffer_size = pool->buffer_size;
+    stats->total = pool->slab_count * pool->buffers_per_slab;
+    stats->in_use = pool->in_use;
+    stats->peak = pool->peak;
+    stats->slabs = pool->slab_count;
+    stats->gets = pool->gets;
+    if (pool->shared) {
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// 块头位于缓冲区开头，其后为可分配的内存
+struct arena_block {
+    arena_block_t *next;
+};
+
+#define ARENA_ALIGN sizeof(void *)
+#define ARENA_HEADER ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+void arena_init(arena_t *arena, buffer_pool_t *pool) {
+    memset(arena, 0, sizeof(*arena));
+    arena->pool = pool;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    size_t block_size = buffer_pool_buffer_size(arena->pool);
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    // 超过块容量的分配单独malloc，不占用池中的块
+    if (size > block_size - ARENA_HEADER) {
+        arena_block_t *block = malloc(ARENA_HEADER + size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->large;
+        arena->large = block;
+        arena->used += size;
+        return (char *)block + ARENA_HEADER;
+    }
+
+    if (arena->blocks == NULL || arena->pos + size > block_size) {
+        arena_block_t *block = buffer_pool_get(arena->pool);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->pos = ARENA_HEADER;
+    }
+    void *ptr = (char *)arena->blocks + arena->pos;
+    arena->pos += size;
+    arena->used += size;
+    return ptr;
+}
+
+char *arena_strndup(arena_t *arena, const char *str, size_t len) {
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+void arena_reset(arena_t *arena) {
+    while (arena->blocks != NULL) {
+        arena_block_t *block = arena->blocks;
+        arena->blocks = block->next;
+        buffer_pool_put(arena->pool, block);
+    }
+    while (arena->large != NULL) {
+        arena_block_t *block = arena->large;
+        arena->large = block->next;
+        free(block);
+    }
+    arena->pos = 0;
+    arena->used = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 固定大小缓冲区池：按slab批量分配，释放的缓冲区进入空闲链表优先复用（后进先出，复用时仍在缓存中）
+// slab在池销毁前不归还系统
+typedef struct buffer_pool buffer_pool_t;
+
+// 缓冲区池占用统计
+typedef struct {
+    size_t buffer_size;         // 每个缓冲区的字节数
+    size_t total;               // 已分配的缓冲区数
+    size_t in_use;              // 正在使用的缓冲区数
+    size_t peak;                // 同时使用的最大缓冲区数
+    size_t slabs;
+    uint64_t gets;              // 累计取出次数
+} buffer_pool_stats_t;
+
+// 创建缓冲区池，buffer_size向上取整到缓存行大小，每个slab包含buffers_per_slab个缓冲区
+// shared为true时可被多个线程同时使用（内部加锁），否则只能由一个线程使用
+buffer_pool_t *buffer_pool_create(size_t buffer_size, size_t buffers_per_slab, bool shared);
+
+// 销毁缓冲区池，调用者需保证所有缓冲区都已归还
+void buffer_pool_destroy(buffer_pool_t *pool);
+
+// 取出一个缓冲区（内容未初始化），内存不足时返回NULL
+void *buffer_pool_get(buffer_pool_t *pool);
+
+// 归还缓冲区
+void buffer_pool_put(buffer_pool_t *pool, void *buf);
+
+size_t buffer_pool_buffer_size(const buffer_pool_t *pool);
+
+void buffer_pool_stats(buffer_pool_t *pool, buffer_pool_stats_t *stats);
+
+// 连接或会话的临时内存：从缓冲区池取块并顺序分配，处理完一个请求后整体重置
+// 超过块大小的分配单独malloc，重置时一并释放
+typedef struct arena_block arena_block_t;
+
+typedef struct {
+    buffer_pool_t *pool;
+    arena_block_t *blocks;      // 已使用的块，第一个为当前块
+    arena_block_t *large;       // 单独分配的大块
+    size_t pos;                 // 当前块已分配的字节数
+    size_t used;                // 本次重置以来分配的总字节数
+} arena_t;
+
+void arena_init(arena_t *arena, buffer_pool_t *pool);
+
+// 分配size字节（按指针大小对齐），内存不足时返回NULL
+void *arena_alloc(arena_t *arena, size_t size);
+
+// 复制len字节并追加结束符
+char *arena_strndup(arena_t *arena, const char *str, size_t len);
+
+// 释放全部分配，块归还缓冲区池
+void arena_reset(arena_t *arena);
+
+#endif // MEMPOOL_H
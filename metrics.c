@@ -0,0 +1,270 @@
+#define _GNU_SOURCE
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// 直方图按HDR方式分桶：小于4微秒的值各占一桶，其余按最高有效位分组，每组再按其后两位均分为4个子桶
+// 相对误差不超过25%，最后一桶收容超过约134秒的值
+#define METRICS_SUB_BITS    2
+#define METRICS_SUB_COUNT   (1 << METRICS_SUB_BITS)
+#define METRICS_MAX_MSB     27
+#define METRICS_BUCKETS     ((METRICS_MAX_MSB - METRICS_SUB_BITS + 2) * METRICS_SUB_COUNT + 1)
+
+typedef struct {
+    uint64_t buckets[METRICS_BUCKETS];
+    uint64_t sum;               // 微秒
+} metrics_hist_data_t;
+
+// 一个线程的统计数据，按缓存行对齐，不与其他线程共享缓存行
+typedef struct metrics_thread {
+    struct metrics_thread *next;    // 全部线程数据的链表，只在表头插入，从不删除
+    int in_use;                     // 所属线程退出后为0，可被新线程接管
+    char pad[64 - sizeof(void *) - sizeof(int)];
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    metrics_hist_data_t histograms[METRIC_HISTOGRAM_COUNT];
+} __attribute__((aligned(64))) metrics_thread_t;
+
+typedef struct {
+    const char *name;
+    const char *help;
+    const int *value;
+} metrics_gauge_t;
+
+static metrics_thread_t *metrics_threads = NULL;
+static pthread_once_t metrics_once = PTHREAD_ONCE_INIT;
+static pthread_key_t metrics_key;
+static __thread metrics_thread_t *metrics_local = NULL;
+
+// 瞬时值只在启动时注册，注册加锁，查询时按已发布的数量读取
+static metrics_gauge_t metrics_gauges[METRICS_MAX_GAUGES];
+static int metrics_gauge_count = 0;
+static pthread_mutex_t metrics_gauge_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 计数器的名称及说明，同名的相邻项为同一指标的不同标签
+static const struct {
+    const char *name;
+    const char *help;
+    const char *labels;
+} metrics_counter_info[METRIC_COUNTER_COUNT] = {
+    [METRIC_HTTP_CONNECTIONS]       = { "server_http_connections_total", "HTTP connections accepted.", NULL },
+    [METRIC_HTTP_REJECTED]          = { "server_http_connections_rejected_total",
+                                        "HTTP connections rejected at the connection limit.", NULL },
+    [METRIC_HTTP_REQUESTS]          = { "server_http_requests_total", "HTTP requests handled.", NULL },
+    [METRIC_HTTP_RESPONSES_1XX]     = { "server_http_responses_total", "HTTP responses completed, by status class.",
+                                        "code=\"1xx\"" },
+    [METRIC_HTTP_RESPONSES_2XX]     = { "server_http_responses_total", NULL, "code=\"2xx\"" },
+    [METRIC_HTTP_RESPONSES_3XX]     = { "server_http_responses_total", NULL, "code=\"3xx\"" },
+    [METRIC_HTTP_RESPONSES_4XX]     = { "server_http_responses_total", NULL, "code=\"4xx\"" },
+    [METRIC_HTTP_RESPONSES_5XX]     = { "server_http_responses_total", NULL, "code=\"5xx\"" },
+    [METRIC_HTTP_ABORTED]           = { "server_http_aborted_total",
+                                        "HTTP requests whose connection closed before the response completed.", NULL },
+    [METRIC_HTTP_BYTES_SENT]        = { "server_http_sent_bytes_total", "HTTP bytes sent, headers included.", NULL },
+    [METRIC_HTTP_FILE_RESPONSES]    = { "server_http_file_responses_total", "HTTP file responses generated.", NULL },
+    [METRIC_HTTP_LISTING_RESPONSES] = { "server_http_listing_responses_total",
+                                        "HTTP directory listings generated.", NULL },
+    [METRIC_FTP_SESSIONS]           = { "server_ftp_sessions_total", "FTP control connections accepted.", NULL },
+    [METRIC_FTP_COMMANDS]           = { "server_ftp_commands_total", "FTP commands received.", NULL },
+    [METRIC_FTP_RETR]               = { "server_ftp_transfers_total", "FTP data transfers, by command.",
+                                        "command=\"RETR\"" },
+    [METRIC_FTP_LIST]               = { "server_ftp_transfers_total", NULL, "command=\"LIST\"" },
+    [METRIC_FTP_NLST]               = { "server_ftp_transfers_total", NULL, "command=\"NLST\"" },
+    [METRIC_FTP_MLSD]               = { "server_ftp_transfers_total", NULL, "command=\"MLSD\"" },
+    [METRIC_FTP_STOR]               = { "server_ftp_transfers_total", NULL, "command=\"STOR\"" },
+    [METRIC_FTP_APPE]               = { "server_ftp_transfers_total", NULL, "command=\"APPE\"" },
+    [METRIC_FTP_TRANSFER_ERRORS]    = { "server_ftp_transfer_errors_total",
+                                        "FTP data transfers that failed or were aborted.", NULL },
+    [METRIC_FTP_BYTES_SENT]         = { "server_ftp_sent_bytes_total", "FTP data connection bytes sent.", NULL },
+    [METRIC_FTP_BYTES_RECEIVED]     = { "server_ftp_received_bytes_total",
+                                        "FTP upload bytes written to files.", NULL },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} metrics_histogram_info[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_HTTP_REQUEST_DURATION]  = { "server_http_request_duration_seconds",
+                                        "Time from the first request byte to the last response byte." },
+    [METRIC_HTTP_FIRST_BYTE]        = { "server_http_time_to_first_byte_seconds",
+                                        "Time from the first request byte to the first response byte." },
+    [METRIC_HTTP_RESOLVE]           = { "server_http_resolve_duration_seconds",
+                                        "Time spent resolving the request path, cache lookups included." },
+    [METRIC_FTP_TRANSFER_DURATION]  = { "server_ftp_transfer_duration_seconds",
+                                        "Time from an FTP data transfer command to the end of the transfer." },
+};
+
+// 线程退出时释放其统计数据，计数保留
+static void metrics_thread_release(void *arg) {
+    metrics_thread_t *thread = arg;
+    __atomic_store_n(&thread->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void metrics_key_create(void) {
+    pthread_key_create(&metrics_key, metrics_thread_release);
+}
+
+// 取本线程的统计数据：优先接管已退出线程的，否则新建并插入链表头，内存不足时返回NULL
+static metrics_thread_t *metrics_self(void) {
+    if (metrics_local != NULL) {
+        return metrics_local;
+    }
+    pthread_once(&metrics_once, metrics_key_create);
+    metrics_thread_t *thread;
+    for (thread = __atomic_load_n(&metrics_threads, __ATOMIC_ACQUIRE); thread != NULL; thread = thread->next) {
+        int expected = 0;
+        if (__atomic_load_n(&thread->in_use, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&thread->in_use, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (thread == NULL) {
+        if (posix_memalign((void **)&thread, 64, sizeof(*thread)) != 0) {
+            return NULL;
+        }
+        memset(thread, 0, sizeof(*thread));
+        thread->in_use = 1;
+        thread->next = __atomic_load_n(&metrics_threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&metrics_threads, &thread->next, thread, true,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    pthread_setspecific(metrics_key, thread);
+    metrics_local = thread;
+    return thread;
+}
+
+// 只有所属线程写入，读取方可能看到稍旧的值，但不会看到撕裂的值
+static inline void metrics_bump(uint64_t *value, uint64_t n) {
+    __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+void metrics_add(metrics_counter_t counter, uint64_t n) {
+    metrics_thread_t *thread = metrics_self();
+    if (thread != NULL) {
+        metrics_bump(&thread->counters[counter], n);
+    }
+}
+
+// 值所在的桶
+static unsigned metrics_bucket(uint64_t us) {
+    if (us < METRICS_SUB_COUNT) {
+        return (unsigned)us;
+    }
+    unsigned msb = 63 - __builtin_clzll(us);
+    if (msb > METRICS_MAX_MSB) {
+        return METRICS_BUCKETS - 1;
+    }
+    unsigned sub = (us >> (msb - METRICS_SUB_BITS)) & (METRICS_SUB_COUNT - 1);
+    return (msb - METRICS_SUB_BITS + 1) * METRICS_SUB_COUNT + sub;
+}
+
+// 桶中的最大值（含），单位微秒；Prometheus的le为闭区间，取值均为整数微秒，上界（不含）减一即可
+static uint64_t metrics_bucket_max(unsigned bucket) {
+    if (bucket < METRICS_SUB_COUNT) {
+        return bucket;
+    }
+    unsigned msb = bucket / METRICS_SUB_COUNT + METRICS_SUB_BITS - 1;
+    uint64_t sub = bucket % METRICS_SUB_COUNT;
+    return ((METRICS_SUB_COUNT + sub + 1) << (msb - METRICS_SUB_BITS)) - 1;
+}
+
+void metrics_observe(metrics_histogram_t histogram, uint64_t us) {
+    metrics_thread_t *thread = metrics_self();
+    if (thread != NULL) {
+        metrics_hist_data_t *hist = &thread->histograms[histogram];
+        metrics_bump(&hist->buckets[metrics_bucket(us)], 1);
+        metrics_bump(&hist->sum, us);
+    }
+}
+
+void metrics_register_gauge(const char *name, const char *help, const int *value) {
+    pthread_mutex_lock(&metrics_gauge_lock);
+    int count = metrics_gauge_count;
+    if (count < METRICS_MAX_GAUGES) {
+        metrics_gauges[count].name = name;
+        metrics_gauges[count].help = help;
+        metrics_gauges[count].value = value;
+        __atomic_store_n(&metrics_gauge_count, count + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&metrics_gauge_lock);
+}
+
+static int metrics_header(strbuf_t *sb, const char *prefix, const char *name, const char *help, const char *type) {
+    return strbuf_printf(sb, "%s# HELP %s %s\n%s# TYPE %s %s\n", prefix, name, help, prefix, name, type);
+}
+
+// 以秒为单位输出微秒数
+static int metrics_seconds(strbuf_t *sb, uint64_t us) {
+    return strbuf_printf(sb, "%llu.%06llu", (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+}
+
+static int metrics_render_histogram(strbuf_t *sb, const char *prefix, metrics_histogram_t index) {
+    const char *name = metrics_histogram_info[index].name;
+    uint64_t buckets[METRICS_BUCKETS] = {0};
+    uint64_t sum = 0;
+    for (metrics_thread_t *thread = __atomic_load_n(&metrics_threads, __ATOMIC_ACQUIRE);
+         thread != NULL; thread = thread->next) {
+        const metrics_hist_data_t *hist = &thread->histograms[index];
+        for (unsigned i = 0; i < METRICS_BUCKETS; i++) {
+            buckets[i] += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        }
+        sum += __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+    }
+
+    int ret = metrics_header(sb, prefix, name, metrics_histogram_info[index].help, "histogram");
+    uint64_t count = 0;
+    for (unsigned i = 0; i < METRICS_BUCKETS - 1 && ret == 0; i++) {
+        count += buckets[i];
+        ret = strbuf_printf(sb, "%s%s_bucket{le=\"", prefix, name);
+        ret = ret != 0 ? ret : metrics_seconds(sb, metrics_bucket_max(i));
+        ret = ret != 0 ? ret : strbuf_printf(sb, "\"} %llu\n", (unsigned long long)count);
+    }
+    count += buckets[METRICS_BUCKETS - 1];
+    if (ret == 0) {
+        ret = strbuf_printf(sb, "%s%s_bucket{le=\"+Inf\"} %llu\n%s%s_sum ", prefix, name,
+                            (unsigned long long)count, prefix, name);
+    }
+    ret = ret != 0 ? ret : metrics_seconds(sb, sum);
+    ret = ret != 0 ? ret : strbuf_printf(sb, "\n%s%s_count %llu\n", prefix, name, (unsigned long long)count);
+    return ret;
+}
+
+int metrics_render(strbuf_t *sb, const char *prefix) {
+    if (prefix == NULL) {
+        prefix = "";
+    }
+    uint64_t counters[METRIC_COUNTER_COUNT] = {0};
+    for (metrics_thread_t *thread = __atomic_load_n(&metrics_threads, __ATOMIC_ACQUIRE);
+         thread != NULL; thread = thread->next) {
+        for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            counters[i] += __atomic_load_n(&thread->counters[i], __ATOMIC_RELAXED);
+        }
+    }
+
+    int ret = 0;
+    for (int i = 0; i < METRIC_COUNTER_COUNT && ret == 0; i++) {
+        if (metrics_counter_info[i].help != NULL) {
+            ret = metrics_header(sb, prefix, metrics_counter_info[i].name, metrics_counter_info[i].help, "counter");
+        }
+        if (ret == 0 && metrics_counter_info[i].labels != NULL) {
+            ret = strbuf_printf(sb, "%s%s{%s} %llu\n", prefix, metrics_counter_info[i].name,
+                                metrics_counter_info[i].labels, (unsigned long long)counters[i]);
+        } else if (ret == 0) {
+            ret = strbuf_printf(sb, "%s%s %llu\n", prefix, metrics_counter_info[i].name,
+                                (unsigned long long)counters[i]);
+        }
+    }
+    int gauges = __atomic_load_n(&metrics_gauge_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < gauges && ret == 0; i++) {
+        ret = metrics_header(sb, prefix, metrics_gauges[i].name, metrics_gauges[i].help, "gauge");
+        if (ret == 0) {
+            ret = strbuf_printf(sb, "%s%s %d\n", prefix, metrics_gauges[i].name,
+                                __atomic_load_n(metrics_gauges[i].value, __ATOMIC_RELAXED));
+        }
+    }
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT && ret == 0; i++) {
+        ret = metrics_render_histogram(sb, prefix, i);
+    }
+    return ret;
+}
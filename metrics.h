@@ -0,0 +1,65 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "utils.h"
+
+// 运行统计：每个线程独占一组按缓存行对齐的计数器和延迟直方图，只由本线程写入，无锁也无原子读改写
+// 查询时累加所有线程的数据，以Prometheus文本格式输出；线程退出后其计数由新线程接管继续累加，总数不丢失
+
+// 计数器
+typedef enum {
+    METRIC_HTTP_CONNECTIONS,        // 接受的HTTP连接
+    METRIC_HTTP_REJECTED,           // 超出连接数上限被拒绝的连接
+    METRIC_HTTP_REQUESTS,           // 处理的HTTP请求
+    METRIC_HTTP_RESPONSES_1XX,      // 按状态码类别统计的已完成响应
+    METRIC_HTTP_RESPONSES_2XX,
+    METRIC_HTTP_RESPONSES_3XX,
+    METRIC_HTTP_RESPONSES_4XX,
+    METRIC_HTTP_RESPONSES_5XX,
+    METRIC_HTTP_ABORTED,            // 响应未发送完毕连接即关闭
+    METRIC_HTTP_BYTES_SENT,
+    METRIC_HTTP_FILE_RESPONSES,     // send_file生成的响应
+    METRIC_HTTP_LISTING_RESPONSES,  // send_directory_listing生成的响应
+    METRIC_FTP_SESSIONS,
+    METRIC_FTP_COMMANDS,
+    METRIC_FTP_RETR,
+    METRIC_FTP_LIST,
+    METRIC_FTP_NLST,
+    METRIC_FTP_MLSD,
+    METRIC_FTP_STOR,
+    METRIC_FTP_APPE,
+    METRIC_FTP_TRANSFER_ERRORS,     // 失败或中断的数据传输
+    METRIC_FTP_BYTES_SENT,
+    METRIC_FTP_BYTES_RECEIVED,      // STOR/APPE写入的文件数据
+    METRIC_COUNTER_COUNT
+} metrics_counter_t;
+
+// 延迟直方图，单位微秒
+typedef enum {
+    METRIC_HTTP_REQUEST_DURATION,   // 收到请求首字节到响应发送完毕
+    METRIC_HTTP_FIRST_BYTE,         // 收到请求首字节到发出响应首字节
+    METRIC_HTTP_RESOLVE,            // 路径解析（含缓存查找）耗时
+    METRIC_FTP_TRANSFER_DURATION,   // 数据传输从收到命令到传输结束
+    METRIC_HISTOGRAM_COUNT
+} metrics_histogram_t;
+
+// 计数器加n
+void metrics_add(metrics_counter_t counter, uint64_t n);
+
+static inline void metrics_inc(metrics_counter_t counter) {
+    metrics_add(counter, 1);
+}
+
+// 记录一次耗时（微秒）
+void metrics_observe(metrics_histogram_t histogram, uint64_t us);
+
+// 注册一个瞬时值（如当前连接数），查询时直接读取*value；最多注册METRICS_MAX_GAUGES个
+#define METRICS_MAX_GAUGES 8
+void metrics_register_gauge(const char *name, const char *help, const int *value);
+
+// 汇总所有线程的数据，以Prometheus文本格式（version 0.0.4）追加到sb，内存不足时返回-1
+// prefix非空时加在每行开头（FTP多行应答要求续行以空格开头）
+int metrics_render(strbuf_t *sb, const char *prefix);
+
+#endif // METRICS_H
@@ -0,0 +1,502 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "mime.h"
+
+// 内置类型，格式与mime.types相同
+static const char builtin_types[] =
+    "text/html                  html htm\n"
+    "text/plain                 txt text log\n"
+    "text/css                   css\n"
+    "text/csv                   csv\n"
+    "text/markdown              md markdown\n"
+    "text/xml                   xml\n"
+    "application/javascript     js mjs\n"
+    "application/json           json map\n"
+    "application/manifest+json  webmanifest\n"
+    "application/rss+xml        rss\n"
+    "application/atom+xml       atom\n"
+    "application/wasm           wasm\n"
+    "application/pdf            pdf\n"
+    "application/zip            zip\n"
+    "application/gzip           gz tgz\n"
+    "application/x-bzip2        bz2\n"
+    "application/x-xz           xz\n"
+    "application/x-tar          tar\n"
+    "application/x-7z-compressed 7z\n"
+    "application/octet-stream   bin exe dll iso img deb rpm\n"
+    "image/jpeg                 jpg jpeg\n"
+    "image/png                  png\n"
+    "image/gif                  gif\n"
+    "image/webp                 webp\n"
+    "image/avif                 avif\n"
+    "image/svg+xml              svg\n"
+    "image/x-icon               ico\n"
+    "image/bmp                  bmp\n"
+    "image/tiff                 tif tiff\n"
+    "font/woff                  woff\n"
+    "font/woff2                 woff2\n"
+    "font/ttf                   ttf\n"
+    "font/otf                   otf\n"
+    "audio/mpeg                 mp3\n"
+    "audio/ogg                  ogg oga\n"
+    "audio/wav                  wav\n"
+    "audio/flac                 flac\n"
+    "video/mp4                  mp4 m4v\n"
+    "video/webm                 webm\n"
+    "video/x-matroska           mkv\n"
+    "video/quicktime            mov\n";
+
+// 完美哈希的每个桶平均容纳的扩展名数，以及槽位表的最大负载（分数形式）
+#define MIME_BUCKET_LOAD   4
+#define MIME_SLOT_LOAD_NUM 4
+#define MIME_SLOT_LOAD_DEN 5
+// 单个桶尝试的种子数上限，超出后扩大槽位表重建
+#define MIME_SEED_LIMIT    (1u << 16)
+
+typedef struct {
+    char ext[MIME_MAX_EXT + 1];     // 小写扩展名，len为0表示空槽
+    uint32_t len;
+    uint32_t type;                  // types数组下标
+} mime_slot_t;
+
+struct mime_registry {
+    mime_type_t *types;
+    size_t type_count;
+    mime_type_t default_type;
+    mime_slot_t *slots;
+    uint32_t slot_mask;
+    uint32_t *seeds;                // 每个桶的种子
+    uint32_t bucket_count;
+    size_t ext_count;
+};
+
+// 构建期间收集的扩展名，seq用于同名扩展名保留最后一次定义
+typedef struct {
+    mime_slot_t slot;
+    uint64_t hash;
+    uint32_t seq;
+    uint32_t bucket;
+} mime_ext_t;
+
+typedef struct {
+    mime_registry_t *registry;
+    size_t type_cap;
+    mime_ext_t *exts;
+    size_t ext_count;
+    size_t ext_cap;
+} mime_builder_t;
+
+// 64位混合函数，使每一位都依赖输入的全部位
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+// FNV-1a 64位哈希，调用者已转为小写
+// 短字符串的FNV结果高位分布很差，经混合后再用于分桶
+static uint64_t ext_hash(const char *ext, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)ext[i];
+        hash *= 1099511628211ull;
+    }
+    return mix64(hash);
+}
+
+// 按桶种子把哈希值映射到槽位
+static uint32_t slot_index(uint64_t hash, uint32_t seed, uint32_t mask) {
+    return (uint32_t)mix64(hash + seed * 0x9e3779b97f4a7c15ull) & mask;
+}
+
+static uint32_t bucket_index(uint64_t hash, uint32_t bucket_count) {
+    return (uint32_t)(hash >> 32) % bucket_count;
+}
+
+// 把扩展名转为小写写入buf，超长或含路径分隔符时返回0
+static size_t ext_lower(const char *ext, size_t len, char *buf) {
+    if (len == 0 || len > MIME_MAX_EXT) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = ext[i];
+        if (c == '/') {
+            return 0;
+        }
+        buf[i] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+static int ends_with(const char *str, const char *suffix) {
+    size_t len = strlen(str), slen = strlen(suffix);
+    return len >= slen && strcmp(str + len - slen, suffix) == 0;
+}
+
+// 按类型推断默认标志：文本及结构化文本可压缩，音视频通常较大且按Range发送，不进入内容缓存
+static unsigned default_flags(const char *type) {
+    static const char *const compressible[] = {
+        "application/javascript", "application/json", "application/xml", "application/wasm",
+        "image/x-icon", "image/bmp", "font/ttf", "font/otf",
+    };
+    unsigned flags = MIME_CACHEABLE;
+    if (strncmp(type, "audio/", 6) == 0 || strncmp(type, "video/", 6) == 0) {
+        flags = 0;
+    }
+    if (strncmp(type, "text/", 5) == 0 || ends_with(type, "+xml") || ends_with(type, "+json")) {
+        return flags | MIME_COMPRESSIBLE;
+    }
+    for (size_t i = 0; i < sizeof(compressible) / sizeof(compressible[0]); i++) {
+        if (strcmp(type, compressible[i]) == 0) {
+            return flags | MIME_COMPRESSIBLE;
+        }
+    }
+    return flags;
+}
+
+static int builder_add_type(mime_builder_t *b, const char *type, size_t len, uint32_t *index) {
+    mime_registry_t *r = b->registry;
+    if (r->type_count == b->type_cap) {
+        size_t cap = b->type_cap ? b->type_cap * 2 : 64;
+        mime_type_t *types = realloc(r->types, cap * sizeof(*types));
+        if (types == NULL) {
+            return -1;
+        }
+        r->types = types;
+        b->type_cap = cap;
+    }
+    char *name = strndup(type, len);
+    if (name == NULL) {
+        return -1;
+    }
+    r->types[r->type_count].type = name;
+    r->types[r->type_count].flags = default_flags(name);
+    *index = (uint32_t)r->type_count++;
+    return 0;
+}
+
+static int builder_add_ext(mime_builder_t *b, const char *ext, size_t len, uint32_t type) {
+    if (len > 0 && ext[0] == '.') {
+        ext++;
+        len--;
+    }
+    mime_ext_t e = {0};
+    if (ext_lower(ext, len, e.slot.ext) == 0) {
+        return 0;   // 忽略无法匹配的扩展名
+    }
+    if (b->ext_count == b->ext_cap) {
+        size_t cap = b->ext_cap ? b->ext_cap * 2 : 128;
+        mime_ext_t *exts = realloc(b->exts, cap * sizeof(*exts));
+        if (exts == NULL) {
+            return -1;
+        }
+        b->exts = exts;
+        b->ext_cap = cap;
+    }
+    e.slot.len = (uint32_t)len;
+    e.slot.type = type;
+    e.hash = ext_hash(e.slot.ext, len);
+    e.seq = (uint32_t)b->ext_count;
+    b->exts[b->ext_count++] = e;
+    return 0;
+}
+
+// 解析mime.types格式的文本：每行"类型 扩展名..."，#后为注释，空白及'='均作为分隔符
+static int builder_parse(mime_builder_t *b, const char *text, size_t text_len) {
+    const char *end = text + text_len;
+    const char *p = text;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (eol == NULL) {
+            eol = end;
+        }
+        const char *hash = memchr(p, '#', eol - p);
+        const char *line_end = hash != NULL ? hash : eol;
+
+        // 类型在遇到第一个扩展名时才登记，只有类型没有扩展名的行不占用类型表
+        const char *type_name = NULL;
+        size_t type_len = 0;
+        int added = 0;
+        uint32_t type = 0;
+        unsigned set = 0, clear = 0;
+        while (p < line_end) {
+            while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '=')) {
+                p++;
+            }
+            const char *tok = p;
+            while (p < line_end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '=') {
+                p++;
+            }
+            size_t len = p - tok;
+            if (len == 0) {
+                break;
+            }
+            if (type_name == NULL) {
+                // 第一个字段为类型，不含'/'的行视为无效
+                if (memchr(tok, '/', len) == NULL) {
+                    break;
+                }
+                type_name = tok;
+                type_len = len;
+            } else if (tok[0] == '+' || tok[0] == '-') {
+                unsigned flag = 0;
+                if (len == 9 && memcmp(tok + 1, "compress", 8) == 0) {
+                    flag = MIME_COMPRESSIBLE;
+                } else if (len == 6 && memcmp(tok + 1, "cache", 5) == 0) {
+                    flag = MIME_CACHEABLE;
+                }
+                if (tok[0] == '+') {
+                    set |= flag;
+                } else {
+                    clear |= flag;
+                }
+            } else {
+                if (!added) {
+                    if (builder_add_type(b, type_name, type_len, &type) != 0) {
+                        return -1;
+                    }
+                    added = 1;
+                }
+                if (builder_add_ext(b, tok, len, type) != 0) {
+                    return -1;
+                }
+            }
+        }
+        if (added) {
+            mime_type_t *t = &b->registry->types[type];
+            t->flags = (t->flags | set) & ~clear;
+        }
+        p = eol + 1;
+    }
+    return 0;
+}
+
+static int load_file(mime_builder_t *b, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "MIME types file %s: %s\n", path, strerror(errno));
+        return 0;   // 文件不可用时仍使用内置类型
+    }
+    char *text = NULL;
+    size_t len = 0, cap = 0;
+    int ret = 0;
+    for (;;) {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 65536;
+            char *grown = realloc(text, cap);
+            if (grown == NULL) {
+                ret = -1;
+                break;
+            }
+            text = grown;
+        }
+        size_t n = fread(text + len, 1, cap - len, file);
+        len += n;
+        if (n == 0) {
+            break;
+        }
+    }
+    fclose(file);
+    if (ret == 0) {
+        ret = builder_parse(b, text, len);
+    }
+    free(text);
+    return ret;
+}
+
+static int ext_compare(const void *a, const void *b) {
+    const mime_ext_t *x = a, *y = b;
+    int cmp = strcmp(x->slot.ext, y->slot.ext);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+// 桶按大小降序处理，同一桶的扩展名相邻
+static int bucket_compare(const void *a, const void *b) {
+    const uint32_t *x = a, *y = b;
+    if (x[1] != y[1]) {
+        return x[1] > y[1] ? -1 : 1;
+    }
+    return x[0] < y[0] ? -1 : x[0] > y[0];
+}
+
+static int ext_bucket_compare(const void *a, const void *b) {
+    const mime_ext_t *x = a, *y = b;
+    return x->bucket < y->bucket ? -1 : x->bucket > y->bucket;
+}
+
+// 为每个桶寻找种子，使全部扩展名落入互不相同的槽位，失败时返回1
+static int build_perfect_hash(mime_registry_t *r, mime_ext_t *exts, size_t n, uint32_t nslots) {
+    uint32_t nbuckets = r->bucket_count;
+    uint32_t (*order)[2] = calloc(nbuckets, sizeof(*order));  // {桶号, 大小}
+    size_t *start = calloc(nbuckets + 1, sizeof(*start));
+    uint8_t *used = calloc(nslots, 1);
+    uint32_t probe[64];
+    int ret = -1;
+    if (order == NULL || start == NULL || used == NULL) {
+        goto out;
+    }
+
+    for (uint32_t i = 0; i < nbuckets; i++) {
+        order[i][0] = i;
+    }
+    for (size_t i = 0; i < n; i++) {
+        exts[i].bucket = bucket_index(exts[i].hash, nbuckets);
+        order[exts[i].bucket][1]++;
+    }
+    qsort(exts, n, sizeof(*exts), ext_bucket_compare);
+    for (uint32_t i = 0; i < nbuckets; i++) {
+        start[i + 1] = start[i] + order[i][1];
+    }
+    qsort(order, nbuckets, sizeof(*order), bucket_compare);
+
+    ret = 1;
+    for (uint32_t i = 0; i < nbuckets && order[i][1] > 0; i++) {
+        uint32_t bucket = order[i][0];
+        size_t first = start[bucket], count = order[i][1];
+        if (count > sizeof(probe) / sizeof(probe[0])) {
+            goto out;
+        }
+        uint32_t seed;
+        for (seed = 0; seed < MIME_SEED_LIMIT; seed++) {
+            size_t k;
+            for (k = 0; k < count; k++) {
+                probe[k] = slot_index(exts[first + k].hash, seed, nslots - 1);
+                if (used[probe[k]]) {
+                    break;
+                }
+                used[probe[k]] = 1;
+            }
+            if (k == count) {
+                break;
+            }
+            while (k-- > 0) {
+                used[probe[k]] = 0;
+            }
+        }
+        if (seed == MIME_SEED_LIMIT) {
+            goto out;
+        }
+        r->seeds[bucket] = seed;
+        for (size_t k = 0; k < count; k++) {
+            r->slots[probe[k]] = exts[first + k].slot;
+        }
+    }
+    ret = 0;
+
+out:
+    free(order);
+    free(start);
+    free(used);
+    return ret;
+}
+
+static int build_table(mime_registry_t *r, mime_ext_t *exts, size_t n) {
+    // 同名扩展名只保留最后一次定义
+    qsort(exts, n, sizeof(*exts), ext_compare);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i + 1 < n && strcmp(exts[i].slot.ext, exts[i + 1].slot.ext) == 0) {
+            continue;
+        }
+        exts[unique++] = exts[i];
+    }
+    r->ext_count = unique;
+    r->bucket_count = (uint32_t)(unique / MIME_BUCKET_LOAD + 1);
+
+    uint32_t nslots = 1;
+    while (nslots * MIME_SLOT_LOAD_NUM < unique * MIME_SLOT_LOAD_DEN) {
+        nslots <<= 1;
+    }
+    r->seeds = calloc(r->bucket_count, sizeof(*r->seeds));
+    if (r->seeds == NULL) {
+        return -1;
+    }
+    for (;;) {
+        r->slots = calloc(nslots, sizeof(*r->slots));
+        if (r->slots == NULL) {
+            return -1;
+        }
+        r->slot_mask = nslots - 1;
+        int ret = build_perfect_hash(r, exts, unique, nslots);
+        if (ret <= 0) {
+            return ret;
+        }
+        // 找不到种子（极少发生），扩大槽位表重试
+        free(r->slots);
+        r->slots = NULL;
+        nslots <<= 1;
+    }
+}
+
+mime_registry_t *mime_registry_create(const char *file, const char *rules) {
+    mime_builder_t b = {0};
+    b.registry = calloc(1, sizeof(*b.registry));
+    if (b.registry == NULL) {
+        return NULL;
+    }
+    mime_registry_t *r = b.registry;
+    r->default_type.type = "application/octet-stream";
+    r->default_type.flags = MIME_CACHEABLE;
+
+    int ret = builder_parse(&b, builtin_types, sizeof(builtin_types) - 1);
+    if (ret == 0 && file != NULL && file[0] != '\0') {
+        ret = load_file(&b, file);
+    }
+    if (ret == 0 && rules != NULL) {
+        ret = builder_parse(&b, rules, strlen(rules));
+    }
+    if (ret == 0) {
+        ret = build_table(r, b.exts, b.ext_count);
+    }
+    free(b.exts);
+    if (ret != 0) {
+        mime_registry_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+void mime_registry_destroy(mime_registry_t *registry) {
+    if (registry == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < registry->type_count; i++) {
+        free((char *)registry->types[i].type);
+    }
+    free(registry->types);
+    free(registry->slots);
+    free(registry->seeds);
+    free(registry);
+}
+
+const mime_type_t *mime_registry_lookup(const mime_registry_t *registry, const char *path) {
+    const char *dot = strrchr(path, '.');
+    char ext[MIME_MAX_EXT + 1];
+    size_t len;
+    if (dot == NULL || registry->ext_count == 0 || (len = ext_lower(dot + 1, strnlen(dot + 1, MIME_MAX_EXT + 1), ext)) == 0) {
+        return &registry->default_type;
+    }
+    uint64_t hash = ext_hash(ext, len);
+    uint32_t seed = registry->seeds[bucket_index(hash, registry->bucket_count)];
+    const mime_slot_t *slot = &registry->slots[slot_index(hash, seed, registry->slot_mask)];
+    if (slot->len == len && memcmp(slot->ext, ext, len) == 0) {
+        return &registry->types[slot->type];
+    }
+    return &registry->default_type;
+}
+
+void mime_registry_stats(const mime_registry_t *registry, size_t *types, size_t *extensions) {
+    *types = registry->type_count;
+    *extensions = registry->ext_count;
+}
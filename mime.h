@@ -0,0 +1,36 @@
+#ifndef MIME_H
+#define MIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MIME类型标志
+#define MIME_COMPRESSIBLE   0x01    // 可按Accept-Encoding压缩发送
+#define MIME_CACHEABLE      0x02    // 可进入小文件内容缓存
+
+// 扩展名的最大长度（不含点），更长的扩展名按默认类型处理
+#define MIME_MAX_EXT 15
+
+typedef struct {
+    const char *type;           // 如"text/html"
+    unsigned flags;             // MIME_*
+} mime_type_t;
+
+typedef struct mime_registry mime_registry_t;
+
+// 创建MIME类型表：先加载内置类型，再依次加载file（mime.types格式，可为NULL或空串）
+// 和rules（与mime.types同格式的文本，每行"类型 扩展名..."，可为NULL），后定义的覆盖先定义的
+// 每行可附加+compress/-compress、+cache/-cache调整标志，未指定时按类型推断
+// 构建完成后只读，可被多个线程同时查询；内存不足时返回NULL
+mime_registry_t *mime_registry_create(const char *file, const char *rules);
+
+void mime_registry_destroy(mime_registry_t *registry);
+
+// 按文件路径的扩展名查询（不区分大小写），未注册的扩展名返回application/octet-stream
+// 使用构建时生成的完美哈希，查询耗时与注册的类型数量无关
+const mime_type_t *mime_registry_lookup(const mime_registry_t *registry, const char *path);
+
+// 注册的类型数与扩展名数
+void mime_registry_stats(const mime_registry_t *registry, size_t *types, size_t *extensions);
+
+#endif // MIME_H
@@ -0,0 +1,363 @@
+#include "utils.h"
+#include "path_cache.h"
+
+// 分片数量，需为2的幂；每个分片独立加锁以减少工作线程间的竞争
+#define PATH_CACHE_SHARDS 16
+
+typedef struct {
+    pthread_mutex_t lock;
+    path_cache_entry_t **buckets;
+    size_t bucket_mask;
+    size_t count;
+    size_t capacity;
+    path_cache_entry_t *lru_head;   // 最近使用
+    path_cache_entry_t *lru_tail;   // 最久未使用，优先淘汰
+    path_cache_entry_t *exp_head;   // 最早过期，有效期固定，按放入顺序即过期顺序
+    path_cache_entry_t *exp_tail;
+} path_cache_shard_t;
+
+struct path_cache {
+    char root[PATH_MAX];            // 启动时解析的根目录绝对路径
+    size_t root_len;
+    int root_fd;                    // 根目录，文件均相对它打开
+    size_t capacity;
+    int ttl_ms;
+    uint64_t hits;
+    uint64_t misses;
+    path_cache_shard_t shards[PATH_CACHE_SHARDS];
+};
+
+// FNV-1a哈希
+static uint32_t hash_key(const char *key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 解析URL路径：按字面规范化后相对根目录fd打开，越出根目录由规范化及内核检查，
+// 只需open和fstat两次系统调用；FIFO等特殊文件以非阻塞方式打开，随即关闭
+static void resolve_entry(const path_cache_t *cache, path_cache_entry_t *entry) {
+    char norm[PATH_MAX];
+    char real_path[PATH_MAX];
+
+    if (path_normalize(norm, sizeof(norm), entry->key, false) < 0) {
+        entry->status = errno == ENAMETOOLONG ? 414 : 403;
+        return;
+    }
+    // 文件系统路径为根目录加规范化路径，根目录本身及根目录为"/"时不重复斜杠
+    if (!safe_path_join(real_path, sizeof(real_path), cache->root_len > 1 ? cache->root : "",
+                        norm[1] != '\0' || cache->root_len == 1 ? norm : "", "")) {
+        entry->status = 414;
+        return;
+    }
+    int fd = open_beneath(cache->root_fd, norm[1] != '\0' ? norm + 1 : ".",
+                          O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd == -1) {
+        switch (errno) {
+        case ENOENT:
+        case ENOTDIR:
+            entry->status = 404;
+            break;
+        case ENAMETOOLONG:
+            entry->status = 414;
+            break;
+        case EMFILE:
+        case ENFILE:
+            entry->status = 503;    // fd暂时耗尽，不缓存
+            break;
+        case ENOMEM:
+            entry->status = 500;
+            break;
+        default:
+            entry->status = 403;
+            break;
+        }
+        return;
+    }
+    if (fstat(fd, &entry->st) == -1) {
+        close(fd);
+        entry->status = 404;
+        return;
+    }
+    entry->real_path = strdup(real_path);
+    if (entry->real_path == NULL) {
+        close(fd);
+        entry->status = 500;
+        return;
+    }
+    if (S_ISREG(entry->st.st_mode) || S_ISDIR(entry->st.st_mode)) {
+        entry->fd = fd;
+    } else {
+        close(fd);
+    }
+}
+
+static path_cache_entry_t *entry_create(const char *key, uint32_t hash) {
+    path_cache_entry_t *entry = calloc(1, sizeof(*entry));
+    if (entry == NULL) {
+        return NULL;
+    }
+    entry->key = strdup(key);
+    if (entry->key == NULL) {
+        free(entry);
+        return NULL;
+    }
+    entry->hash = hash;
+    entry->fd = -1;
+    return entry;
+}
+
+static void entry_free(path_cache_entry_t *entry) {
+    if (entry->fd != -1) {
+        close(entry->fd);
+    }
+    free(entry->real_path);
+    free(entry->key);
+    free(entry);
+}
+
+void path_cache_release(path_cache_entry_t *entry) {
+    if (entry != NULL && __atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        entry_free(entry);
+    }
+}
+
+// 以下函数需持有分片锁
+static path_cache_entry_t *shard_find(path_cache_shard_t *shard, uint32_t hash, const char *key) {
+    path_cache_entry_t *entry = shard->buckets[hash & shard->bucket_mask];
+    while (entry != NULL) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->hash_next;
+    }
+    return NULL;
+}
+
+static void lru_unlink(path_cache_shard_t *shard, path_cache_entry_t *entry) {
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(path_cache_shard_t *shard, path_cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head != NULL) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+    shard->lru_head = entry;
+}
+
+static void exp_unlink(path_cache_shard_t *shard, path_cache_entry_t *entry) {
+    if (entry->exp_prev != NULL) {
+        entry->exp_prev->exp_next = entry->exp_next;
+    } else {
+        shard->exp_head = entry->exp_next;
+    }
+    if (entry->exp_next != NULL) {
+        entry->exp_next->exp_prev = entry->exp_prev;
+    } else {
+        shard->exp_tail = entry->exp_prev;
+    }
+    entry->exp_prev = entry->exp_next = NULL;
+}
+
+static void exp_push_back(path_cache_shard_t *shard, path_cache_entry_t *entry) {
+    entry->exp_next = NULL;
+    entry->exp_prev = shard->exp_tail;
+    if (shard->exp_tail != NULL) {
+        shard->exp_tail->exp_next = entry;
+    } else {
+        shard->exp_head = entry;
+    }
+    shard->exp_tail = entry;
+}
+
+// 从分片中摘除缓存项，表持有的引用由调用者在解锁后释放
+static void shard_remove(path_cache_shard_t *shard, path_cache_entry_t *entry) {
+    path_cache_entry_t **link = &shard->buckets[entry->hash & shard->bucket_mask];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    entry->hash_next = NULL;
+    lru_unlink(shard, entry);
+    exp_unlink(shard, entry);
+    shard->count--;
+}
+
+static void release_list(path_cache_entry_t *removed) {
+    while (removed != NULL) {
+        path_cache_entry_t *next = removed->hash_next;
+        path_cache_release(removed);
+        removed = next;
+    }
+}
+
+path_cache_t *path_cache_create(const char *root_dir, size_t capacity, int ttl_ms) {
+    path_cache_t *cache = calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    if (realpath(root_dir, cache->root) == NULL) {
+        perror("realpath");
+        free(cache);
+        return NULL;
+    }
+    cache->root_len = strlen(cache->root);
+    cache->root_fd = open(cache->root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cache->root_fd == -1) {
+        perror("open root_dir");
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->ttl_ms = ttl_ms;
+
+    size_t per_shard = (capacity + PATH_CACHE_SHARDS - 1) / PATH_CACHE_SHARDS;
+    size_t nbuckets = 1;
+    while (nbuckets < per_shard) {
+        nbuckets <<= 1;
+    }
+    for (int i = 0; i < PATH_CACHE_SHARDS; i++) {
+        path_cache_shard_t *shard = &cache->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->capacity = per_shard;
+        shard->bucket_mask = nbuckets - 1;
+        shard->buckets = calloc(nbuckets, sizeof(*shard->buckets));
+        if (shard->buckets == NULL) {
+            path_cache_destroy(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void path_cache_destroy(path_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (int i = 0; i < PATH_CACHE_SHARDS; i++) {
+        path_cache_shard_t *shard = &cache->shards[i];
+        while (shard->lru_head != NULL) {
+            path_cache_entry_t *entry = shard->lru_head;
+            shard_remove(shard, entry);
+            path_cache_release(entry);
+        }
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    close(cache->root_fd);
+    free(cache);
+}
+
+path_cache_entry_t *path_cache_get(path_cache_t *cache, const char *url_path, uint64_t now_ms) {
+    uint32_t hash = hash_key(url_path);
+    path_cache_shard_t *shard = &cache->shards[hash & (PATH_CACHE_SHARDS - 1)];
+    path_cache_entry_t *entry;
+
+    if (cache->capacity > 0) {
+        pthread_mutex_lock(&shard->lock);
+        entry = shard_find(shard, hash, url_path);
+        if (entry != NULL && entry->expires_ms > now_ms) {
+            lru_unlink(shard, entry);
+            lru_push_front(shard, entry);
+            __atomic_add_fetch(&entry->refcount, 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&shard->lock);
+            __atomic_add_fetch(&cache->hits, 1, __ATOMIC_RELAXED);
+            return entry;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    __atomic_add_fetch(&cache->misses, 1, __ATOMIC_RELAXED);
+
+    // 未命中或已过期：在锁外解析，避免文件系统调用阻塞其他线程
+    entry = entry_create(url_path, hash);
+    if (entry == NULL) {
+        return NULL;
+    }
+    resolve_entry(cache, entry);
+    entry->expires_ms = now_ms + cache->ttl_ms;
+    entry->refcount = 1;
+    if (cache->capacity == 0 || entry->status == 500 || entry->status == 503) {
+        return entry;
+    }
+    entry->refcount = 2;    // 缓存表与调用者各持一个引用
+
+    // 替换旧缓存项并按LRU淘汰超出容量的项，被摘除的项在解锁后释放
+    path_cache_entry_t *removed = NULL;
+    pthread_mutex_lock(&shard->lock);
+    path_cache_entry_t *old = shard_find(shard, hash, url_path);
+    if (old != NULL) {
+        shard_remove(shard, old);
+        old->hash_next = removed;
+        removed = old;
+    }
+    size_t bucket = hash & shard->bucket_mask;
+    entry->hash_next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    lru_push_front(shard, entry);
+    exp_push_back(shard, entry);
+    shard->count++;
+    while (shard->count > shard->capacity) {
+        path_cache_entry_t *victim = shard->lru_tail;
+        shard_remove(shard, victim);
+        victim->hash_next = removed;
+        removed = victim;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    release_list(removed);
+    return entry;
+}
+
+int path_cache_expire(path_cache_t *cache, uint64_t now_ms) {
+    uint64_t next = UINT64_MAX;
+    if (cache->capacity == 0) {
+        return -1;
+    }
+    for (int i = 0; i < PATH_CACHE_SHARDS; i++) {
+        path_cache_shard_t *shard = &cache->shards[i];
+        path_cache_entry_t *removed = NULL;
+        pthread_mutex_lock(&shard->lock);
+        // 各线程的时钟略有先后，链表只是近似有序，遇到未过期项即停止，余下的留待下一轮
+        while (shard->exp_head != NULL && shard->exp_head->expires_ms <= now_ms) {
+            path_cache_entry_t *entry = shard->exp_head;
+            shard_remove(shard, entry);
+            entry->hash_next = removed;
+            removed = entry;
+        }
+        if (shard->exp_head != NULL && shard->exp_head->expires_ms < next) {
+            next = shard->exp_head->expires_ms;
+        }
+        pthread_mutex_unlock(&shard->lock);
+        release_list(removed);
+    }
+    if (next == UINT64_MAX) {
+        return -1;
+    }
+    return next - now_ms > INT_MAX ? INT_MAX : (int)(next - now_ms);
+}
+
+const char *path_cache_root(const path_cache_t *cache) {
+    return cache->root;
+}
+
+void path_cache_stats(const path_cache_t *cache, uint64_t *hits, uint64_t *misses) {
+    *hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+    *misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,53 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// 路径解析结果缓存项，以解码后的URL路径为键
+// 缓存表持有一个引用，path_cache_get返回的每个引用都需path_cache_release释放
+typedef struct path_cache_entry {
+    char *key;                  // 解码后的URL路径
+    uint32_t hash;
+    char *real_path;            // 规范化后的文件系统绝对路径
+    struct stat st;
+    int fd;                     // 普通文件或目录的只读fd，-1表示未打开
+    int status;                 // 0表示可访问，否则为应返回的HTTP错误码
+    uint64_t expires_ms;        // 过期时间（单调时钟毫秒）
+    int refcount;
+    struct path_cache_entry *hash_next;
+    struct path_cache_entry *lru_prev;
+    struct path_cache_entry *lru_next;
+    struct path_cache_entry *exp_prev;  // 按过期时间排列的链表，用于及时关闭过期项的fd
+    struct path_cache_entry *exp_next;
+} path_cache_entry_t;
+
+typedef struct path_cache path_cache_t;
+
+// 创建缓存，root_dir只在此处解析一次
+// capacity为0时不缓存，每次查询都重新解析；ttl_ms为缓存项有效期
+path_cache_t *path_cache_create(const char *root_dir, size_t capacity, int ttl_ms);
+
+// 销毁缓存，仍被引用的缓存项在最后一次释放时回收
+void path_cache_destroy(path_cache_t *cache);
+
+// 查询URL路径对应的文件，未命中或已过期时重新解析
+// fd耗尽（503）或内存不足（500）的解析结果不缓存
+// 返回带引用的缓存项，内存不足时返回NULL
+path_cache_entry_t *path_cache_get(path_cache_t *cache, const char *url_path, uint64_t now_ms);
+
+// 摘除已过期的缓存项，未被引用的项随即关闭fd
+// 返回距下一项过期的毫秒数，没有缓存项时返回-1
+int path_cache_expire(path_cache_t *cache, uint64_t now_ms);
+
+// 释放path_cache_get返回的引用
+void path_cache_release(path_cache_entry_t *entry);
+
+// 启动时解析得到的根目录绝对路径
+const char *path_cache_root(const path_cache_t *cache);
+
+// 读取命中/未命中计数
+void path_cache_stats(const path_cache_t *cache, uint64_t *hits, uint64_t *misses);
+
+#endif // PATH_CACHE_H
@@ -4,12 +4,16 @@
 #include <signal.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/resource.h>
 
 #include "server.h"
 #include "config.h"
 #include "http_server.h"
 #include "ftp_server.h"
 #include "logMgr.h"
+#include "access_log.h"
 
 #define APP_ID "SRV"
 
@@ -23,6 +27,8 @@ void handle_signal(int signum) {
     if (signum == SIGINT || signum == SIGTERM) {
         printf("\nReceived termination signal. Shutting down servers...\n");
         server_running = false;
+        http_server_wakeup();
+        ftp_server_wakeup();
     }
 }
 
@@ -31,6 +37,46 @@ void handle_signal(int signum) {
 
 
 
+// 监听socket、epoll、eventfd、inotify及日志文件等固定占用的fd数
+#define FD_RESERVE_FIXED     128
+// 每个HTTP连接预留的fd数：socket及处理请求时临时打开的文件
+#define FD_PER_HTTP_CONN     2
+// 每个FTP会话预留的fd数：控制连接、被动监听、数据连接及传输的文件
+#define FD_PER_FTP_SESSION   4
+
+// 将fd软上限提高到硬上限，并按剩余额度限制路径缓存项数
+// 每个缓存的普通文件或目录持有一个fd，连接数用满时不能让缓存占光fd导致accept失败
+static void fit_fd_limit(ServerConfig *config) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+        dlt_log_warn(APP_ID, "getrlimit(RLIMIT_NOFILE) failed: %s", strerror(errno));
+        return;
+    }
+    if (rl.rlim_cur < rl.rlim_max) {
+        rlim_t old = rl.rlim_cur;
+        rl.rlim_cur = rl.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &rl) != 0) {
+            rl.rlim_cur = old;
+        }
+    }
+    long limit = rl.rlim_cur > (rlim_t)INT_MAX ? INT_MAX : (long)rl.rlim_cur;
+    // 未限制HTTP连接数时为连接留出一半额度
+    long http_fds = config->http.max_connections > 0 ? (long)config->http.max_connections * FD_PER_HTTP_CONN
+                                                     : limit / 2;
+    long budget = limit - FD_RESERVE_FIXED - http_fds - (long)config->ftp.max_connections * FD_PER_FTP_SESSION;
+    if (budget < 0) {
+        budget = 0;
+    }
+    dlt_log_info(APP_ID, "Open file limit %ld, path cache fd budget %ld", limit, budget);
+    if (config->http.path_cache_size > budget) {
+        dlt_log_warn(APP_ID, "path_cache_size %d exceeds the open file budget, limited to %ld",
+                     config->http.path_cache_size, budget);
+        fprintf(stderr, "Warning: path_cache_size %d exceeds the open file limit, limited to %ld\n",
+                config->http.path_cache_size, budget);
+        config->http.path_cache_size = (int)budget;
+    }
+}
+
 // 打印使用帮助
 void print_usage(const char *prog_name) {
     printf("Usage: %s [-c config_file]\n", prog_name);
@@ -86,6 +132,17 @@ int main(int argc, char *argv[]) {
         printf("Successfully loaded configuration from %s\n", config_file);
     }
 
+#ifndef USE_DLT_LIB
+    // 配置加载后再应用运行时日志级别，此前按默认级别输出
+    log_set_level(server_config.log.level);
+#endif
+
+    if (access_log_open(server_config.log.access_log, server_config.log.access_log_size_mb) != 0) {
+        fprintf(stderr, "Warning: Access log disabled\n");
+    }
+
+    fit_fd_limit(&server_config);
+
     // 打印配置信息
 
     dlt_log_debug(APP_ID, "Printing loaded configuration");
@@ -95,6 +152,8 @@ int main(int argc, char *argv[]) {
 
     signal(SIGINT, handle_signal);
     signal(SIGTERM, handle_signal);
+    // 对端关闭后继续写入时返回EPIPE而不是终止进程
+    signal(SIGPIPE, SIG_IGN);
     dlt_log_debug(APP_ID, "Signal handlers set for SIGINT and SIGTERM");
 
 
@@ -140,6 +199,7 @@ int main(int argc, char *argv[]) {
 
     dlt_log_debug(APP_ID, "All servers stopped. Exiting.");
     printf("All servers stopped. Exiting.\n");
+    access_log_close();
 
     // 关闭日志模块
     dlt_free_client(APP_ID);
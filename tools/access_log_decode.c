@@ -0,0 +1,187 @@
+// 二进制访问日志解码工具，按时间顺序输出文件中的全部有效记录
+// 用法: access_log_decode [-c] [-n count] 访问日志文件
+//   -c        输出CSV（带表头），默认输出每行一条的文本
+//   -n count  只输出最新的count条记录
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include "../access_log.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-c] [-n count] access_log_file\n", prog);
+}
+
+// 格式化UTC时间，精确到微秒
+static void format_time(char *buf, size_t size, uint64_t time_ns) {
+    time_t sec = (time_t)(time_ns / 1000000000ULL);
+    struct tm tm;
+    gmtime_r(&sec, &tm);
+    size_t len = strftime(buf, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + len, size - len, ".%06uZ", (unsigned)(time_ns % 1000000000ULL / 1000));
+}
+
+// 阶段时间，未经历时输出"-"
+static void format_us(char *buf, size_t size, uint32_t us) {
+    if (us == ACCESS_LOG_NO_TIME) {
+        snprintf(buf, size, "-");
+    } else {
+        snprintf(buf, size, "%u", us);
+    }
+}
+
+static const char *protocol_name(uint8_t protocol) {
+    switch (protocol) {
+    case ACCESS_PROTO_HTTP: return "HTTP";
+    case ACCESS_PROTO_FTP:  return "FTP";
+    default:                return "?";
+    }
+}
+
+// CSV字段中的引号加倍
+static void print_csv_string(const char *s, size_t len) {
+    putchar('"');
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '"') {
+            putchar('"');
+        }
+        putchar(s[i]);
+    }
+    putchar('"');
+}
+
+// 文本输出中的控制字符及空格转义为\xNN，保证每条记录一行、字段以空格分隔
+static void print_text_string(const char *s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c <= ' ' || c == 0x7f || c == '\\') {
+            printf("\\x%02x", c);
+        } else {
+            putchar(c);
+        }
+    }
+}
+
+static void print_record(const access_record_t *rec, int csv) {
+    char when[48], addr[INET_ADDRSTRLEN];
+    char parse[16], resolve[16], first_byte[16], complete[16];
+    struct in_addr in = { .s_addr = rec->addr };
+    format_time(when, sizeof(when), rec->time_ns);
+    inet_ntop(AF_INET, &in, addr, sizeof(addr));
+    format_us(parse, sizeof(parse), rec->parse_us);
+    format_us(resolve, sizeof(resolve), rec->resolve_us);
+    format_us(first_byte, sizeof(first_byte), rec->first_byte_us);
+    format_us(complete, sizeof(complete), rec->complete_us);
+    size_t method_len = strnlen(rec->method, sizeof(rec->method));
+    size_t path_len = rec->path_len < sizeof(rec->path) ? rec->path_len : sizeof(rec->path);
+    bool truncated = rec->path_len > sizeof(rec->path);
+
+    if (csv) {
+        printf("%s,%s,%s,%u,%u,", when, protocol_name(rec->protocol), addr, rec->port, rec->worker);
+        print_csv_string(rec->method, method_len);
+        putchar(',');
+        print_csv_string(rec->path, path_len);
+        printf(",%u,%016llx,%u,%llu,%s,%s,%s,%s,%s,%s\n",
+               rec->path_len, (unsigned long long)rec->path_hash, rec->status,
+               (unsigned long long)rec->bytes,
+               (rec->flags & ACCESS_FLAG_ABORTED) ? "aborted" : "",
+               (rec->flags & ACCESS_FLAG_KEEPALIVE) ? "keepalive" : "",
+               parse, resolve, first_byte, complete);
+        return;
+    }
+    printf("%s %s %s:%u w%u ", when, protocol_name(rec->protocol), addr, rec->port, rec->worker);
+    print_text_string(method_len > 0 ? rec->method : "-", method_len > 0 ? method_len : 1);
+    putchar(' ');
+    print_text_string(path_len > 0 ? rec->path : "-", path_len > 0 ? path_len : 1);
+    printf("%s %u %lluB parse=%s resolve=%s first=%s total=%s%s%s\n",
+           truncated ? "..." : "", rec->status, (unsigned long long)rec->bytes,
+           parse, resolve, first_byte, complete,
+           (rec->flags & ACCESS_FLAG_ABORTED) ? " aborted" : "",
+           (rec->flags & ACCESS_FLAG_KEEPALIVE) ? " keepalive" : "");
+}
+
+int main(int argc, char *argv[]) {
+    int csv = 0;
+    unsigned long long limit = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "cn:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            csv = 1;
+            break;
+        case 'n':
+            limit = strtoull(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[optind];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < ACCESS_LOG_HEADER_SIZE) {
+        fprintf(stderr, "%s: not an access log\n", path);
+        close(fd);
+        return 1;
+    }
+    // 服务器运行时也可读取，正在写入的记录按序号跳过
+    const char *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    const access_log_header_t *header = (const access_log_header_t *)map;
+    if (memcmp(header->magic, ACCESS_LOG_MAGIC, sizeof(ACCESS_LOG_MAGIC)) != 0 ||
+        header->version != ACCESS_LOG_VERSION || header->record_size != ACCESS_LOG_RECORD_SIZE ||
+        ACCESS_LOG_HEADER_SIZE + header->capacity * ACCESS_LOG_RECORD_SIZE > (uint64_t)st.st_size) {
+        fprintf(stderr, "%s: not an access log or unsupported version\n", path);
+        munmap((void *)map, st.st_size);
+        return 1;
+    }
+
+    const access_record_t *records = (const access_record_t *)(map + ACCESS_LOG_HEADER_SIZE);
+    uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > header->capacity ? head - header->capacity : 0;
+    if (limit > 0 && head - first > limit) {
+        first = head - limit;
+    }
+    if (csv) {
+        printf("time,protocol,client,port,worker,method,path,path_len,path_hash,status,bytes,"
+               "aborted,keepalive,parse_us,resolve_us,first_byte_us,complete_us\n");
+    }
+    for (uint64_t seq = first; seq < head; seq++) {
+        const access_record_t *slot = &records[seq % header->capacity];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq + 1) {
+            continue;
+        }
+        access_record_t rec = *slot;
+        // 复制过程中被覆盖的记录丢弃
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq + 1) {
+            continue;
+        }
+        print_record(&rec, csv);
+    }
+    munmap((void *)map, st.st_size);
+    return 0;
+}
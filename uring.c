@@ -0,0 +1,527 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+
+struct uring {
+    int fd;
+    unsigned features;
+    // 提交队列
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_flags;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;          // 已准备的请求，提交时写入*sq_tail
+    struct io_uring_sqe *sqes;
+    // 完成队列
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    // 提供缓冲区环（缓冲区组0）
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    char *bufs;
+    size_t buf_size;
+    unsigned buf_count;
+    unsigned short buf_tail;
+};
+
+#define URING_BUF_GROUP 0
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+uring_t *uring_create(unsigned entries) {
+    uring_t *ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    // 完成队列放大，突发的多次接收事件不至于溢出；较新的标志不支持时去掉重试
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = entries * 4;
+    ring->fd = sys_io_uring_setup(entries, &p);
+    if (ring->fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;
+        ring->fd = sys_io_uring_setup(entries, &p);
+    }
+    if (ring->fd < 0) {
+        free(ring);
+        return NULL;
+    }
+    ring->features = p.features;
+
+    // 映射提交队列、完成队列及请求数组，新内核中两个队列共用一次映射
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        goto fail;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            goto fail;
+        }
+    }
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        goto fail;
+    }
+
+    char *sq = ring->sq_ring;
+    char *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_flags = (unsigned *)(sq + p.sq_off.flags);
+    ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // 提交队列索引与请求数组一一对应，之后无需再填写
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        array[i] = i;
+    }
+    return ring;
+
+fail:
+    {
+        int err = errno;
+        uring_destroy(ring);
+        errno = err;
+    }
+    return NULL;
+}
+
+void uring_destroy(uring_t *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    // 先关闭实例，内核取消全部请求后才释放其引用的缓冲区
+    close(ring->fd);
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring != NULL) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->buf_ring != NULL) {
+        munmap(ring->buf_ring, ring->buf_ring_size);
+    }
+    free(ring->bufs);
+    free(ring);
+}
+
+// 将缓冲区放入环尾，publish为true时对内核可见
+static void buf_ring_add(uring_t *ring, unsigned bid, bool publish) {
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (ring->buf_count - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring->bufs + (size_t)bid * ring->buf_size);
+    buf->len = (uint32_t)ring->buf_size;
+    buf->bid = (uint16_t)bid;
+    ring->buf_tail++;
+    if (publish) {
+        __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+    }
+}
+
+int uring_provide_buffers(uring_t *ring, unsigned count, size_t size) {
+    if (count == 0 || count > 32768 || (count & (count - 1)) != 0 || ring->buf_ring != NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // 环本身需页对齐，由内核与本线程共享
+    ring->buf_ring_size = count * sizeof(struct io_uring_buf);
+    void *mem = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+    if (posix_memalign((void **)&ring->bufs, 64, (size_t)count * size) != 0) {
+        munmap(mem, ring->buf_ring_size);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)mem;
+    reg.ring_entries = count;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        munmap(mem, ring->buf_ring_size);
+        free(ring->bufs);
+        ring->bufs = NULL;
+        errno = err;
+        return -1;
+    }
+
+    ring->buf_ring = mem;
+    ring->buf_size = size;
+    ring->buf_count = count;
+    ring->buf_tail = 0;
+    for (unsigned i = 0; i < count; i++) {
+        buf_ring_add(ring, i, i == count - 1);
+    }
+    return 0;
+}
+
+char *uring_buffer(uring_t *ring, unsigned bid) {
+    return ring->bufs + (size_t)bid * ring->buf_size;
+}
+
+unsigned uring_buffer_count(const uring_t *ring) {
+    return ring->buf_count;
+}
+
+void uring_recycle_buffer(uring_t *ring, unsigned bid) {
+    buf_ring_add(ring, bid, true);
+}
+
+// 提交已准备的请求，wait为true时等待至少一个完成事件或超时
+static int uring_enter(uring_t *ring, bool wait, int timeout_ms) {
+    unsigned tail = ring->sqe_tail;
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    unsigned to_submit = tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    // 始终带GETEVENTS，COOP_TASKRUN模式下由此处理内核推迟的完成工作
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void *argp = NULL;
+    size_t argsz = 0;
+    if (wait && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp = &arg;
+        argsz = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    int ret = sys_io_uring_enter(ring->fd, to_submit, wait ? 1 : 0, flags, argp, argsz);
+    if (ret < 0 && (errno == ETIME || errno == EINTR || errno == EBUSY)) {
+        return 0;
+    }
+    return ret;
+}
+
+int uring_reserve(uring_t *ring, unsigned n) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head + n <= ring->sq_entries) {
+        return 0;
+    }
+    if (uring_enter(ring, false, 0) < 0) {
+        return -1;
+    }
+    head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head + n <= ring->sq_entries) {
+        return 0;
+    }
+    errno = EBUSY;
+    return -1;
+}
+
+// 取一个空闲的请求项并清零
+static struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+    if (uring_reserve(ring, 1) != 0) {
+        return NULL;
+    }
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+    ring->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int uring_prep_accept_multishot(uring_t *ring, int fd, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int uring_prep_poll(uring_t *ring, int fd, unsigned events, bool multishot, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int uring_prep_recv_multishot(uring_t *ring, int fd, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int uring_prep_splice(uring_t *ring, int fd_in, int64_t off_in, int fd_out, unsigned len,
+                      unsigned flags, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_SPLICE;
+    sqe->fd = fd_out;
+    sqe->off = (uint64_t)-1;
+    sqe->splice_fd_in = fd_in;
+    sqe->splice_off_in = (uint64_t)off_in;
+    sqe->len = len;
+    sqe->splice_flags = SPLICE_F_MOVE;
+    if (flags & URING_LINK) {
+        sqe->flags = IOSQE_IO_LINK;
+    }
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int uring_prep_cancel_fd(uring_t *ring, int fd, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int uring_prep_cancel(uring_t *ring, uint64_t target, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+// 取出已完成的事件
+static int uring_reap(uring_t *ring, uring_cqe_t *cqes, int max) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    int n = 0;
+    while (head != tail && n < max) {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        cqes[n].user_data = cqe->user_data;
+        cqes[n].res = cqe->res;
+        cqes[n].flags = (cqe->flags & IORING_CQE_F_BUFFER ? URING_CQE_BUFFER : 0) |
+                        (cqe->flags & IORING_CQE_F_MORE ? URING_CQE_MORE : 0) |
+                        (cqe->flags >> IORING_CQE_BUFFER_SHIFT) << 16;
+        n++;
+        head++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+int uring_wait(uring_t *ring, uring_cqe_t *cqes, int max, int timeout_ms) {
+    // 队列中已有事件且没有待提交的请求时不进入内核
+    bool ready = *ring->cq_head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    bool taskrun = (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) &
+                    (IORING_SQ_TASKRUN | IORING_SQ_CQ_OVERFLOW)) != 0;
+    if (!ready || taskrun || ring->sqe_tail != *ring->sq_tail) {
+        if (uring_enter(ring, !ready && timeout_ms != 0, timeout_ms) < 0) {
+            return -1;
+        }
+    }
+    return uring_reap(ring, cqes, max);
+}
+
+bool uring_available(const char **reason) {
+    uring_t *ring = uring_create(8);
+    if (ring == NULL) {
+        *reason = strerror(errno);
+        return false;
+    }
+
+    bool ok = false;
+    unsigned required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_FAST_POLL;
+    struct io_uring_probe *probe = calloc(1, sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op));
+    if ((ring->features & required) != required) {
+        *reason = "kernel too old";
+    } else if (probe == NULL || sys_io_uring_register(ring->fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        *reason = "opcode probe failed";
+    } else {
+        static const unsigned ops[] = {
+            IORING_OP_ACCEPT, IORING_OP_POLL_ADD, IORING_OP_RECV, IORING_OP_SPLICE, IORING_OP_ASYNC_CANCEL,
+        };
+        ok = true;
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            if (ops[i] > probe->last_op || !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+                ok = false;
+            }
+        }
+        // 多次接收（6.0）与SEND_ZC同时加入，无法单独探测，以此判断
+        if (!ok || probe->last_op < IORING_OP_SEND_ZC) {
+            ok = false;
+            *reason = "required opcodes not supported";
+        } else if (uring_provide_buffers(ring, 1, 64) != 0) {
+            ok = false;
+            *reason = "provided buffer rings not supported";
+        }
+    }
+    free(probe);
+    uring_destroy(ring);
+    return ok;
+}
+
+#else // !HAVE_IO_URING
+
+bool uring_available(const char **reason) {
+    *reason = "not compiled in";
+    return false;
+}
+
+uring_t *uring_create(unsigned entries) {
+    (void)entries;
+    errno = ENOSYS;
+    return NULL;
+}
+
+void uring_destroy(uring_t *ring) {
+    (void)ring;
+}
+
+int uring_provide_buffers(uring_t *ring, unsigned count, size_t size) {
+    (void)ring; (void)count; (void)size;
+    errno = ENOSYS;
+    return -1;
+}
+
+char *uring_buffer(uring_t *ring, unsigned bid) {
+    (void)ring; (void)bid;
+    return NULL;
+}
+
+unsigned uring_buffer_count(const uring_t *ring) {
+    (void)ring;
+    return 0;
+}
+
+void uring_recycle_buffer(uring_t *ring, unsigned bid) {
+    (void)ring; (void)bid;
+}
+
+int uring_reserve(uring_t *ring, unsigned n) {
+    (void)ring; (void)n;
+    return -1;
+}
+
+int uring_prep_accept_multishot(uring_t *ring, int fd, uint64_t user_data) {
+    (void)ring; (void)fd; (void)user_data;
+    return -1;
+}
+
+int uring_prep_poll(uring_t *ring, int fd, unsigned events, bool multishot, uint64_t user_data) {
+    (void)ring; (void)fd; (void)events; (void)multishot; (void)user_data;
+    return -1;
+}
+
+int uring_prep_recv_multishot(uring_t *ring, int fd, uint64_t user_data) {
+    (void)ring; (void)fd; (void)user_data;
+    return -1;
+}
+
+int uring_prep_splice(uring_t *ring, int fd_in, int64_t off_in, int fd_out, unsigned len,
+                      unsigned flags, uint64_t user_data) {
+    (void)ring; (void)fd_in; (void)off_in; (void)fd_out; (void)len; (void)flags; (void)user_data;
+    return -1;
+}
+
+int uring_prep_cancel_fd(uring_t *ring, int fd, uint64_t user_data) {
+    (void)ring; (void)fd; (void)user_data;
+    return -1;
+}
+
+int uring_prep_cancel(uring_t *ring, uint64_t target, uint64_t user_data) {
+    (void)ring; (void)target; (void)user_data;
+    return -1;
+}
+
+int uring_wait(uring_t *ring, uring_cqe_t *cqes, int max, int timeout_ms) {
+    (void)ring; (void)cqes; (void)max; (void)timeout_ms;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif // HAVE_IO_URING
@@ -0,0 +1,80 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 最小的io_uring封装，直接使用io_uring_setup/io_uring_enter/io_uring_register系统调用，不依赖liburing
+// 准备的请求先放入提交队列，由uring_wait与等待完成合并为一次io_uring_enter提交
+// 每个实例只能由一个线程使用
+typedef struct uring uring_t;
+
+// 完成事件
+typedef struct {
+    uint64_t user_data;
+    int32_t res;                // 成功时为结果，失败时为负的errno
+    uint32_t flags;             // URING_CQE_*
+} uring_cqe_t;
+
+#define URING_CQE_BUFFER   (1U << 0)    // 使用了提供缓冲区，编号见uring_cqe_buffer
+#define URING_CQE_MORE     (1U << 1)    // 多次请求仍然有效，之后还会产生完成事件
+
+// 与前一个请求链接：前一个请求成功且未截断才执行
+#define URING_LINK         (1U << 0)
+
+// 检查内核是否支持本服务器使用的全部功能（多次accept/recv、提供缓冲区环、splice、按fd取消）
+// 不支持时返回false，*reason为原因
+bool uring_available(const char **reason);
+
+// 创建提交队列entries项的实例，完成队列为其4倍，失败时返回NULL并设置errno
+uring_t *uring_create(unsigned entries);
+
+// 销毁实例，内核取消所有未完成的请求，提供缓冲区一并释放
+void uring_destroy(uring_t *ring);
+
+// 注册count个（2的幂）size字节的接收缓冲区，供uring_prep_recv_multishot选择使用
+int uring_provide_buffers(uring_t *ring, unsigned count, size_t size);
+
+// 提供缓冲区的地址及数量
+char *uring_buffer(uring_t *ring, unsigned bid);
+unsigned uring_buffer_count(const uring_t *ring);
+
+// 数据处理完毕后将缓冲区交还内核
+void uring_recycle_buffer(uring_t *ring, unsigned bid);
+
+// 完成事件使用的提供缓冲区编号
+static inline unsigned uring_cqe_buffer(const uring_cqe_t *cqe) {
+    return cqe->flags >> 16;
+}
+
+// 确保提交队列至少有n个空位（必要时先提交已准备的请求），链接的请求需在同一批中提交
+int uring_reserve(uring_t *ring, unsigned n);
+
+// 以下函数准备一个请求，提交队列已满且无法提交时返回-1
+
+// 多次accept：每接受一个连接产生一个完成事件，res为新连接的fd（非阻塞、close-on-exec）
+int uring_prep_accept_multishot(uring_t *ring, int fd, uint64_t user_data);
+
+// 等待fd就绪，res为就绪的poll事件；multishot为true时每次就绪都产生完成事件
+int uring_prep_poll(uring_t *ring, int fd, unsigned events, bool multishot, uint64_t user_data);
+
+// 多次接收：数据到达时从提供缓冲区中取一个填充，res为字节数，0表示对端关闭
+int uring_prep_recv_multishot(uring_t *ring, int fd, uint64_t user_data);
+
+// splice，off_in为-1时使用fd_in的当前位置（管道必须为-1）
+int uring_prep_splice(uring_t *ring, int fd_in, int64_t off_in, int fd_out, unsigned len,
+                      unsigned flags, uint64_t user_data);
+
+// 取消fd上的全部请求
+int uring_prep_cancel_fd(uring_t *ring, int fd, uint64_t user_data);
+
+// 取消user_data为target的请求
+int uring_prep_cancel(uring_t *ring, uint64_t target, uint64_t user_data);
+
+// 提交已准备的请求并等待完成事件，最多取出max个
+// timeout_ms为-1时一直等待，为0时不等待；返回取出的事件数，失败时返回-1并设置errno
+int uring_wait(uring_t *ring, uring_cqe_t *cqes, int max, int timeout_ms);
+
+#endif // URING_H
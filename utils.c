@@ -11,9 +11,87 @@
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#ifdef HAVE_OPENAT2
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+#endif
 #include "logMgr.h"
 #define APP_ID "SRV"
 
+// 确保缓冲区至少还能容纳extra字节（另留一个结束符），容量按倍数增长
+int strbuf_reserve(strbuf_t *sb, size_t extra) {
+    if (sb->len + extra + 1 <= sb->cap) {
+        return 0;
+    }
+    size_t cap = sb->cap ? sb->cap : 256;
+    while (cap < sb->len + extra + 1) {
+        cap *= 2;
+    }
+    char *data = realloc(sb->data, cap);
+    if (data == NULL) {
+        return -1;
+    }
+    sb->data = data;
+    sb->cap = cap;
+    return 0;
+}
+
+int strbuf_append(strbuf_t *sb, const void *data, size_t len) {
+    if (strbuf_reserve(sb, len) != 0) {
+        return -1;
+    }
+    memcpy(sb->data + sb->len, data, len);
+    sb->len += len;
+    sb->data[sb->len] = '\0';
+    return 0;
+}
+
+int strbuf_printf(strbuf_t *sb, const char *format, ...) {
+    va_list args;
+    for (;;) {
+        size_t avail = sb->cap > sb->len ? sb->cap - sb->len : 0;
+        va_start(args, format);
+        int n = vsnprintf(avail ? sb->data + sb->len : NULL, avail, format, args);
+        va_end(args);
+        if (n < 0) {
+            return -1;
+        }
+        if ((size_t)n < avail) {
+            sb->len += n;
+            return 0;
+        }
+        // 空间不足，扩容后重新格式化
+        if (strbuf_reserve(sb, (size_t)n) != 0) {
+            return -1;
+        }
+    }
+}
+
+void strbuf_free(strbuf_t *sb) {
+    free(sb->data);
+    sb->data = NULL;
+    sb->len = sb->cap = 0;
+}
+
+// 从offset处读满count字节，遇到文件结尾时返回实际读取的字节数，出错返回-1
+ssize_t pread_full(int fd, void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pread(fd, (char *)buf + done, count - done, offset + (off_t)done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return (ssize_t)done;
+}
+
 int safe_path_join(char *dest, size_t dest_size, const char *path1, const char *path2, const char *separator) {
     size_t len1 = strlen(path1);
     size_t len2 = strlen(path2);
@@ -39,11 +117,164 @@ int is_path_safe(const char *path, const char *root_dir) {
     if (realpath(path, real_path) == NULL) {
         return 0;
     }
-    return strstr(real_path, real_root) == real_path;
+    // 前缀须在路径分隔符处结束，否则/srv/www2会被当作/srv/www内的路径
+    size_t root_len = strlen(real_root);
+    if (root_len == 1) {
+        return 1;
+    }
+    return strncmp(real_path, real_root, root_len) == 0 &&
+           (real_path[root_len] == '/' || real_path[root_len] == '\0');
+}
+
+ssize_t path_normalize(char *dest, size_t dest_size, const char *path, bool clamp_root) {
+    size_t len = 0;     // dest中已输出的部分，根目录为空
+    const char *p = path;
+    while (*p != '\0') {
+        while (*p == '/') {
+            p++;
+        }
+        const char *seg = p;
+        while (*p != '\0' && *p != '/') {
+            p++;
+        }
+        size_t seg_len = p - seg;
+        if (seg_len == 0 || (seg_len == 1 && seg[0] == '.')) {
+            continue;
+        }
+        if (seg_len == 2 && seg[0] == '.' && seg[1] == '.') {
+            if (len == 0) {
+                if (clamp_root) {
+                    continue;
+                }
+                errno = EPERM;
+                return -1;
+            }
+            while (dest[len - 1] != '/') {
+                len--;
+            }
+            len--;
+            continue;
+        }
+        if (len + 1 + seg_len + 1 > dest_size) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        dest[len++] = '/';
+        memcpy(dest + len, seg, seg_len);
+        len += seg_len;
+    }
+    if (len == 0) {
+        if (dest_size < 2) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        dest[len++] = '/';
+    }
+    dest[len] = '\0';
+    return (ssize_t)len;
+}
+
+// 不支持openat2时逐级打开目录，每一级都拒绝符号链接
+static int open_beneath_walk(int root_fd, const char *path, int flags) {
+    int dir_fd = root_fd;
+    const char *name = path;
+    const char *slash;
+    while ((slash = strchr(name, '/')) != NULL) {
+        char component[NAME_MAX + 1];
+        size_t len = slash - name;
+        if (len > NAME_MAX) {
+            errno = ENAMETOOLONG;
+            break;
+        }
+        memcpy(component, name, len);
+        component[len] = '\0';
+        int next = openat(dir_fd, component, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (dir_fd != root_fd) {
+            close(dir_fd);
+        }
+        if (next < 0) {
+            return -1;
+        }
+        dir_fd = next;
+        name = slash + 1;
+    }
+    int fd = slash == NULL ? openat(dir_fd, name, flags | O_NOFOLLOW) : -1;
+    if (dir_fd != root_fd) {
+        int err = errno;
+        close(dir_fd);
+        errno = err;
+    }
+    return fd;
+}
+
+int open_beneath(int root_fd, const char *path, int flags) {
+#ifdef HAVE_OPENAT2
+    static int openat2_supported = 1;
+    if (__atomic_load_n(&openat2_supported, __ATOMIC_RELAXED)) {
+        struct open_how how = {
+            .flags = (uint64_t)flags,
+            .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+        };
+        int fd = (int)syscall(SYS_openat2, root_fd, path, &how, sizeof(how));
+        if (fd >= 0 || errno != ENOSYS) {
+            return fd;
+        }
+        __atomic_store_n(&openat2_supported, 0, __ATOMIC_RELAXED);
+    }
+#endif
+    return open_beneath_walk(root_fd, path, flags);
+}
+
+size_t url_decode(char *dest, const char *src) {
+    size_t i = 0, j = 0;
+    while (src[i]) {
+        if (src[i] == '%' && isxdigit((unsigned char)src[i+1]) && isxdigit((unsigned char)src[i+2])) {
+            char hex[3] = {src[i+1], src[i+2], '\0'};
+            dest[j++] = strtol(hex, NULL, 16);
+            i += 3;
+        } else {
+            dest[j++] = src[i++];
+        }
+    }
+    dest[j] = '\0';
+    return j;
+}
+
+// 去除字符串首尾的空白字符
+char* trim_whitespace(char *str) {
+    if (str == NULL) return NULL;
+    
+    // 去除开头的空白字符
+    char *start = str;
+    while (*start && isspace((unsigned char)*start)) {
+        start++;
+    }
+    
+    // 如果全是空白字符，返回空字符串
+    if (*start == '\0') {
+        *str = '\0';
+        return str;
+    }
+    
+    // 去除结尾的空白字符
+    char *end = start + strlen(start) - 1;
+    while (end > start && isspace((unsigned char)*end)) {
+        end--;
+    }
+    
+    // 添加上字符串结束符
+    *(end + 1) = '\0';
+    
+    // 如果起始位置有移动，将内容前移
+    if (start != str) {
+        memmove(str, start, end - start + 2);
+    }
+    
+    return str;
 }
 
 const char* get_file_size_str(off_t size) {
-    static char str[32];
+    static __thread char str[32];   // 每个线程独立的缓冲区，HTTP工作线程可并发调用
     if (size < 1024) {
         snprintf(str, sizeof(str), "%ld B", (long)size);
     } else if (size < 1024 * 1024) {
@@ -58,8 +289,8 @@ const char* get_file_size_str(off_t size) {
 
 
 void print_raw_data(const char *prefix, const char *data, size_t len) {
-    dlt_log_info(APP_ID, "%s: Raw data (%zu bytes):", prefix,len);
-    dlt_log_info(APP_ID, "%s", data);
+    // 每条FTP命令、响应及LIST行都会调用，默认级别下在格式化之前即返回
+    dlt_log_verbose(APP_ID, "%s: Raw data (%zu bytes): %.*s", prefix, len, (int)len, data);
 }
 
 
@@ -29,9 +29,34 @@
 #include <sys/sendfile.h>
 #include <stdbool.h>
 
+// 可增长的字符缓冲区
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} strbuf_t;
+
+int strbuf_reserve(strbuf_t *sb, size_t extra);
+int strbuf_append(strbuf_t *sb, const void *data, size_t len);
+int strbuf_printf(strbuf_t *sb, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void strbuf_free(strbuf_t *sb);
+
+ssize_t pread_full(int fd, void *buf, size_t count, off_t offset);
 int safe_path_join(char *dest, size_t dest_size, const char *path1, const char *path2, const char *separator);
 int is_path_safe(const char *path, const char *root_dir);
+// 按字面规范化路径：合并重复的斜杠、去掉"."、".."回退一级，不访问文件系统
+// path不以'/'开头时视为相对于根目录；结果以'/'开头，除根目录外不以'/'结尾
+// ".."越出根目录时：clamp_root为true则停留在根目录（FTP的语义），否则返回-1且errno为EPERM
+// 返回结果长度；dest_size不足时返回-1且errno为ENAMETOOLONG
+ssize_t path_normalize(char *dest, size_t dest_size, const char *path, bool clamp_root);
+// 打开root_fd下的相对路径path（须已规范化，不含".."），解析过程不能离开root_fd
+// 优先使用openat2(RESOLVE_BENEATH)，由内核拒绝越出根目录的符号链接；内核不支持时逐级打开并拒绝所有符号链接
+int open_beneath(int root_fd, const char *path, int flags);
 const char* get_file_size_str(off_t size);
+// URL解码（%XX），dest至少strlen(src)+1字节，返回解码后的长度
+size_t url_decode(char *dest, const char *src);
+// 原地去除首尾空白，返回str
+char* trim_whitespace(char *str);
 void print_raw_data(const char *prefix, const char *data, size_t len);
 char *get_local_ip();
 long get_file_size(const char *filename);